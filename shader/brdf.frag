@@ -1,48 +1,10 @@
 #version 460 core
-out vec2 FragColor;
+out vec3 FragColor; // split-sum scale, bias and the average energy of the roughness
 in vec2 TexCoords;
 
-const float PI = 3.14159265359;
+uniform uint sampleCount; // from ibl::IBLSettings
 
-// http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
-// efficient VanDerCorpus calculation.
-float RadicalInverse_VdC(uint bits) 
-{
-     bits = (bits << 16u) | (bits >> 16u);
-     bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
-     bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
-     bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
-     bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-     return float(bits) * 2.3283064365386963e-10; // / 0x100000000
-}
-
-vec2 Hammersley(uint i, uint N)
-{
-	return vec2(float(i)/float(N), RadicalInverse_VdC(i));
-}
-
-vec3 ImportanceSampleGGX(vec2 Xi, vec3 N, float roughness)
-{
-	float a = roughness*roughness;
-	
-	float phi = 2.0 * PI * Xi.x;
-	float cosTheta = sqrt((1.0 - Xi.y) / (1.0 + (a*a - 1.0) * Xi.y));
-	float sinTheta = sqrt(1.0 - cosTheta*cosTheta);
-	
-	// from spherical coordinates to cartesian coordinates - halfway vector
-	vec3 H;
-	H.x = cos(phi) * sinTheta;
-	H.y = sin(phi) * sinTheta;
-	H.z = cosTheta;
-	
-	// from tangent-space H vector to world-space sample vector
-	vec3 up          = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
-	vec3 tangent   = normalize(cross(up, N));
-	vec3 bitangent = cross(N, tangent);
-	
-	vec3 sampleVec = tangent * H.x + bitangent * H.y + N * H.z;
-	return normalize(sampleVec);
-}
+#include "common/sampling.glsl"
 
 float GeometrySchlickGGX(float NdotV, float roughness)
 {
@@ -64,7 +26,7 @@ float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
     return ggx1 * ggx2;
 }
 
-vec2 IntegrateBRDF(float NdotV, float roughness)
+vec2 IntegrateBRDF(float NdotV, float roughness, uint sampleCount)
 {
     vec3 V;
     V.x = sqrt(1.0 - NdotV*NdotV);
@@ -76,12 +38,11 @@ vec2 IntegrateBRDF(float NdotV, float roughness)
 
     vec3 N = vec3(0.0, 0.0, 1.0);
     
-    const uint SAMPLE_COUNT = 1024u;
-    for(uint i = 0u; i < SAMPLE_COUNT; ++i)
+    for(uint i = 0u; i < sampleCount; ++i)
     {
         // generates a sample vector that's biased towards the
         // preferred alignment direction (importance sampling).
-        vec2 Xi = Hammersley(i, SAMPLE_COUNT);
+        vec2 Xi = Hammersley(i, sampleCount);
         vec3 H = ImportanceSampleGGX(Xi, N, roughness);
         vec3 L = normalize(2.0 * dot(V, H) * H - V);
 
@@ -99,12 +60,28 @@ vec2 IntegrateBRDF(float NdotV, float roughness)
             bias += Fc * G_Vis;
         }
     }
-    scale /= float(SAMPLE_COUNT);
-    bias /= float(SAMPLE_COUNT);
+    scale /= float(sampleCount);
+    bias /= float(sampleCount);
     return vec2(scale, bias);
 }
 
+// cosine weighted average over the view directions of the single scattering energy E = scale + bias,
+// 2 * integral of E(mu) mu dmu. The multi-scatter compensation uses it for the bounces after the first
+float AverageEnergy(float roughness)
+{
+    const uint MU_COUNT = 16u;
+    uint count = max(sampleCount / MU_COUNT, 16u);
+    float sum = 0.0;
+    for (uint i = 0u; i < MU_COUNT; ++i)
+    {
+        float mu = (float(i) + 0.5) / float(MU_COUNT);
+        vec2 energy = IntegrateBRDF(mu, roughness, count);
+        sum += (energy.x + energy.y) * mu;
+    }
+    return 2.0 * sum / float(MU_COUNT);
+}
+
 void main() 
 {
-    FragColor = IntegrateBRDF(TexCoords.x, TexCoords.y);
+    FragColor = vec3(IntegrateBRDF(TexCoords.x, TexCoords.y, sampleCount), AverageEnergy(TexCoords.y));
 }
\ No newline at end of file
@@ -0,0 +1,3 @@
+#pragma once
+
+const float PI = 3.14159265359;
\ No newline at end of file
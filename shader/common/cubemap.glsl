@@ -0,0 +1,15 @@
+#pragma once
+
+// direction through the texel center, following the GL cubemap face layout
+vec3 cubemapDirection(uint face, vec2 st)
+{
+    switch (face)
+    {
+        case 0u: return vec3( 1.0, -st.y, -st.x);
+        case 1u: return vec3(-1.0, -st.y,  st.x);
+        case 2u: return vec3( st.x,  1.0,  st.y);
+        case 3u: return vec3( st.x, -1.0, -st.y);
+        case 4u: return vec3( st.x, -st.y,  1.0);
+        default: return vec3(-st.x, -st.y, -1.0);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+// image based lighting of the lighting shaders: the global maps, their octahedral atlas and the local reflection probes
+#include "brdf.glsl"
+#include "octahedral.glsl"
+
+// IBL
+uniform samplerCube irradianceMap;
+uniform samplerCube prefilterMap;
+uniform float maxReflectionLod; // prefilter mip levels - 1
+uniform sampler2D brdfLUT;
+uniform int environmentBRDFMethod; // ibl::EnvironmentBRDF: 0 brdfLUT, 1 Karis approximation, 2 polynomial fit
+uniform bool multiScatter;         // compensate the energy the single scattering split-sum loses
+
+// the same data resampled into an octahedral atlas (ibl::OctahedralAtlas), used instead of the cubemaps when octahedralIBL is set
+uniform bool octahedralIBL;
+uniform sampler2D iblAtlas;
+uniform vec2 iblAtlasSize;
+uniform vec3 iblAtlasPrefilterRects[8]; // inner tile area in texels: xy origin, z size
+uniform vec3 iblAtlasIrradianceRect;
+
+// local reflection probes with box parallax correction (lights::ReflectionProbes)
+uniform samplerCubeArray probeMaps;
+uniform int probeCount; // zero disables the probes
+uniform float probeMaxLod;
+uniform vec3 probePositions[4];
+uniform vec3 probeBoxMins[4];
+uniform vec3 probeBoxMaxs[4];
+
+vec3 sampleAtlas(vec3 rect, vec3 direction)
+{
+    vec2 texel = rect.xy + octahedralEncode(direction) * rect.z;
+    return textureLod(iblAtlas, texel / iblAtlasSize, 0.0).rgb;
+}
+
+vec3 sampleIrradiance(vec3 N)
+{
+    if (octahedralIBL) return sampleAtlas(iblAtlasIrradianceRect, N);
+    return texture(irradianceMap, N).rgb;
+}
+
+// the atlas mips are separate tiles, blend the two around the lod like trilinear filtering would
+vec3 samplePrefilter(vec3 R, float roughness)
+{
+    float lod = roughness * maxReflectionLod;
+    if (octahedralIBL)
+    {
+        int lowerMip = int(lod);
+        int upperMip = min(lowerMip + 1, int(maxReflectionLod));
+        return mix(sampleAtlas(iblAtlasPrefilterRects[lowerMip], R), sampleAtlas(iblAtlasPrefilterRects[upperMip], R), lod - float(lowerMip));
+    }
+    return textureLod(prefilterMap, R, lod).rgb;
+}
+
+// pre-filtered radiance along R, from the first probe whose box contains worldPos or else the global prefilter map
+vec3 sampleReflection(vec3 worldPos, vec3 R, float roughness)
+{
+    vec3 globalColor = samplePrefilter(R, roughness);
+    for (int i = 0; i < probeCount; ++i)
+    {
+        vec3 boxMin = probeBoxMins[i];
+        vec3 boxMax = probeBoxMaxs[i];
+        if (any(lessThan(worldPos, boxMin)) || any(greaterThan(worldPos, boxMax))) continue;
+
+        // the probe saw the surroundings from its own position, look up where R leaves the box instead of R itself
+        // R nudged away from 0 with its sign kept, sign(0) taken as +: a zero component on a box plane would give 0 / 0
+        vec3 safeR = R + mix(vec3(1e-6), vec3(-1e-6), lessThan(R, vec3(0.0)));
+        vec3 toMax = (boxMax - worldPos) / safeR;
+        vec3 toMin = (boxMin - worldPos) / safeR;
+        vec3 exits = max(toMax, toMin);
+        float distance = min(min(exits.x, exits.y), exits.z);
+        vec3 direction = worldPos + R * distance - probePositions[i];
+        vec3 localColor = textureLod(probeMaps, vec4(direction, float(i)), roughness * probeMaxLod).rgb;
+
+        // fade into the global map over the outer tenth of the box so the boundary doesn't show
+        vec3 inside = min(worldPos - boxMin, boxMax - worldPos) / max(boxMax - boxMin, vec3(1e-4));
+        float weight = clamp(min(min(inside.x, inside.y), inside.z) * 10.0, 0.0, 1.0);
+        return mix(globalColor, localColor, weight);
+    }
+    return globalColor;
+}
+
+// least squares fit of the BRDF LUT by the brdf_fit tool,
+// (scale, bias) of sqrt(NdotV)^i * roughness^j at [i * 5 + j]
+const vec2 ENVIRONMENT_BRDF_FIT[25] = vec2[](
+    vec2(-0.1263342, 0.7446767), vec2(4.314314, -4.062863), vec2(-6.77204, 11.78807), vec2(3.730521, -15.52658), vec2(-0.5307466, 7.142566),
+    vec2(0.7463751, 3.501383), vec2(-48.92021, -3.293384), vec2(180.3881, -41.84362), vec2(-224.95, 91.60921), vec2(92.99176, -50.595),
+    vec2(6.293147, -19.00784), vec2(138.8584, 67.0517), vec2(-653.8574, -22.28053), vec2(908.5933, -111.0674), vec2(-402.2752, 86.80489),
+    vec2(-10.7084, 25.28472), vec2(-147.5203, -116.8083), vec2(799.4401, 148.9883), vec2(-1180.993, -19.77588), vec2(543.0718, -39.1571),
+    vec2(4.811331, -10.548), vec2(53.04308, 57.46175), vec2(-317.7026, -97.76119), vec2(489.2808, 56.07553), vec2(-230.8982, -4.726469)
+);
+
+// split-sum scale and bias applied to F0 and the average energy of the roughness (see brdf.frag),
+// the analytic paths skip the LUT fetch and approximate the average by the energy of the view direction
+vec3 environmentBRDF(float NdotV, float roughness)
+{
+    if (environmentBRDFMethod == 1)
+    {
+        // Karis, "Physically Based Shading on Mobile"
+        const vec4 c0 = vec4(-1.0, -0.0275, -0.572, 0.022);
+        const vec4 c1 = vec4(1.0, 0.0425, 1.04, -0.04);
+        vec4 r = roughness * c0 + c1;
+        float a004 = min(r.x * r.x, exp2(-9.28 * NdotV)) * r.x + r.y;
+        vec2 scaleBias = vec2(-1.04, 1.04) * a004 + r.zw;
+        return vec3(scaleBias, scaleBias.x + scaleBias.y);
+    }
+    if (environmentBRDFMethod == 2)
+    {
+        // Horner in roughness per power of sqrt(NdotV)
+        float s = sqrt(NdotV);
+        vec2 result = vec2(0.0);
+        float sPower = 1.0;
+        for (int i = 0; i < 5; ++i)
+        {
+            vec2 value = ENVIRONMENT_BRDF_FIT[i * 5 + 4];
+            for (int j = 3; j >= 0; --j) value = value * roughness + ENVIRONMENT_BRDF_FIT[i * 5 + j];
+            result += value * sPower;
+            sPower *= s;
+        }
+        return vec3(result, result.x + result.y);
+    }
+    return texture(brdfLUT, vec2(NdotV, roughness)).rgb;
+}
+
+// diffuse and specular IBL, split-sum with the optional multi-scatter compensation
+vec3 evaluateAmbient(vec3 worldPos, vec3 N, vec3 V, vec3 albedo, float metallic, float roughness, vec3 F0)
+{
+    vec3 R = reflect(-V, N);
+    vec3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughness);
+
+    vec3 kS = F;
+    vec3 kD = 1.0 - kS;
+    kD *= 1.0 - metallic;
+
+    vec3 irradiance = sampleIrradiance(N);
+    vec3 diffuse = irradiance * albedo;
+
+    // sample both the pre-filter map and the BRDF lut and combine them together as per the Split-Sum approximation to get the IBL specular part.
+    vec3 prefilteredColor = sampleReflection(worldPos, R, roughness);
+    vec3 brdf = environmentBRDF(max(dot(N, V), 0.0), roughness);
+    vec3 FssEss = F * brdf.x + brdf.y;
+    vec3 specular = prefilteredColor * FssEss;
+
+    vec3 ambient = kD * diffuse + specular;
+    if (multiScatter)
+    {
+        // Fdez-Aguera, "A Multiple-Scattering Microfacet Model for Real-Time Image-based Lighting":
+        // the energy 1 - Ess the single scattering lobe misses bounces again, as a geometric series in the
+        // average Fresnel and average energy, and leaves roughly like the cosine weighted irradiance
+        float Ess = brdf.x + brdf.y;
+        float Ems = 1.0 - Ess;
+        vec3 Favg = F0 + (1.0 - F0) / 21.0;
+        vec3 Fms = FssEss * Favg / (1.0 - (1.0 - brdf.z) * Favg);
+        // diffuse only receives what neither scattering term reflects
+        vec3 Edss = 1.0 - (FssEss + Fms * Ems);
+        ambient = specular + (Fms * Ems + albedo * (1.0 - metallic) * Edss) * irradiance;
+    }
+    return ambient;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+// clustered analytic lights and the shadowed sun, evaluated the same way by the forward and the deferred path
+#include "brdf.glsl"
+
+// analytic lights, binned per cluster on the CPU (lights::ClusteredLightGrid)
+struct Light
+{
+    vec4 positionRange;  // xyz: world position, w: range
+    vec4 colorIntensity; // rgb: color, a: intensity
+    vec4 directionType;  // xyz: spot direction, w: 0 point, 1 spot
+    vec4 spotCosAngles;  // x: cos(outer), y: cos(inner)
+};
+layout (std430, binding = 0) readonly buffer LightBuffer { Light lights[]; };
+layout (std430, binding = 1) readonly buffer ClusterBuffer { uvec2 clusters[]; }; // offset, count
+layout (std430, binding = 2) readonly buffer LightIndexBuffer { uint lightIndices[]; };
+
+uniform vec3 clusterDims;
+uniform float clusterZScale;
+uniform float clusterZBias;
+uniform vec2 screenSize;
+uniform mat4 view;
+
+// directional light with cascaded shadows (lights::CascadedShadowMap)
+uniform vec3 sunDirection; // direction the light travels in
+uniform vec3 sunRadiance;  // color * intensity, zero when there is no sun
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 cascadeMatrices[4];
+uniform float cascadeSplits[4]; // far view depth of each cascade
+uniform float cascadeTexelWorldSizes[4];
+uniform float shadowTexelSize;
+
+uint getClusterIndex(vec3 worldPos)
+{
+    float depth = -(view * vec4(worldPos, 1.0)).z;
+    uint slice = uint(clamp(floor(log(depth) * clusterZScale - clusterZBias), 0.0, clusterDims.z - 1.0));
+    uvec2 tile = uvec2(clamp(floor(gl_FragCoord.xy / screenSize * clusterDims.xy), vec2(0.0), clusterDims.xy - 1.0));
+    return (slice * uint(clusterDims.y) + tile.y) * uint(clusterDims.x) + tile.x;
+}
+
+vec3 evaluateLight(Light light, vec3 worldPos, vec3 N, vec3 V, vec3 albedo, float metallic, float roughness, vec3 F0)
+{
+    vec3 toLight = light.positionRange.xyz - worldPos;
+    float distance2 = dot(toLight, toLight);
+    vec3 L = toLight * inversesqrt(distance2);
+
+    // inverse square falloff, windowed to reach zero at the light range
+    float rangeRatio = distance2 / (light.positionRange.w * light.positionRange.w);
+    float window = clamp(1.0 - rangeRatio * rangeRatio, 0.0, 1.0);
+    float attenuation = window * window / max(distance2, 1e-4);
+    if (light.directionType.w > 0.5)
+    {
+        float cd = dot(-L, light.directionType.xyz);
+        attenuation *= smoothstep(light.spotCosAngles.x, light.spotCosAngles.y, cd);
+    }
+    vec3 radiance = light.colorIntensity.rgb * light.colorIntensity.a * attenuation;
+    return evaluateBRDF(L, radiance, N, V, albedo, metallic, roughness, F0);
+}
+
+// fraction of the sun reaching worldPos, 3x3 PCF in the cascade covering it
+float sunShadow(vec3 worldPos, vec3 N)
+{
+    float depth = -(view * vec4(worldPos, 1.0)).z;
+    int cascade = -1;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (depth < cascadeSplits[i])
+        {
+            cascade = i;
+            break;
+        }
+    }
+    if (cascade < 0) return 1.0;
+
+    // push the lookup along the normal by about a texel to avoid acne
+    vec3 offsetPos = worldPos + N * cascadeTexelWorldSizes[cascade] * 1.5;
+    vec4 lightSpacePos = cascadeMatrices[cascade] * vec4(offsetPos, 1.0);
+    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+
+    float shadow = 0.0;
+    for (int x = -1; x <= 1; ++x)
+    {
+        for (int y = -1; y <= 1; ++y)
+        {
+            vec2 uv = projCoords.xy + vec2(x, y) * shadowTexelSize;
+            shadow += texture(shadowMap, vec4(uv, float(cascade), projCoords.z));
+        }
+    }
+    return shadow / 9.0;
+}
+
+// radiance reflected towards V from the lights of the cluster of worldPos and the sun
+vec3 evaluateLights(vec3 worldPos, vec3 N, vec3 V, vec3 albedo, float metallic, float roughness, vec3 F0)
+{
+    vec3 Lo = vec3(0.0);
+    uvec2 cluster = clusters[getClusterIndex(worldPos)];
+    for (uint i = 0u; i < cluster.y; ++i)
+    {
+        Lo += evaluateLight(lights[lightIndices[cluster.x + i]], worldPos, N, V, albedo, metallic, roughness, F0);
+    }
+    if (dot(sunRadiance, sunRadiance) > 0.0)
+    {
+        Lo += evaluateBRDF(-sunDirection, sunRadiance * sunShadow(worldPos, N), N, V, albedo, metallic, roughness, F0);
+    }
+    return Lo;
+}
\ No newline at end of file
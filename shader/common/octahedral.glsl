@@ -0,0 +1,24 @@
+#pragma once
+// octahedral mapping of directions, used by the atlas encoder and the lighting shaders
+
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// direction to [0, 1]^2, the lower hemisphere is folded over the diagonals
+vec2 octahedralEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 p = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return p * 0.5 + 0.5;
+}
+
+// inverse of octahedralEncode in the lighting shaders
+vec3 octahedralDecode(vec2 uv)
+{
+    vec2 p = uv * 2.0 - 1.0;
+    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+out vec3 vPos;
+
+void main()
+{
+    // projected per face in cubemap_layered.geom
+    vPos = aPos;
+}
\ No newline at end of file
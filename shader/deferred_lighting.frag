@@ -0,0 +1,52 @@
+#version 460 core
+out vec4 FragColor;
+in vec2 TexCoords;
+
+// G-buffer
+uniform sampler2D gAlbedoMetallic;
+uniform sampler2D gNormalRoughness;
+uniform sampler2D gDepth;
+
+#include "common/environment.glsl"
+#include "common/lights.glsl"
+
+uniform vec3 camPos;
+uniform mat4 invViewProjection;
+
+void main()
+{
+    float depth = texture(gDepth, TexCoords).r;
+    if (depth == 1.0) discard; // nothing was drawn here, keep the clear color
+
+    // reconstruct world position from depth
+    vec4 clipPos = vec4(vec3(TexCoords, depth) * 2.0 - 1.0, 1.0);
+    vec4 worldPos = invViewProjection * clipPos;
+    vec3 WorldPos = worldPos.xyz / worldPos.w;
+
+    // material properties
+    vec4 albedoMetallic = texture(gAlbedoMetallic, TexCoords);
+    vec4 normalRoughness = texture(gNormalRoughness, TexCoords);
+    vec3 albedo = pow(albedoMetallic.rgb, vec3(2.2));
+    float metallic = albedoMetallic.a;
+    float roughness = normalRoughness.a;
+
+    // input lighting data
+    vec3 N = normalize(normalRoughness.xyz);
+    vec3 V = normalize(camPos - WorldPos);
+
+    vec3 F0 = vec3(0.04);
+    F0 = mix(F0, albedo, metallic);
+
+    // reflectance equation, with IBL as the ambient term
+    vec3 Lo = evaluateLights(WorldPos, N, V, albedo, metallic, roughness, F0);
+    vec3 ambient = evaluateAmbient(WorldPos, N, V, albedo, metallic, roughness, F0);
+
+    vec3 color = ambient + Lo;
+
+    // HDR tonemapping
+    color = color / (color + vec3(1.0));
+    // gamma correct
+    color = pow(color, vec3(1.0/2.2));
+
+    FragColor = vec4(color , 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+#version 460 core
+
+// depth pre-pass, only the depth buffer is written
+void main()
+{
+}
\ No newline at end of file
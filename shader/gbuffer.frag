@@ -0,0 +1,60 @@
+#version 460 core
+layout (location = 0) out vec4 gAlbedoMetallic;
+layout (location = 1) out vec4 gNormalRoughness;
+in vec2 TexCoords;
+in vec3 WorldPos;
+in vec3 Normal;
+
+// material parameters, the HAS_*_MAP defines come from the mesh's textures (shader::ShaderPermutations)
+#ifdef HAS_ALBEDO_MAP
+uniform sampler2D albedoMap1;
+#endif
+#ifdef HAS_NORMAL_MAP
+uniform sampler2D normalMap1;
+#endif
+#ifdef HAS_METALLIC_ROUGHNESS_MAP
+uniform sampler2D metallicMap1;
+#endif
+
+// used for the textures a mesh doesn't have, must match pbr.frag
+const vec3 DEFAULT_ALBEDO = vec3(0.8);
+const float DEFAULT_METALLIC = 0.0;
+const float DEFAULT_ROUGHNESS = 0.5;
+
+vec3 getNormalFromMap()
+{
+#ifndef HAS_NORMAL_MAP
+    return normalize(Normal);
+#else
+    vec3 tangentNormal = texture(normalMap1, TexCoords).xyz * 2.0 - 1.0;
+
+    vec3 Q1  = dFdx(WorldPos);
+    vec3 Q2  = dFdy(WorldPos);
+    vec2 st1 = dFdx(TexCoords);
+    vec2 st2 = dFdy(TexCoords);
+
+    vec3 N   = normalize(Normal);
+    vec3 T  = normalize(Q1*st2.t - Q2*st1.t);
+    vec3 B  = -normalize(cross(N, T));
+    mat3 TBN = mat3(T, B, N);
+
+    return normalize(TBN * tangentNormal);
+#endif
+}
+
+void main()
+{
+#ifdef HAS_METALLIC_ROUGHNESS_MAP
+    vec3 metallicRoughness = texture(metallicMap1, TexCoords).rgb;
+#else
+    vec3 metallicRoughness = vec3(0.0, DEFAULT_ROUGHNESS, DEFAULT_METALLIC);
+#endif
+    // albedo is stored as sampled, the lighting pass converts it to linear space
+#ifdef HAS_ALBEDO_MAP
+    vec3 albedo = texture(albedoMap1, TexCoords).rgb;
+#else
+    vec3 albedo = pow(DEFAULT_ALBEDO, vec3(1.0 / 2.2));
+#endif
+    gAlbedoMetallic = vec4(albedo, metallicRoughness.b);
+    gNormalRoughness = vec4(getNormalFromMap(), metallicRoughness.g);
+}
\ No newline at end of file
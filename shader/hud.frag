@@ -0,0 +1,13 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D font;
+
+// white text over a translucent panel, the panel's vertices have negative texture coordinates
+void main()
+{
+    if (TexCoords.x < 0.0) FragColor = vec4(0.0, 0.0, 0.0, 0.6);
+    else FragColor = vec4(1.0, 1.0, 1.0, texture(font, TexCoords).r);
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 460 core
+layout (location = 0) in vec2 aPos; // pixels from the top left corner
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+uniform vec2 screenSize;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = vec4(aPos.x / screenSize.x * 2.0 - 1.0, 1.0 - aPos.y / screenSize.y * 2.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -3,8 +3,9 @@ out vec4 FragColor;
 in vec3 WorldPos;
 
 uniform samplerCube environmentMap;
+uniform float sampleDelta; // hemisphere step in radians, from ibl::IBLSettings
 
-const float PI = 3.14159265359;
+#include "common/constants.glsl"
 
 void main()
 {		
@@ -17,7 +18,6 @@ void main()
     vec3 right = normalize(cross(up, N));
     up         = normalize(cross(N, right));
        
-    float sampleDelta = 0.025;
     float nrSamples = 0.0f;
     for(float phi = 0.0; phi < 2.0 * PI; phi += sampleDelta)
     {
@@ -4,24 +4,39 @@ in vec2 TexCoords;
 in vec3 WorldPos;
 in vec3 Normal;
 
-// material parameters
+// material parameters, the HAS_*_MAP defines come from the mesh's textures (shader::ShaderPermutations)
+#ifdef HAS_ALBEDO_MAP
 uniform sampler2D albedoMap1;
+#endif
+#ifdef HAS_NORMAL_MAP
 uniform sampler2D normalMap1;
+#endif
+#ifdef HAS_METALLIC_ROUGHNESS_MAP
 uniform sampler2D metallicMap1;
+#endif
 // uniform sampler2D roughnessMap1;
-// uniform sampler2D aoMap1;
-// uniform sampler2D emissiveMap1;
+#ifdef HAS_AO_MAP
+uniform sampler2D aoMap1;
+#endif
+#ifdef HAS_EMISSIVE_MAP
+uniform sampler2D emissiveMap1;
+#endif
 
-// IBL
-uniform samplerCube irradianceMap;
-uniform samplerCube prefilterMap;
-uniform sampler2D brdfLUT;
+// used for the textures a mesh doesn't have, linear albedo
+const vec3 DEFAULT_ALBEDO = vec3(0.8);
+const float DEFAULT_METALLIC = 0.0;
+const float DEFAULT_ROUGHNESS = 0.5;
+
+#include "common/environment.glsl"
+#include "common/lights.glsl"
 
 uniform vec3 camPos;
 
-const float PI = 3.14159265359;
 vec3 getNormalFromMap()
 {
+#ifndef HAS_NORMAL_MAP
+    return normalize(Normal);
+#else
     vec3 tangentNormal = texture(normalMap1, TexCoords).xyz * 2.0 - 1.0;
 
     vec3 Q1  = dFdx(WorldPos);
@@ -35,55 +50,46 @@ vec3 getNormalFromMap()
     mat3 TBN = mat3(T, B, N);
 
     return normalize(TBN * tangentNormal);
-}
-
-vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
-{
-    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+#endif
 }
 
 void main()
 {		
     // material properties
+#ifdef HAS_ALBEDO_MAP
     vec3 albedo = pow(texture(albedoMap1, TexCoords).rgb, vec3(2.2));
-    float metallic = texture(metallicMap1, TexCoords).b;
-    float roughness = texture(metallicMap1, TexCoords).g;
-    // float ao = texture(aoMap1, TexCoords).r;
-    // vec3 emissive = texture(emissiveMap1, TexCoords).rgb;
+#else
+    vec3 albedo = DEFAULT_ALBEDO;
+#endif
+#ifdef HAS_METALLIC_ROUGHNESS_MAP
+    vec3 metallicRoughness = texture(metallicMap1, TexCoords).rgb;
+    float metallic = metallicRoughness.b;
+    float roughness = metallicRoughness.g;
+#else
+    float metallic = DEFAULT_METALLIC;
+    float roughness = DEFAULT_ROUGHNESS;
+#endif
        
     // input lighting data
     vec3 N = getNormalFromMap();
     vec3 V = normalize(camPos - WorldPos);
-    vec3 R = reflect(-V, N); 
 
     // calculate reflectance at normal incidence; if dia-electric (like plastic) use F0 
     // of 0.04 and if it's a metal, use the albedo color as F0 (metallic workflow)    
     vec3 F0 = vec3(0.04); 
     F0 = mix(F0, albedo, metallic);
 
-    // reflectance equation
-    vec3 Lo = vec3(0.0);
-    // ambient lighting (we now use IBL as the ambient term)
-    vec3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughness);
-    
-    vec3 kS = F;
-    vec3 kD = 1.0 - kS;
-    kD *= 1.0 - metallic;	  
-    
-    vec3 irradiance = texture(irradianceMap, N).rgb;
-    vec3 diffuse = irradiance * albedo;
-    
-    // sample both the pre-filter map and the BRDF lut and combine them together as per the Split-Sum approximation to get the IBL specular part.
-    const float MAX_REFLECTION_LOD = 4.0;
-    vec3 prefilteredColor = textureLod(prefilterMap, R,  roughness * MAX_REFLECTION_LOD).rgb;    
-    vec3 brdf  = texture(brdfLUT, vec2(max(dot(N, V), 0.0), roughness)).rgb;
-    vec3 specular = prefilteredColor * (F * brdf.r + brdf.g);
-
-    // vec3 ambient = (kD * diffuse + specular) * ao;
-    vec3 ambient = kD * diffuse + specular;
+    // reflectance equation, with IBL as the ambient term
+    vec3 Lo = evaluateLights(WorldPos, N, V, albedo, metallic, roughness, F0);
+    vec3 ambient = evaluateAmbient(WorldPos, N, V, albedo, metallic, roughness, F0);
+#ifdef HAS_AO_MAP
+    ambient *= texture(aoMap1, TexCoords).r;
+#endif
     
     vec3 color = ambient + Lo;
-    // vec3 color = ambient + Lo + pow(emissive, vec3(2.2));
+#ifdef HAS_EMISSIVE_MAP
+    color += pow(texture(emissiveMap1, TexCoords).rgb, vec3(2.2));
+#endif
 
     // HDR tonemapping
     color = color / (color + vec3(1.0));
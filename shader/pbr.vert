@@ -12,6 +12,9 @@ uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 normalMatrix;
 
+// the depth pre-pass and the G-buffer pass must produce bit-identical depth
+invariant gl_Position;
+
 void main()
 {
     TexCoords = aTexCoords;
@@ -0,0 +1,10 @@
+#version 460 core
+out vec4 FragColor;
+in vec3 WorldPos;
+
+uniform samplerCube environmentMap;
+
+void main()
+{
+    FragColor = vec4(textureLod(environmentMap, WorldPos, 0.0).rgb, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#version 460 core
+out vec4 FragColor;
+in vec2 TexCoords;
+in vec3 WorldPos;
+in vec3 Normal;
+
+// cheap shading of the scene as seen by a reflection probe (lights::ReflectionProbes):
+// diffuse only, lit by the global irradiance map and the unshadowed sun
+uniform sampler2D albedoMap1;
+uniform sampler2D metallicMap1;
+uniform samplerCube irradianceMap;
+
+uniform vec3 sunDirection; // direction the light travels in
+uniform vec3 sunRadiance;  // color * intensity, zero when there is no sun
+
+#include "common/constants.glsl"
+
+void main()
+{
+    vec3 albedo = pow(texture(albedoMap1, TexCoords).rgb, vec3(2.2));
+    float metallic = texture(metallicMap1, TexCoords).b;
+    vec3 N = normalize(Normal);
+
+    vec3 irradiance = texture(irradianceMap, N).rgb;
+    irradiance += sunRadiance * max(dot(N, -sunDirection), 0.0) / PI;
+
+    // linear HDR radiance, the lighting shaders tonemap after adding the reflection
+    FragColor = vec4(irradiance * albedo * (1.0 - metallic), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+#include "batch/batch_job.h"
+#include "utility/json.h"
+
+namespace batch
+{
+
+namespace
+{
+using utility::JsonValue;
+
+// "../resources/psr-13/scene.gltf" -> "scene"
+std::string fileStem(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+bool readStrings(const JsonValue& value, const char* name, std::vector<std::string>& strings)
+{
+    if (!value.IsArray())
+    {
+        std::cerr << "Error: batch job \"" << name << "\" must be an array of paths" << std::endl;
+        return false;
+    }
+    strings.clear();
+    for (const JsonValue& element : value.array)
+    {
+        if (!element.IsString())
+        {
+            std::cerr << "Error: batch job \"" << name << "\" must be an array of paths" << std::endl;
+            return false;
+        }
+        strings.push_back(element.string);
+    }
+    return true;
+}
+
+bool readVec3(const JsonValue& value, const char* name, glm::vec3& vector)
+{
+    if (!value.IsArray() || value.array.size() != 3 || !value.array[0].IsNumber() || !value.array[1].IsNumber() || !value.array[2].IsNumber())
+    {
+        std::cerr << "Error: batch view \"" << name << "\" must be [x, y, z]" << std::endl;
+        return false;
+    }
+    vector = glm::vec3(value.array[0].number, value.array[1].number, value.array[2].number);
+    return true;
+}
+
+// a number member, left as it is when missing
+template<typename T>
+bool readNumber(const JsonValue& object, const char* name, T& number)
+{
+    const JsonValue* value = object.Find(name);
+    if (!value) return true;
+    if (!value->IsNumber())
+    {
+        std::cerr << "Error: batch job \"" << name << "\" must be a number" << std::endl;
+        return false;
+    }
+    number = static_cast<T>(value->number);
+    return true;
+}
+
+bool readView(const JsonValue& value, BatchView& view)
+{
+    if (!value.IsObject())
+    {
+        std::cerr << "Error: a batch view must be an object" << std::endl;
+        return false;
+    }
+    if (const JsonValue* position = value.Find("position"))
+    {
+        view.absolute = true;
+        if (!readVec3(*position, "position", view.position)) return false;
+        const JsonValue* target = value.Find("target");
+        return !target || readVec3(*target, "target", view.target);
+    }
+    return readNumber(value, "yaw", view.yaw) && readNumber(value, "pitch", view.pitch) && readNumber(value, "distance", view.distance);
+}
+} // namespace
+
+bool LoadBatchJob(const std::string& path, BatchJob& job)
+{
+    JsonValue root;
+    std::string error;
+    if (!utility::ReadJsonFile(path, root, error))
+    {
+        std::cerr << "Error: batch job " << error << std::endl;
+        return false;
+    }
+    if (!root.IsObject())
+    {
+        std::cerr << "Error: batch job " << path << " must be a JSON object" << std::endl;
+        return false;
+    }
+
+    if (const JsonValue* models = root.Find("models"))
+    {
+        if (!readStrings(*models, "models", job.models)) return false;
+    }
+    if (const JsonValue* environments = root.Find("environments"))
+    {
+        if (!readStrings(*environments, "environments", job.environments)) return false;
+    }
+    if (const JsonValue* views = root.Find("views"))
+    {
+        if (!views->IsArray())
+        {
+            std::cerr << "Error: batch job \"views\" must be an array" << std::endl;
+            return false;
+        }
+        job.views.clear();
+        for (const JsonValue& value : views->array)
+        {
+            job.views.emplace_back();
+            if (!readView(value, job.views.back())) return false;
+        }
+    }
+    unsigned int orbit = 0;
+    if (!readNumber(root, "orbit", orbit)) return false;
+    for (unsigned int i = 0; i < orbit; ++i)
+    {
+        BatchView view;
+        view.yaw = 360.0f * i / orbit;
+        job.views.push_back(view);
+    }
+    if (job.views.empty()) job.views.emplace_back();
+
+    if (const JsonValue* output = root.Find("output"))
+    {
+        if (!output->IsString() || output->string.empty())
+        {
+            std::cerr << "Error: batch job \"output\" must be a path pattern" << std::endl;
+            return false;
+        }
+        job.output = output->string;
+    }
+    if (const JsonValue* renderer = root.Find("renderer"))
+    {
+        if (renderer->IsString() && renderer->string == "forward") job.rendererType = renderers::RendererType::Forward;
+        else if (renderer->IsString() && renderer->string == "deferred") job.rendererType = renderers::RendererType::Deferred;
+        else
+        {
+            std::cerr << "Error: batch job \"renderer\" must be forward or deferred" << std::endl;
+            return false;
+        }
+    }
+    if (const JsonValue* quality = root.Find("quality"))
+    {
+        if (!quality->IsString() || !ibl::ParseIBLQuality(quality->string.c_str(), job.iblQuality))
+        {
+            std::cerr << "Error: batch job \"quality\" must be fast, balanced or quality" << std::endl;
+            return false;
+        }
+    }
+    if (!readNumber(root, "width", job.width) || !readNumber(root, "height", job.height)) return false;
+    if (!readNumber(root, "encode_threads", job.encodeThreads) || !readNumber(root, "max_pending_images", job.maxPendingImages)) return false;
+
+    if (job.width <= 0 || job.height <= 0)
+    {
+        std::cerr << "Error: batch job size " << job.width << "x" << job.height << " is empty" << std::endl;
+        return false;
+    }
+    if (job.models.empty() || job.environments.empty())
+    {
+        std::cerr << "Error: batch job " << path << " needs at least one model and one environment" << std::endl;
+        return false;
+    }
+    // catch a pattern without placeholders before rendering images that overwrite each other
+    std::unordered_set<std::string> outputs;
+    for (const std::string& model : job.models)
+    {
+        for (const std::string& environment : job.environments)
+        {
+            for (size_t view = 0; view < job.views.size(); ++view)
+            {
+                std::string output = FormatOutputPath(job.output, model, environment, view);
+                if (!outputs.insert(output).second)
+                {
+                    std::cerr << "Error: batch job renders more than one image to " << output << ", the output pattern needs {model}, {environment} and {view}" << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+std::string FormatOutputPath(const std::string& pattern, const std::string& modelPath, const std::string& environmentPath, size_t view)
+{
+    char viewName[16];
+    std::snprintf(viewName, sizeof(viewName), "%04zu", view);
+    const std::pair<const char*, std::string> placeholders[] = {
+        { "{model}", fileStem(modelPath) },
+        { "{environment}", fileStem(environmentPath) },
+        { "{view}", viewName }
+    };
+    std::string path = pattern;
+    for (const auto& placeholder : placeholders)
+    {
+        size_t length = std::strlen(placeholder.first);
+        for (size_t at = path.find(placeholder.first); at != std::string::npos; at = path.find(placeholder.first, at + placeholder.second.size()))
+        {
+            path.replace(at, length, placeholder.second);
+        }
+    }
+    return path;
+}
+} // namespace batch
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ibl/ibl_settings.h"
+#include "ibl/precompute.h"
+#include "ibl/environment_brdf.h"
+#include "renderers/renderer.h"
+
+namespace batch
+{
+
+// one camera of a job. With a position it looks from there at target, otherwise it orbits the model's bounds:
+// yaw and pitch in degrees around the bounds center, distance in bounds radii
+struct BatchView
+{
+    bool absolute = false;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 target = glm::vec3(0.0f);
+    float yaw = 0.0f;
+    float pitch = 15.0f;
+    float distance = 0.0f; // 0: close enough that the bounds just fit the view
+};
+
+// every model is rendered under every environment from every view, one image each. A job file looks like
+//  {
+//      "models": ["../resources/psr-13/scene.gltf"],
+//      "environments": ["../resources/environmentMap/courtyard.hdr"],
+//      "views": [{ "yaw": 30, "pitch": 20 }, { "position": [0, 1, 3], "target": [0, 0, 0] }],
+//      "orbit": 8,
+//      "output": "renders/{model}_{environment}_{view}.png",
+//      "width": 1024, "height": 1024, "renderer": "deferred", "quality": "quality", "encode_threads": 4
+//  }
+// "orbit": N adds N views evenly spaced around the model. Without views a single one at yaw 0 is rendered.
+// {model} and {environment} are the file names without extension, {view} the view index; the output extension
+// picks PNG or EXR
+struct BatchJob
+{
+    std::vector<std::string> models;
+    std::vector<std::string> environments;
+    std::vector<BatchView> views;
+    std::string output = "{model}_{environment}_{view}.png";
+    int width = 512;
+    int height = 512;
+    renderers::RendererType rendererType = renderers::RendererType::Forward;
+    ibl::IBLQuality iblQuality = ibl::IBLQuality::Balanced;
+    unsigned int encodeThreads = 0;    // 0: every hardware thread but the GL thread's
+    unsigned int maxPendingImages = 0; // images read back but not written yet before the GL thread waits, 0: 2 per encode thread
+
+    // only set from the command line
+    ibl::PrefilterMethod prefilterMethod = ibl::PrefilterMethod::Compute;
+    ibl::CaptureMethod captureMethod = ibl::CaptureMethod::Layered;
+    ibl::EnvironmentBRDF environmentBRDF = ibl::EnvironmentBRDF::LUT;
+    bool multiScatter = true;
+};
+
+// reads a job file. Members the file leaves out keep the value job already has, so the command line sets the defaults.
+// Fails, with the reason on std::cerr, on invalid JSON, unknown values, no models or environments, or an output
+// pattern that would give two images the same path
+bool LoadBatchJob(const std::string& path, BatchJob& job);
+
+// the output path of one image, the placeholders of the pattern replaced
+std::string FormatOutputPath(const std::string& pattern, const std::string& modelPath, const std::string& environmentPath, size_t view);
+} // namespace batch
@@ -0,0 +1,212 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include "batch/batch_runner.h"
+#include "cameras/camera.h"
+#include "ibl/environment_baker.h"
+#include "lights/cluster_grid.h"
+#include "object3ds/model.h"
+#include "profiling/zones.h"
+#include "renderers/async_readback.h"
+#include "renderers/render_target.h"
+#include "utility/image_write_queue.h"
+#include "utility/thread_pool.h"
+
+namespace batch
+{
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// the camera of a view, the near and far planes enclose the model bounds
+cameras::PerspectiveCamera makeCamera(const BatchView& view, glm::vec3 center, float radius, float aspect)
+{
+    const float fov = 45.0f;
+    glm::vec3 position = view.position;
+    glm::vec3 target = view.target;
+    if (!view.absolute)
+    {
+        // by default the bounding sphere touches the narrower side of the frustum
+        float halfAngle = glm::radians(fov) * 0.5f;
+        if (aspect < 1.0f) halfAngle = std::atan(std::tan(halfAngle) * aspect);
+        float distance = view.distance > 0.0f ? view.distance * radius : radius / std::sin(halfAngle);
+        float yaw = glm::radians(view.yaw);
+        float pitch = glm::radians(glm::clamp(view.pitch, -89.0f, 89.0f)); // straight up or down has no +y up
+        position = center + distance * glm::vec3(std::sin(yaw) * std::cos(pitch), std::sin(pitch), std::cos(yaw) * std::cos(pitch));
+        target = center;
+    }
+    float far = glm::length(position - center) + 2.0f * radius;
+    cameras::PerspectiveCamera camera(position, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f), fov, aspect, 0.001f * far, far);
+    camera.LookAt(position, target);
+    return camera;
+}
+} // namespace
+
+double BatchStats::GetSteadyImagesPerSecond() const
+{
+    double steadySeconds = seconds - (loadMilliseconds + bakeMilliseconds) / 1000.0;
+    return steadySeconds > 0.0 ? images / steadySeconds : 0.0;
+}
+
+bool RunBatch(const BatchJob& job, BatchStats* stats)
+{
+    BatchStats ownStats;
+    BatchStats& result = stats ? *stats : ownStats;
+    result = BatchStats();
+    Clock::time_point start = Clock::now();
+
+    // the driver compiles the programs while the first model loads
+    bool bakeBRDFLUT = job.environmentBRDF == ibl::EnvironmentBRDF::LUT;
+    ibl::PrecomputeShaders precomputeShaders;
+    precomputeShaders.BeginInitialize(job.prefilterMethod, job.captureMethod, bakeBRDFLUT);
+    std::unique_ptr<renderers::Renderer> renderer = renderers::CreateRenderer(job.rendererType);
+    renderer->BeginInitialize();
+    bool rendererReady = false;
+    renderers::RenderTarget target;
+
+    unsigned int captureFBO;
+    unsigned int captureRBO;
+    glGenFramebuffers(1, &captureFBO);
+    glGenRenderbuffers(1, &captureRBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
+    glm::mat4 captureProjection;
+    glm::mat4 captureViews[6];
+    ibl::makeCaptureMatrices(captureProjection, captureViews);
+    const ibl::IBLSettings settings = ibl::GetIBLPreset(job.iblQuality);
+
+    // baked on first use, the BRDF LUT with the first environment
+    std::vector<ibl::EnvironmentMaps> environmentMaps(job.environments.size());
+    unsigned int brdfLUT = 0;
+
+    // the renderers expect a light grid, a batch has no analytic lights
+    utility::ThreadPool binningPool(1);
+    lights::ClusteredLightGrid lightGrid(binningPool);
+    const std::vector<lights::Light> noLights;
+    renderers::LightingInputs lighting;
+    lighting.lightGrid = &lightGrid;
+    lighting.ibl.prefilterMipLevels = settings.prefilterMipLevels;
+    lighting.ibl.environmentBRDF = job.environmentBRDF;
+    lighting.ibl.multiScatter = job.multiScatter;
+
+    // frames are read back through a fenced buffer ring and encoded on the write queue's threads,
+    // the GL thread only waits when the ring or the queue is full
+    renderers::AsyncReadback readback;
+    utility::ImageWriteQueue writer(job.encodeThreads, job.maxPendingImages);
+
+    bool ready = lightGrid.Initialize() && readback.Initialize();
+    if (!ready) std::cerr << "Error: batch failed to initialize the light grid or the readback" << std::endl;
+    for (size_t m = 0; ready && m < job.models.size(); ++m)
+    {
+        Clock::time_point loadStart = Clock::now();
+        object3ds::Model model;
+        model.Load(job.models[m].c_str());
+        result.loadMilliseconds += millisecondsSince(loadStart);
+        glm::vec3 boundsMin = model.GetBoundsMin();
+        glm::vec3 boundsMax = model.GetBoundsMax();
+        if (boundsMin.x > boundsMax.x) // still the empty box, nothing was loaded
+        {
+            std::cerr << "Error: batch skips " << job.models[m] << ", it has no geometry" << std::endl;
+            result.failedImages += job.environments.size() * job.views.size();
+            continue;
+        }
+        glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+        float radius = std::max(0.5f * glm::length(boundsMax - boundsMin), 1e-4f);
+
+        if (!rendererReady)
+        {
+            ready = renderer->Initialize(job.width, job.height) && target.Initialize(job.width, job.height);
+            if (!ready)
+            {
+                std::cerr << "Error: batch failed to initialize the renderer" << std::endl;
+                break;
+            }
+            renderer->SetOutputFramebuffer(target.GetFramebuffer());
+            rendererReady = true;
+        }
+
+        for (size_t e = 0; e < job.environments.size(); ++e)
+        {
+            ibl::EnvironmentMaps& maps = environmentMaps[e];
+            if (maps.irradianceMap == 0)
+            {
+                Clock::time_point bakeStart = Clock::now();
+                unsigned int bakedLUT = 0;
+                bool bakeLUTNow = bakeBRDFLUT && brdfLUT == 0;
+                ibl::precompute(maps.envCubemap, maps.irradianceMap, maps.prefilterMap, bakedLUT, captureFBO, captureRBO, captureProjection, captureViews, job.environments[e].c_str(), settings, job.prefilterMethod, job.captureMethod, bakeLUTNow, &precomputeShaders);
+                if (bakeLUTNow) brdfLUT = bakedLUT;
+                // nothing draws the sky, only the convolved maps are kept
+                glDeleteTextures(1, &maps.envCubemap);
+                maps.envCubemap = 0;
+                glFinish(); // the bake's GPU time counts here rather than in the first readback
+                result.bakeMilliseconds += millisecondsSince(bakeStart);
+            }
+            lighting.ibl.irradianceMap = maps.irradianceMap;
+            lighting.ibl.prefilterMap = maps.prefilterMap;
+            lighting.ibl.brdfLUT = brdfLUT;
+
+            for (size_t v = 0; v < job.views.size(); ++v)
+            {
+                cameras::PerspectiveCamera camera = makeCamera(job.views[v], center, radius, static_cast<float>(job.width) / job.height);
+                Clock::time_point renderStart = Clock::now();
+                lightGrid.Update(noLights, camera.GetViewMatrix(), camera.GetProjectionMatrix());
+                renderer->Render(model, camera, lighting);
+                result.renderMilliseconds += millisecondsSince(renderStart);
+
+                // the callbacks queue the images, time they block on a full write queue counts as waiting for encoders
+                Clock::time_point readbackStart = Clock::now();
+                double encodeWaitBefore = writer.GetWaitMilliseconds();
+                std::string path = FormatOutputPath(job.output, job.models[m], job.environments[e], v);
+                renderers::ReadbackFormat format = renderers::GetReadbackFormat(path);
+                readback.Request(target, format, [&writer, path](utility::DisplayImage&& image)
+                {
+                    writer.Write(path, std::move(image));
+                });
+                readback.Poll();
+                result.readbackMilliseconds += millisecondsSince(readbackStart) - (writer.GetWaitMilliseconds() - encodeWaitBefore);
+            }
+        }
+    }
+    Clock::time_point readbackStart = Clock::now();
+    double encodeWaitBefore = writer.GetWaitMilliseconds();
+    readback.Flush();
+    result.readbackMilliseconds += millisecondsSince(readbackStart) - (writer.GetWaitMilliseconds() - encodeWaitBefore);
+    writer.Wait();
+    result.images = writer.GetWrittenCount();
+    result.failedImages += writer.GetFailedCount();
+    result.encodeWaitMilliseconds = writer.GetWaitMilliseconds();
+    result.readbackStalls = readback.GetStallCount();
+    result.seconds = millisecondsSince(start) / 1000.0;
+
+    for (ibl::EnvironmentMaps& maps : environmentMaps)
+    {
+        glDeleteTextures(1, &maps.irradianceMap);
+        glDeleteTextures(1, &maps.prefilterMap);
+    }
+    if (brdfLUT) glDeleteTextures(1, &brdfLUT);
+    glDeleteFramebuffers(1, &captureFBO);
+    glDeleteRenderbuffers(1, &captureRBO);
+    return ready && result.failedImages == 0;
+}
+
+void PrintBatchStats(const BatchStats& stats)
+{
+    std::cout << "Batch: " << stats.images << " images in " << stats.seconds << " s, " << stats.GetImagesPerSecond() << " images/s ("
+        << stats.GetSteadyImagesPerSecond() << " images/s without model loads and bakes)";
+    if (stats.failedImages > 0) std::cout << ", " << stats.failedImages << " failed";
+    std::cout << std::endl;
+    std::cout << "  model loads " << stats.loadMilliseconds << " ms, environment bakes " << stats.bakeMilliseconds << " ms, render " << stats.renderMilliseconds
+        << " ms, readback " << stats.readbackMilliseconds << " ms (" << stats.readbackStalls << " stalls on a full ring), waiting for encoders " << stats.encodeWaitMilliseconds << " ms" << std::endl;
+}
+} // namespace batch
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include "batch/batch_job.h"
+
+namespace batch
+{
+
+// where the time of a batch went, the phases of the GL thread add up to about the wall time
+struct BatchStats
+{
+    size_t images = 0;        // written
+    size_t failedImages = 0;  // rendered but not written
+    double seconds = 0.0;     // wall time from the first model load to the last file written
+    double loadMilliseconds = 0.0;      // Model::Load
+    double bakeMilliseconds = 0.0;      // precompute(), every environment once
+    double renderMilliseconds = 0.0;    // submitting the frames
+    double readbackMilliseconds = 0.0;  // queueing the copies and mapping finished ones, waiting for the GPU on stalls
+    unsigned int readbackStalls = 0;    // frames that found every readback buffer still in flight
+    double encodeWaitMilliseconds = 0.0; // GL thread blocked on full encode queues, and on the last images at the end
+
+    // the headline: written images over the whole wall time
+    inline double GetImagesPerSecond() const { return seconds > 0.0 ? images / seconds : 0.0; }
+    // without the one-off model loads and environment bakes, what a longer job tends to
+    double GetSteadyImagesPerSecond() const;
+};
+
+// renders every image of the job with the current GL context. Each model is loaded once and its views are rendered
+// under every environment before the next model is loaded; each environment is baked once, on first use, and its
+// maps are kept for the rest of the job. The GL thread only renders: the images come back through a
+// renderers::AsyncReadback ring a few frames later, and PNG/EXR encoding and the disk writes run on a
+// utility::ImageWriteQueue, so both overlap with the next frames. Returns false when the job could not run
+// or an image was not written; stats, when set, is filled in either way
+bool RunBatch(const BatchJob& job, BatchStats* stats = nullptr);
+// one line with images/sec first, then the phase times
+void PrintBatchStats(const BatchStats& stats);
+} // namespace batch
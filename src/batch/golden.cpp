@@ -0,0 +1,133 @@
+#include <iostream>
+#include "batch/golden.h"
+#include "batch/batch_runner.h"
+#include "utility/image_compare.h"
+#include "utility/image_writer.h"
+#include "utility/resources.h"
+#include "utility/stb_image.h"
+
+namespace batch
+{
+
+namespace
+{
+// "golden/forward_0000.png" -> "forward_0000.png"
+std::string fileName(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// RGB8, empty when the file is missing or unreadable
+std::vector<unsigned char> loadRGB8(const std::string& path, int& width, int& height)
+{
+    int channels;
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 3);
+    if (!data) return {};
+    std::vector<unsigned char> pixels(data, data + static_cast<size_t>(width) * height * 3);
+    stbi_image_free(data);
+    return pixels;
+}
+
+bool runGoldenJobs(const std::vector<BatchJob>& jobs)
+{
+    bool succeeded = true;
+    for (const BatchJob& job : jobs)
+    {
+        BatchStats stats;
+        succeeded = RunBatch(job, &stats) && succeeded;
+        std::cout << (job.rendererType == renderers::RendererType::Forward ? "forward" : "deferred") << ": ";
+        PrintBatchStats(stats);
+    }
+    return succeeded;
+}
+} // namespace
+
+std::vector<BatchJob> MakeGoldenJobs(const std::string& directory)
+{
+    BatchJob job;
+    job.models = { utility::ResourcePath("resources/psr-13/scene.gltf") };
+    job.environments = { utility::ResourcePath("resources/environmentMap/golden_sky.hdr") };
+    job.width = 256;
+    job.height = 256;
+    job.iblQuality = ibl::IBLQuality::Fast;
+    // a turn around the model, a view from above and a close up
+    for (float yaw : { 0.0f, 90.0f, 180.0f, 270.0f })
+    {
+        BatchView view;
+        view.yaw = yaw;
+        job.views.push_back(view);
+    }
+    BatchView above;
+    above.yaw = 30.0f;
+    above.pitch = 60.0f;
+    job.views.push_back(above);
+    BatchView closeUp;
+    closeUp.yaw = 45.0f;
+    closeUp.distance = 0.6f;
+    job.views.push_back(closeUp);
+    // one image at a time in flight, a golden run measures the renderer rather than the pipelining
+    job.encodeThreads = 1;
+
+    std::vector<BatchJob> jobs;
+    for (renderers::RendererType type : { renderers::RendererType::Forward, renderers::RendererType::Deferred })
+    {
+        job.rendererType = type;
+        job.output = directory + (type == renderers::RendererType::Forward ? "/forward_{view}.png" : "/deferred_{view}.png");
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+bool UpdateGoldenImages(const std::string& directory)
+{
+    bool succeeded = runGoldenJobs(MakeGoldenJobs(directory));
+    if (succeeded) std::cout << "Golden images written to " << directory << std::endl;
+    return succeeded;
+}
+
+bool CheckGoldenImages(const std::string& goldenDirectory, const std::string& outputDirectory, const GoldenThresholds& thresholds)
+{
+    std::vector<BatchJob> jobs = MakeGoldenJobs(outputDirectory);
+    if (!runGoldenJobs(jobs))
+    {
+        std::cerr << "Error: golden images could not be rendered" << std::endl;
+        return false;
+    }
+
+    size_t failed = 0;
+    size_t count = 0;
+    std::cout << "image, max difference, over tolerance %, PSNR dB, SSIM, FLIP mean, FLIP max, result" << std::endl;
+    for (const BatchJob& job : jobs)
+    {
+        for (size_t v = 0; v < job.views.size(); ++v)
+        {
+            ++count;
+            std::string path = FormatOutputPath(job.output, job.models[0], job.environments[0], v);
+            std::string name = fileName(path);
+            int width, height, goldenWidth, goldenHeight;
+            std::vector<unsigned char> image = loadRGB8(path, width, height);
+            std::vector<unsigned char> golden = loadRGB8(goldenDirectory + "/" + name, goldenWidth, goldenHeight);
+            if (golden.empty() || image.empty() || width != goldenWidth || height != goldenHeight)
+            {
+                ++failed;
+                std::cout << name << ", , , , , , , " << (golden.empty() ? "no golden image, run --golden-update" : "FAIL size") << std::endl;
+                continue;
+            }
+
+            std::vector<float> errorMap;
+            utility::ImageDifference difference = utility::CompareImages(image.data(), golden.data(), width, height, thresholds.channelTolerance, 67.0, &errorMap);
+            bool passed = difference.overTolerance <= thresholds.maxOverTolerance && difference.ssim >= thresholds.minSSIM && difference.flipMean <= thresholds.maxFlipMean;
+            std::cout << name << ", " << difference.maxDifference << ", " << difference.overTolerance * 100.0 << ", " << difference.psnr << ", " << difference.ssim
+                << ", " << difference.flipMean << ", " << difference.flipMax << ", " << (passed ? "pass" : "FAIL") << std::endl;
+            if (passed) continue;
+            ++failed;
+            std::vector<unsigned char> errorImage(errorMap.size());
+            for (size_t i = 0; i < errorMap.size(); ++i) errorImage[i] = static_cast<unsigned char>(errorMap[i] * 255.0f + 0.5f);
+            utility::WritePNG(path.substr(0, path.size() - 4) + "_flip.png", width, height, 1, errorImage.data());
+        }
+    }
+    std::cout << "Golden images: " << count - failed << " of " << count << " pass" << std::endl;
+    return failed == 0;
+}
+} // namespace batch
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "batch/batch_job.h"
+
+namespace batch
+{
+
+// how far a rendered image may drift from its golden image and still pass, every limit has to hold
+struct GoldenThresholds
+{
+    int channelTolerance = 2;       // a pixel differs when one channel is further off than this, 0..255
+    double maxOverTolerance = 0.001; // fraction of pixels allowed to differ
+    double minSSIM = 0.99;
+    double maxFlipMean = 0.01;       // utility::ImageDifference::flipMean
+};
+
+// exit code of a golden check that could not create its context, ctest reports the test as skipped
+constexpr int GOLDEN_SKIPPED_EXIT_CODE = 77;
+
+// the fixed jobs of the golden images: resources/psr-13/scene.gltf under resources/environmentMap/golden_sky.hdr,
+// a small procedural sky committed with the sources, six views at 256x256 with the fast IBL preset, once per
+// renderer, into directory/<renderer>_<view>.png. They ignore the command line so every run renders the same images
+std::vector<BatchJob> MakeGoldenJobs(const std::string& directory);
+
+// renders the golden jobs into directory, replacing the images there
+bool UpdateGoldenImages(const std::string& directory);
+// renders the golden jobs into outputDirectory and compares each image to the one of the same name in
+// goldenDirectory. Prints a line per image and the timing of each job; an image that fails also gets its
+// FLIP-style error map written next to it as <name>_flip.png. Returns true when every image passes
+bool CheckGoldenImages(const std::string& goldenDirectory, const std::string& outputDirectory, const GoldenThresholds& thresholds = GoldenThresholds());
+} // namespace batch
@@ -55,4 +55,12 @@ void Camera::Truck(float xOffset, float yOffset)
     m_position += m_right * xOffset * m_speed * deltaTime;
     m_position += m_up * yOffset * m_speed * deltaTime;
 }
+
+void Camera::LookAt(glm::vec3 position, glm::vec3 target)
+{
+    m_position = position;
+    m_direction = glm::normalize(target - position);
+    m_right = glm::normalize(glm::cross(m_direction, glm::vec3(0.0f, 1.0f, 0.0f)));
+    m_up = glm::normalize(glm::cross(m_right, m_direction));
+}
 } // namespace cameras
\ No newline at end of file
@@ -18,6 +18,8 @@ public:
     void Rotate(float xpos, float ypos);
     void Dolly(float offset);
     void Truck(float xOffset, float yOffset);
+    // moves the camera to position and turns it to target, with +y up
+    void LookAt(glm::vec3 position, glm::vec3 target);
 
 protected:
     glm::mat4 m_projection_mat;
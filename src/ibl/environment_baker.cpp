@@ -0,0 +1,361 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include "ibl/environment_baker.h"
+#include "ibl/precompute.h"
+#include "ibl/prefilter_samples.h"
+#include "profiling/zones.h"
+#include "utility/primitives.h"
+#include "utility/resources.h"
+#include "utility/stb_image.h"
+
+namespace ibl
+{
+using utility::renderCube;
+
+namespace
+{
+// texture fetches per bake step, about a millisecond on modest hardware
+constexpr double MAX_STEP_WORK = 1.0e6;
+// pixels per upload step: the driver converts them to half floats on this thread, a few tenths of a millisecond
+constexpr double MAX_UPLOAD_STEP_PIXELS = 6.5e4;
+// steps this small say more about the fixed overhead than about the fetch rate
+constexpr double MIN_TIMED_WORK = 1.0e4;
+} // namespace
+
+EnvironmentBaker::~EnvironmentBaker()
+{
+    if (m_decode.valid()) m_decode.wait();
+    releasePending();
+    glDeleteTextures(1, &m_current.envCubemap);
+    glDeleteTextures(1, &m_current.irradianceMap);
+    glDeleteTextures(1, &m_current.prefilterMap);
+    for (const PendingTimer& timer : m_timers) glDeleteQueries(1, &timer.query);
+    if (!m_freeQueries.empty()) glDeleteQueries(static_cast<int>(m_freeQueries.size()), m_freeQueries.data());
+    glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+bool EnvironmentBaker::Initialize(const IBLSettings& settings)
+{
+    m_settings = settings;
+    makeCaptureMatrices(m_captureProjection, m_captureViews);
+    m_prefilterSampleCounts = PrefilterSampleCounts(settings.prefilterMipLevels, settings.prefilterSampleCount);
+
+    // the one face at a time path, a layered draw could not be split into steps
+    if (!m_equirectShader.Initialize(utility::ResourcePath("shader/cubemap.vert").c_str(), utility::ResourcePath("shader/equirectangular_to_cubemap.frag").c_str())) return false;
+    if (!m_irradianceShader.Initialize(utility::ResourcePath("shader/cubemap.vert").c_str(), utility::ResourcePath("shader/irradiance_convolution.frag").c_str())) return false;
+    if (!m_prefilterShader.Initialize(utility::ResourcePath("shader/cubemap.vert").c_str(), utility::ResourcePath("shader/prefilter.frag").c_str())) return false;
+
+    m_equirectShader.Use();
+    m_equirectShader.SetUniform("equirectangularMap", 0);
+    m_equirectShader.SetUniform("projection", m_captureProjection);
+    m_irradianceShader.Use();
+    m_irradianceShader.SetUniform("environmentMap", 0);
+    m_irradianceShader.SetUniform("projection", m_captureProjection);
+    m_irradianceShader.SetUniform("sampleDelta", settings.irradianceSampleDelta);
+    m_prefilterShader.Use();
+    m_prefilterShader.SetUniform("environmentMap", 0);
+    m_prefilterShader.SetUniform("projection", m_captureProjection);
+    m_prefilterShader.SetUniform("sourceResolution", (float)settings.environmentResolution);
+
+    // color only, the capture cube is seen from inside and needs no depth test
+    glGenFramebuffers(1, &m_framebuffer);
+    return true;
+}
+
+void EnvironmentBaker::Adopt(const EnvironmentMaps& maps)
+{
+    m_current = maps;
+}
+
+void EnvironmentBaker::Request(const std::string& hdrPath)
+{
+    // a decode can't be interrupted, its result is dropped once it arrives
+    if (m_decoding)
+    {
+        m_queuedPath = hdrPath;
+        return;
+    }
+    releasePending();
+    startDecode(hdrPath);
+}
+
+float EnvironmentBaker::GetProgress() const
+{
+    if (m_decoding) return 0.0f;
+    if (m_steps.empty()) return 1.0f;
+    return (float)m_nextStep / (float)m_steps.size();
+}
+
+bool EnvironmentBaker::Update(float budgetMilliseconds)
+{
+    collectTimings();
+    if (m_decoding)
+    {
+        if (m_decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+        DecodedImage image = m_decode.get();
+        m_decoding = false;
+        if (!m_queuedPath.empty())
+        {
+            std::string path = m_queuedPath;
+            m_queuedPath.clear();
+            startDecode(path);
+            return false;
+        }
+        if (!image.pixels)
+        {
+            std::cerr << "Failed to load HDR image " << m_pendingPath << ", keeping " << m_currentPath << std::endl;
+            return false;
+        }
+        beginBake(image);
+    }
+    if (m_steps.empty()) return false;
+
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glEnable(GL_SCISSOR_TEST);
+    double estimatedMilliseconds = 0.0;
+    for (unsigned int issued = 0; m_nextStep < m_steps.size(); ++issued)
+    {
+        const BakeStep& step = m_steps[m_nextStep];
+        double rate = m_millisecondsPerWork[static_cast<int>(step.type)];
+        double estimate = step.work * rate;
+        // until a step of the type was measured its cost is unknown, don't risk more than one step on it
+        if (issued > 0 && (rate == 0.0 || estimatedMilliseconds + estimate > budgetMilliseconds)) break;
+
+        if (step.type == StepType::Upload)
+        {
+            // the cost of an upload is the driver's conversion on this thread, not gpu time
+            auto start = std::chrono::steady_clock::now();
+            executeStep(step);
+            recordCost(step.type, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), step.work);
+        }
+        else
+        {
+            unsigned int query;
+            if (m_freeQueries.empty()) glGenQueries(1, &query);
+            else
+            {
+                query = m_freeQueries.back();
+                m_freeQueries.pop_back();
+            }
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            executeStep(step);
+            glEndQuery(GL_TIME_ELAPSED);
+            m_timers.push_back({ query, step.type, step.work });
+        }
+
+        estimatedMilliseconds += estimate;
+        ++m_nextStep;
+    }
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    if (m_nextStep < m_steps.size()) return false;
+    finishBake();
+    return true;
+}
+
+void EnvironmentBaker::startDecode(const std::string& hdrPath)
+{
+    m_pendingPath = hdrPath;
+    m_decoding = true;
+    // a dedicated thread rather than the shared pool: decoding takes far longer than a frame,
+    // and ParallelFor expects the pool's workers back within the frame
+    m_decode = std::async(std::launch::async, [hdrPath]()
+    {
+        PROFILE_THREAD_NAME("hdr decode");
+        PROFILE_ZONE("stbi_loadf");
+        DecodedImage image;
+        int nrComponents;
+        float* data = stbi_loadf(hdrPath.c_str(), &image.width, &image.height, &nrComponents, 3);
+        if (data) image.pixels.reset(data, stbi_image_free);
+        return image;
+    });
+}
+
+void EnvironmentBaker::beginBake(const DecodedImage& image)
+{
+    m_image = image;
+    unsigned int envSize = m_settings.environmentResolution;
+
+    glGenTextures(1, &m_hdrTexture);
+    glBindTexture(GL_TEXTURE_2D, m_hdrTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB16F, image.width, image.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    auto createCubemap = [](unsigned int& texture, unsigned int levels, unsigned int size)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, GL_RGB16F, size, size);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    };
+    unsigned int envLevels = static_cast<unsigned int>(std::log2(envSize)) + 1;
+    createCubemap(m_pending.envCubemap, envLevels, envSize);
+    createCubemap(m_pending.irradianceMap, 1, m_settings.irradianceResolution);
+    createCubemap(m_pending.prefilterMap, m_settings.prefilterMipLevels, m_settings.prefilterResolution);
+
+    m_steps.clear();
+    m_nextStep = 0;
+    unsigned int uploadRows = std::max(1u, static_cast<unsigned int>(MAX_UPLOAD_STEP_PIXELS / image.width));
+    for (unsigned int row = 0; row < static_cast<unsigned int>(image.height); row += uploadRows)
+    {
+        BakeStep step{ StepType::Upload };
+        step.rowBegin = row;
+        step.rowEnd = std::min(row + uploadRows, static_cast<unsigned int>(image.height));
+        step.work = static_cast<double>(step.rowEnd - step.rowBegin) * image.width;
+        m_steps.push_back(step);
+    }
+    for (unsigned int face = 0; face < 6; ++face) addSteps(StepType::Equirect, face, 0, envSize, 1.0);
+    BakeStep mipmaps{ StepType::EnvMipmaps };
+    mipmaps.work = 2.0 * envSize * envSize; // 6 faces * 4 fetches * 1/3 of the texels
+    m_steps.push_back(mipmaps);
+
+    const double PI = 3.14159265359;
+    double irradianceSamples = (2.0 * PI / m_settings.irradianceSampleDelta) * (0.5 * PI / m_settings.irradianceSampleDelta);
+    for (unsigned int face = 0; face < 6; ++face) addSteps(StepType::Irradiance, face, 0, m_settings.irradianceResolution, irradianceSamples);
+    for (unsigned int mip = 0; mip < m_settings.prefilterMipLevels; ++mip)
+        for (unsigned int face = 0; face < 6; ++face)
+            addSteps(StepType::Prefilter, face, mip, std::max(m_settings.prefilterResolution >> mip, 1u), m_prefilterSampleCounts[mip]);
+}
+
+// splits one face into bands of rows of at most MAX_STEP_WORK fetches
+void EnvironmentBaker::addSteps(StepType type, unsigned int face, unsigned int mip, unsigned int size, double workPerTexel)
+{
+    double rowWork = size * workPerTexel;
+    unsigned int rowsPerStep = std::min(size, std::max(1u, static_cast<unsigned int>(MAX_STEP_WORK / rowWork)));
+    for (unsigned int row = 0; row < size; row += rowsPerStep)
+    {
+        BakeStep step{ type };
+        step.face = face;
+        step.mip = mip;
+        step.rowBegin = row;
+        step.rowEnd = std::min(row + rowsPerStep, size);
+        step.work = (step.rowEnd - step.rowBegin) * rowWork;
+        m_steps.push_back(step);
+    }
+}
+
+void EnvironmentBaker::executeStep(const BakeStep& step)
+{
+#ifdef GLPBR_PROFILING
+    static const char* const stepNames[] = { "bake upload", "bake equirect", "bake env mipmaps", "bake irradiance", "bake prefilter" };
+    PROFILE_ZONE(stepNames[static_cast<int>(step.type)]);
+#endif
+    switch (step.type)
+    {
+    case StepType::Upload:
+        glBindTexture(GL_TEXTURE_2D, m_hdrTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, step.rowBegin, m_image.width, step.rowEnd - step.rowBegin, GL_RGB, GL_FLOAT, m_image.pixels.get() + 3 * static_cast<size_t>(step.rowBegin) * m_image.width);
+        // the driver has its copy once the last rows are in
+        if (step.rowEnd == static_cast<unsigned int>(m_image.height)) m_image.pixels.reset();
+        break;
+    case StepType::Equirect:
+        m_equirectShader.Use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_hdrTexture);
+        drawFaceRows(m_equirectShader, m_pending.envCubemap, step, m_settings.environmentResolution);
+        break;
+    case StepType::EnvMipmaps:
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_pending.envCubemap);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        break;
+    case StepType::Irradiance:
+        m_irradianceShader.Use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_pending.envCubemap);
+        drawFaceRows(m_irradianceShader, m_pending.irradianceMap, step, m_settings.irradianceResolution);
+        break;
+    case StepType::Prefilter:
+    {
+        float roughness = m_settings.prefilterMipLevels > 1 ? (float)step.mip / (float)(m_settings.prefilterMipLevels - 1) : 0.0f;
+        m_prefilterShader.Use();
+        m_prefilterShader.SetUniform("roughness", roughness);
+        m_prefilterShader.SetUniform("sampleCount", m_prefilterSampleCounts[step.mip]);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_pending.envCubemap);
+        drawFaceRows(m_prefilterShader, m_pending.prefilterMap, step, std::max(m_settings.prefilterResolution >> step.mip, 1u));
+        break;
+    }
+    }
+}
+
+void EnvironmentBaker::drawFaceRows(shader::Shader& shader, unsigned int texture, const BakeStep& step, unsigned int size)
+{
+    shader.SetUniform("view", m_captureViews[step.face]);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + step.face, texture, step.mip);
+    glViewport(0, 0, size, size);
+    glScissor(0, step.rowBegin, size, step.rowEnd - step.rowBegin);
+    renderCube();
+}
+
+// reads the timer queries that finished without waiting and updates the gpu cost per unit of work of their step type
+void EnvironmentBaker::collectTimings()
+{
+    for (size_t i = 0; i < m_timers.size();)
+    {
+        int available = 0;
+        glGetQueryObjectiv(m_timers[i].query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            ++i;
+            continue;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(m_timers[i].query, GL_QUERY_RESULT, &nanoseconds);
+        recordCost(m_timers[i].type, nanoseconds * 1e-6, m_timers[i].work);
+        m_freeQueries.push_back(m_timers[i].query);
+        m_timers[i] = m_timers.back();
+        m_timers.pop_back();
+    }
+}
+
+void EnvironmentBaker::recordCost(StepType type, double milliseconds, double work)
+{
+    if (work < MIN_TIMED_WORK) return;
+    double& average = m_millisecondsPerWork[static_cast<int>(type)];
+    average = average == 0.0 ? milliseconds / work : 0.75 * average + 0.25 * milliseconds / work;
+}
+
+void EnvironmentBaker::finishBake()
+{
+    glDeleteTextures(1, &m_current.envCubemap);
+    glDeleteTextures(1, &m_current.irradianceMap);
+    glDeleteTextures(1, &m_current.prefilterMap);
+    m_current = m_pending;
+    m_currentPath = m_pendingPath;
+    m_pending = EnvironmentMaps();
+
+    glDeleteTextures(1, &m_hdrTexture);
+    m_hdrTexture = 0;
+    m_image = DecodedImage();
+    m_steps.clear();
+    m_nextStep = 0;
+}
+
+// drops a bake that has not finished, the current maps are untouched
+void EnvironmentBaker::releasePending()
+{
+    glDeleteTextures(1, &m_pending.envCubemap);
+    glDeleteTextures(1, &m_pending.irradianceMap);
+    glDeleteTextures(1, &m_pending.prefilterMap);
+    m_pending = EnvironmentMaps();
+    glDeleteTextures(1, &m_hdrTexture);
+    m_hdrTexture = 0;
+    m_image = DecodedImage();
+    m_steps.clear();
+    m_nextStep = 0;
+}
+} // namespace ibl
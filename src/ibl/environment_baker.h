@@ -0,0 +1,122 @@
+#pragma once
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ibl/ibl_settings.h"
+#include "shader/shader.h"
+
+namespace ibl
+{
+
+// the environment dependent IBL textures, the BRDF LUT is shared by every environment
+struct EnvironmentMaps
+{
+    unsigned int envCubemap = 0;
+    unsigned int irradianceMap = 0;
+    unsigned int prefilterMap = 0;
+};
+
+// Switches environment maps at runtime without a startup sized hitch.
+// The HDR is decoded on a background thread, then uploaded and baked in small steps (row bands of
+// one cubemap face or mip) spread over the following frames, each frame spending no more than its
+// budget of estimated gpu time. The current maps stay bound the whole time; the new ones replace
+// all three together on the frame the last step is issued.
+class EnvironmentBaker
+{
+public:
+    ~EnvironmentBaker();
+
+    bool Initialize(const IBLSettings& settings);
+    // takes ownership of maps baked elsewhere, e.g. by precompute at startup
+    void Adopt(const EnvironmentMaps& maps);
+
+    // starts baking the environment, replacing a bake that is still in progress
+    void Request(const std::string& hdrPath);
+    // runs bake steps until budgetMilliseconds of estimated time is used (cpu time for uploads, gpu time for
+    // the rest), at least one step per call.
+    // returns true on the frame the new maps became current
+    bool Update(float budgetMilliseconds);
+
+    inline const EnvironmentMaps& GetMaps() const { return m_current; }
+    inline bool IsBaking() const { return m_decoding || !m_steps.empty(); }
+    // fraction of the steps of the pending bake that are issued
+    float GetProgress() const;
+    inline const std::string& GetPath() const { return m_currentPath; }
+
+private:
+    enum class StepType
+    {
+        Upload,      // rows of the equirectangular HDR
+        Equirect,    // rows of an environment cubemap face
+        EnvMipmaps,
+        Irradiance,  // rows of an irradiance face
+        Prefilter    // rows of a prefilter face at one mip
+    };
+    static constexpr int kStepTypeCount = 5;
+
+    struct BakeStep
+    {
+        StepType type;
+        unsigned int face = 0;
+        unsigned int mip = 0;
+        unsigned int rowBegin = 0;
+        unsigned int rowEnd = 0;
+        double work = 0.0; // texture fetches, pixels for Upload; converted to milliseconds with the measured rate of the type
+    };
+
+    struct DecodedImage
+    {
+        std::shared_ptr<float> pixels; // rgb
+        int width = 0;
+        int height = 0;
+    };
+
+    struct PendingTimer
+    {
+        unsigned int query = 0;
+        StepType type;
+        double work = 0.0;
+    };
+
+    void startDecode(const std::string& hdrPath);
+    void beginBake(const DecodedImage& image);
+    void addSteps(StepType type, unsigned int face, unsigned int mip, unsigned int size, double workPerTexel);
+    void executeStep(const BakeStep& step);
+    void drawFaceRows(shader::Shader& shader, unsigned int texture, const BakeStep& step, unsigned int size);
+    void collectTimings();
+    void recordCost(StepType type, double milliseconds, double work);
+    void finishBake();
+    void releasePending();
+
+    IBLSettings m_settings;
+    shader::Shader m_equirectShader;
+    shader::Shader m_irradianceShader;
+    shader::Shader m_prefilterShader;
+    unsigned int m_framebuffer = 0;
+    glm::mat4 m_captureProjection;
+    glm::mat4 m_captureViews[6];
+    std::vector<unsigned int> m_prefilterSampleCounts;
+
+    EnvironmentMaps m_current;
+    std::string m_currentPath;
+
+    // bake in progress
+    std::string m_pendingPath;
+    std::string m_queuedPath; // requested while the previous decode was still running
+    std::future<DecodedImage> m_decode;
+    bool m_decoding = false;
+    DecodedImage m_image;
+    unsigned int m_hdrTexture = 0;
+    EnvironmentMaps m_pending;
+    std::vector<BakeStep> m_steps;
+    size_t m_nextStep = 0;
+
+    // measured cost of one unit of step work per step type: cpu time of an upload pixel, gpu time of a fetch.
+    // 0 until a step of the type was measured, Update then issues no more than one such step per frame
+    double m_millisecondsPerWork[kStepTypeCount] = {};
+    std::vector<PendingTimer> m_timers;
+    std::vector<unsigned int> m_freeQueries;
+};
+} // namespace ibl
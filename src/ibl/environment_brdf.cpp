@@ -0,0 +1,142 @@
+#include "ibl/environment_brdf.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace ibl
+{
+
+namespace
+{
+constexpr float PI = 3.14159265359f;
+
+// same bit reversal as RadicalInverse_VdC in common/sampling.glsl
+float radicalInverse(uint32_t bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return static_cast<float>(bits) * 2.3283064365386963e-10f;
+}
+
+// Schlick-GGX with the IBL k of brdf.frag
+float geometrySchlickGGX(float NdotV, float roughness)
+{
+    float k = roughness * roughness / 2.0f;
+    return NdotV / (NdotV * (1.0f - k) + k);
+}
+} // namespace
+
+const char* GetEnvironmentBRDFName(EnvironmentBRDF method)
+{
+    switch (method)
+    {
+        case EnvironmentBRDF::Karis: return "karis";
+        case EnvironmentBRDF::Polynomial: return "polynomial";
+        default: return "lut";
+    }
+}
+
+bool ParseEnvironmentBRDF(const char* name, EnvironmentBRDF& method)
+{
+    for (EnvironmentBRDF candidate : { EnvironmentBRDF::LUT, EnvironmentBRDF::Karis, EnvironmentBRDF::Polynomial })
+    {
+        if (std::strcmp(name, GetEnvironmentBRDFName(candidate)) == 0)
+        {
+            method = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+glm::vec2 IntegrateEnvironmentBRDF(float NdotV, float roughness, unsigned int sampleCount)
+{
+    // N is +z, V lies in the xz plane
+    glm::vec3 V(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+    float a = roughness * roughness;
+    float scale = 0.0f;
+    float bias = 0.0f;
+    for (unsigned int i = 0; i < sampleCount; ++i)
+    {
+        float phi = 2.0f * PI * static_cast<float>(i) / sampleCount;
+        float xi = radicalInverse(i);
+        float cosTheta = std::sqrt((1.0f - xi) / (1.0f + (a * a - 1.0f) * xi));
+        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+        glm::vec3 H(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+        glm::vec3 L = glm::normalize(2.0f * glm::dot(V, H) * H - V);
+
+        float NdotL = std::max(L.z, 0.0f);
+        float NdotH = std::max(H.z, 0.0f);
+        float VdotH = std::max(glm::dot(V, H), 0.0f);
+        if (NdotL > 0.0f)
+        {
+            float G = geometrySchlickGGX(NdotV, roughness) * geometrySchlickGGX(NdotL, roughness);
+            float G_Vis = (G * VdotH) / (NdotH * NdotV);
+            float Fc = std::pow(1.0f - VdotH, 5.0f);
+            scale += (1.0f - Fc) * G_Vis;
+            bias += Fc * G_Vis;
+        }
+    }
+    return glm::vec2(scale, bias) / static_cast<float>(sampleCount);
+}
+
+glm::vec2 KarisEnvironmentBRDF(float NdotV, float roughness)
+{
+    // EnvBRDFApprox, must match environmentBRDF in the lighting shaders
+    const glm::vec4 c0(-1.0f, -0.0275f, -0.572f, 0.022f);
+    const glm::vec4 c1(1.0f, 0.0425f, 1.04f, -0.04f);
+    glm::vec4 r = roughness * c0 + c1;
+    float a004 = std::min(r.x * r.x, std::exp2(-9.28f * NdotV)) * r.x + r.y;
+    return glm::vec2(-1.04f, 1.04f) * a004 + glm::vec2(r.z, r.w);
+}
+
+glm::vec2 EvaluatePolynomialEnvironmentBRDF(const glm::vec2* coefficients, float NdotV, float roughness)
+{
+    // Horner in roughness per power of sqrt(NdotV), the same order the shaders use
+    float s = std::sqrt(NdotV);
+    glm::vec2 result(0.0f);
+    float sPower = 1.0f;
+    for (unsigned int i = 0; i <= kPolynomialDegree; ++i)
+    {
+        const glm::vec2* row = coefficients + i * (kPolynomialDegree + 1);
+        glm::vec2 value = row[kPolynomialDegree];
+        for (int j = kPolynomialDegree - 1; j >= 0; --j) value = value * roughness + row[j];
+        result += value * sPower;
+        sPower *= s;
+    }
+    return result;
+}
+
+bool WriteBRDFLUT(const char* path, unsigned int width, unsigned int height, const std::vector<glm::vec2>& texels)
+{
+    FILE* file = std::fopen(path, "wb");
+    if (!file) return false;
+    uint32_t size[2] = { width, height };
+    bool written = std::fwrite(size, sizeof(size), 1, file) == 1
+        && std::fwrite(texels.data(), sizeof(glm::vec2), texels.size(), file) == texels.size();
+    std::fclose(file);
+    return written;
+}
+
+bool ReadBRDFLUT(const char* path, unsigned int& width, unsigned int& height, std::vector<glm::vec2>& texels)
+{
+    FILE* file = std::fopen(path, "rb");
+    if (!file) return false;
+    uint32_t size[2];
+    bool read = std::fread(size, sizeof(size), 1, file) == 1 && size[0] > 0 && size[1] > 0 && size[0] <= 16384 && size[1] <= 16384;
+    if (read)
+    {
+        width = size[0];
+        height = size[1];
+        texels.resize(static_cast<size_t>(width) * height);
+        read = std::fread(texels.data(), sizeof(glm::vec2), texels.size(), file) == texels.size();
+    }
+    std::fclose(file);
+    return read;
+}
+} // namespace ibl
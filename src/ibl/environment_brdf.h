@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace ibl
+{
+
+// how the lighting shaders get the split-sum scale and bias of the specular IBL term
+enum class EnvironmentBRDF
+{
+    LUT,       // brdfLUT baked by renderBRDFLUT
+    Karis,     // the mobile approximation of "Physically Based Shading on Mobile", no fitting
+    Polynomial // least squares fit of the LUT by the brdf_fit tool, kPolynomialDegree in sqrt(NdotV) and roughness
+};
+
+const char* GetEnvironmentBRDFName(EnvironmentBRDF method);
+bool ParseEnvironmentBRDF(const char* name, EnvironmentBRDF& method);
+
+constexpr unsigned int kPolynomialDegree = 4;
+constexpr unsigned int kPolynomialTermCount = (kPolynomialDegree + 1) * (kPolynomialDegree + 1);
+
+// CPU port of IntegrateBRDF in brdf.frag: (scale, bias) applied to F0
+glm::vec2 IntegrateEnvironmentBRDF(float NdotV, float roughness, unsigned int sampleCount);
+glm::vec2 KarisEnvironmentBRDF(float NdotV, float roughness);
+// coefficients[i * (kPolynomialDegree + 1) + j] multiplies sqrt(NdotV)^i * roughness^j
+glm::vec2 EvaluatePolynomialEnvironmentBRDF(const glm::vec2* coefficients, float NdotV, float roughness);
+
+// LUT dump: width and height as uint32, then width * height (scale, bias) float pairs,
+// row major with NdotV along a row and roughness across rows, like the texture
+bool WriteBRDFLUT(const char* path, unsigned int width, unsigned int height, const std::vector<glm::vec2>& texels);
+bool ReadBRDFLUT(const char* path, unsigned int& width, unsigned int& height, std::vector<glm::vec2>& texels);
+} // namespace ibl
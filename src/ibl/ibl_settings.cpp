@@ -0,0 +1,84 @@
+#include "ibl/ibl_settings.h"
+#include <cstring>
+#include "ibl/prefilter_samples.h"
+
+namespace ibl
+{
+
+IBLSettings GetIBLPreset(IBLQuality quality)
+{
+    IBLSettings settings;
+    switch (quality)
+    {
+    case IBLQuality::Fast:
+        settings.environmentResolution = 256;
+        settings.irradianceResolution = 16;
+        settings.irradianceSampleDelta = 0.05f;
+        settings.prefilterResolution = 64;
+        settings.prefilterMipLevels = 5;
+        settings.prefilterSampleCount = 256;
+        settings.brdfLUTResolution = 128;
+        settings.brdfSampleCount = 256;
+        break;
+    case IBLQuality::Balanced:
+        break;
+    case IBLQuality::Quality:
+        settings.environmentResolution = 1024;
+        settings.irradianceResolution = 32;
+        settings.irradianceSampleDelta = 0.0125f;
+        settings.prefilterResolution = 256;
+        settings.prefilterMipLevels = 6;
+        settings.prefilterSampleCount = 4096;
+        settings.brdfLUTResolution = 512;
+        settings.brdfSampleCount = 2048;
+        break;
+    }
+    return settings;
+}
+
+const char* GetIBLQualityName(IBLQuality quality)
+{
+    switch (quality)
+    {
+    case IBLQuality::Fast: return "fast";
+    case IBLQuality::Balanced: return "balanced";
+    case IBLQuality::Quality: return "quality";
+    }
+    return "unknown";
+}
+
+bool ParseIBLQuality(const char* name, IBLQuality& quality)
+{
+    for (IBLQuality candidate : { IBLQuality::Fast, IBLQuality::Balanced, IBLQuality::Quality })
+    {
+        if (std::strcmp(name, GetIBLQualityName(candidate)) == 0)
+        {
+            quality = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+double EstimateBakeWork(const IBLSettings& settings)
+{
+    const double PI = 3.14159265359;
+    double faceTexels = 6.0 * settings.environmentResolution * settings.environmentResolution;
+    // equirectangular lookup plus the mip chain generation
+    double work = faceTexels * 4.0 / 3.0;
+
+    double irradianceSamples = (2.0 * PI / settings.irradianceSampleDelta) * (0.5 * PI / settings.irradianceSampleDelta);
+    work += 6.0 * settings.irradianceResolution * settings.irradianceResolution * irradianceSamples;
+
+    std::vector<unsigned int> counts = PrefilterSampleCounts(settings.prefilterMipLevels, settings.prefilterSampleCount);
+    for (unsigned int mip = 0; mip < settings.prefilterMipLevels; ++mip)
+    {
+        double size = settings.prefilterResolution >> mip;
+        work += 6.0 * size * size * counts[mip];
+    }
+
+    // the split-sum terms and the average energy take brdfSampleCount samples each
+    work += 2.0 * settings.brdfLUTResolution * settings.brdfLUTResolution * settings.brdfSampleCount;
+    return work;
+}
+} // namespace ibl
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace ibl
+{
+
+enum class IBLQuality
+{
+    Fast,     // kiosk class hardware, bakes in a fraction of the balanced time
+    Balanced, // the original hardcoded sizes
+    Quality
+};
+
+// resolutions and sample counts of the four bake passes
+struct IBLSettings
+{
+    unsigned int environmentResolution = 512; // cubemap face size, also the prefilter source resolution
+    unsigned int irradianceResolution = 32;
+    float irradianceSampleDelta = 0.025f;     // hemisphere step in radians, irradiance_convolution.frag
+    unsigned int prefilterResolution = 128;   // mip 0 face size
+    unsigned int prefilterMipLevels = 5;      // roughness 0 .. 1, shading reads lod roughness * (mipLevels - 1)
+    unsigned int prefilterSampleCount = 1024; // per texel of the rough mips, see PrefilterSampleCount
+    unsigned int brdfLUTResolution = 512;
+    unsigned int brdfSampleCount = 1024;
+};
+
+IBLSettings GetIBLPreset(IBLQuality quality);
+const char* GetIBLQualityName(IBLQuality quality);
+bool ParseIBLQuality(const char* name, IBLQuality& quality);
+
+// texture fetches of a whole bake, used to scale a measured bake time to another preset
+double EstimateBakeWork(const IBLSettings& settings);
+} // namespace ibl
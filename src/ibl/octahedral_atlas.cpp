@@ -0,0 +1,197 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <glm/glm.hpp>
+#include "ibl/octahedral_atlas.h"
+#include "utility/resources.h"
+
+namespace ibl
+{
+
+namespace
+{
+// must match octahedral_encode.comp
+constexpr unsigned int ENCODE_LOCAL_SIZE = 8;
+// octahedral tile size relative to the cubemap face size
+constexpr unsigned int OCTAHEDRAL_SCALE = 2;
+} // namespace
+
+const char* GetOctahedralFormatName(OctahedralFormat format)
+{
+    switch (format)
+    {
+        case OctahedralFormat::RGB9E5: return "rgb9e5";
+        default: return "r11g11b10f";
+    }
+}
+
+bool ParseOctahedralFormat(const char* name, OctahedralFormat& format)
+{
+    if (std::strcmp(name, "r11g11b10f") == 0) format = OctahedralFormat::R11G11B10F;
+    else if (std::strcmp(name, "rgb9e5") == 0) format = OctahedralFormat::RGB9E5;
+    else return false;
+    return true;
+}
+
+OctahedralAtlas::~OctahedralAtlas()
+{
+    if (m_texture != 0) glDeleteTextures(1, &m_texture);
+}
+
+bool OctahedralAtlas::Initialize(const IBLSettings& settings, unsigned int slotCount, OctahedralFormat format)
+{
+    if (settings.prefilterMipLevels > kMaxMipLevels)
+    {
+        std::cerr << "Octahedral atlas supports at most " << kMaxMipLevels << " prefilter mip levels" << std::endl;
+        return false;
+    }
+    if (!m_encodeShader.InitializeCompute(utility::ResourcePath("shader/octahedral_encode.comp").c_str())) return false;
+    m_settings = settings;
+    m_format = format;
+    m_slotCount = slotCount;
+
+    // mip 0 fills the height of the slot, the smaller tiles are stacked in columns to its right
+    for (unsigned int mip = 0; mip < settings.prefilterMipLevels; ++mip)
+    {
+        m_prefilterTiles[mip].size = OCTAHEDRAL_SCALE * std::max(settings.prefilterResolution >> mip, 1u);
+    }
+    m_irradianceTile.size = OCTAHEDRAL_SCALE * settings.irradianceResolution;
+    m_slotHeight = std::max(m_prefilterTiles[0].size, m_irradianceTile.size) + 2;
+    m_width = 0;
+    unsigned int columnWidth = 0;
+    unsigned int y = m_slotHeight;
+    auto place = [&](Tile& tile)
+    {
+        if (y + tile.size + 2 > m_slotHeight)
+        {
+            m_width += columnWidth;
+            columnWidth = 0;
+            y = 0;
+        }
+        tile.x = m_width;
+        tile.y = y;
+        y += tile.size + 2;
+        columnWidth = std::max(columnWidth, tile.size + 2);
+    };
+    for (unsigned int mip = 0; mip < settings.prefilterMipLevels; ++mip) place(m_prefilterTiles[mip]);
+    place(m_irradianceTile);
+    m_width += columnWidth;
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, format == OctahedralFormat::RGB9E5 ? GL_RGB9_E5 : GL_R11F_G11F_B10F, m_width, m_slotHeight * slotCount);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void OctahedralAtlas::Store(unsigned int slot, unsigned int irradianceMap, unsigned int prefilterMap)
+{
+    // RGB9E5 can't be an image, encode into a scratch of the slot's size and let the upload convert it
+    bool converted = m_format == OctahedralFormat::RGB9E5;
+    unsigned int target = m_texture;
+    unsigned int baseY = slot * m_slotHeight;
+    if (converted)
+    {
+        glGenTextures(1, &target);
+        glBindTexture(GL_TEXTURE_2D, target);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, m_width, m_slotHeight);
+        baseY = 0;
+    }
+
+    m_encodeShader.Use();
+    m_encodeShader.SetUniform("environmentMap", 0);
+    glBindImageTexture(0, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, converted ? GL_RGBA16F : GL_R11F_G11F_B10F);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+    for (unsigned int mip = 0; mip < m_settings.prefilterMipLevels; ++mip)
+    {
+        encodeTile(static_cast<float>(mip), m_prefilterTiles[mip], baseY);
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+    encodeTile(0.0f, m_irradianceTile, baseY);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    if (converted)
+    {
+        // the round trip goes through a pixel buffer, the data never leaves the gpu
+        unsigned int pixelBuffer;
+        glGenBuffers(1, &pixelBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<size_t>(m_width) * m_slotHeight * 3 * sizeof(float), nullptr, GL_STREAM_COPY);
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, target);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_FLOAT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glBindTexture(GL_TEXTURE_2D, m_texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slot * m_slotHeight, m_width, m_slotHeight, GL_RGB, GL_FLOAT, nullptr);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &pixelBuffer);
+        glDeleteTextures(1, &target);
+    }
+    else
+    {
+        // make the image writes visible to later texture fetches
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OctahedralAtlas::Bind(shader::Shader& shader, unsigned int slot) const
+{
+    glActiveTexture(GL_TEXTURE0 + ATLAS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    // rects are the inner area of a tile in texels: xy origin, z size
+    unsigned int baseY = slot * m_slotHeight;
+    shader.SetUniform("octahedralIBL", true);
+    shader.SetUniform("iblAtlas", ATLAS_TEXTURE_UNIT);
+    shader.SetUniform("iblAtlasSize", glm::vec2(m_width, m_slotHeight * m_slotCount));
+    for (unsigned int mip = 0; mip < m_settings.prefilterMipLevels; ++mip)
+    {
+        const Tile& tile = m_prefilterTiles[mip];
+        shader.SetUniform(("iblAtlasPrefilterRects[" + std::to_string(mip) + "]").c_str(), glm::vec3(tile.x + 1, baseY + tile.y + 1, tile.size));
+    }
+    shader.SetUniform("iblAtlasIrradianceRect", glm::vec3(m_irradianceTile.x + 1, baseY + m_irradianceTile.y + 1, m_irradianceTile.size));
+}
+
+void OctahedralAtlas::BindDisabled(shader::Shader& shader)
+{
+    // the sampler still needs a unit of its own, samplers of different types can't share one
+    shader.SetUniform("octahedralIBL", false);
+    shader.SetUniform("iblAtlas", ATLAS_TEXTURE_UNIT);
+}
+
+size_t OctahedralAtlas::GetMemoryBytes() const
+{
+    return static_cast<size_t>(m_width) * m_slotHeight * m_slotCount * 4;
+}
+
+void OctahedralAtlas::encodeTile(float lod, const Tile& tile, unsigned int baseY)
+{
+    m_encodeShader.SetUniform("sourceLod", lod);
+    m_encodeShader.SetUniform("tileOrigin", glm::vec2(tile.x, baseY + tile.y));
+    m_encodeShader.SetUniform("tileSize", tile.size);
+    unsigned int groups = (tile.size + 2 + ENCODE_LOCAL_SIZE - 1) / ENCODE_LOCAL_SIZE;
+    glDispatchCompute(groups, groups, 1);
+}
+
+size_t EstimateCubemapMemoryBytes(const IBLSettings& settings)
+{
+    size_t bytes = static_cast<size_t>(settings.irradianceResolution) * settings.irradianceResolution * 6 * 8;
+    for (unsigned int mip = 0; mip < settings.prefilterMipLevels; ++mip)
+    {
+        size_t size = std::max(settings.prefilterResolution >> mip, 1u);
+        bytes += size * size * 6 * 8;
+    }
+    return bytes;
+}
+} // namespace ibl
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include "ibl/ibl_settings.h"
+#include "shader/shader.h"
+
+namespace ibl
+{
+
+enum class EnvironmentStorage
+{
+    Cubemap,   // the baked RGB16F / RGBA16F cubemaps are sampled directly
+    Octahedral // the baked cubemaps are resampled into an OctahedralAtlas
+};
+
+enum class OctahedralFormat
+{
+    R11G11B10F, // 4 bytes, written directly by the encode shader
+    RGB9E5      // 4 bytes, shared exponent, more mantissa for saturated colors. Not renderable or
+                // image storable, so it is encoded to a RGBA16F scratch and converted on upload
+};
+
+const char* GetOctahedralFormatName(OctahedralFormat format);
+bool ParseOctahedralFormat(const char* name, OctahedralFormat& format);
+
+// Irradiance and prefiltered radiance of several environments (or probes) in one 2D texture,
+// each direction mapped to a square through the octahedral projection.
+// A slot is one row of the atlas holding the prefilter mips and the irradiance map. Every
+// tile has a one texel gutter holding the texels across the folded octahedron edge, so bilinear
+// filtering is seamless; the mips are tiles rather than texture levels, the shaders blend two of them.
+// The tiles are twice the cubemap face size, that is 4/6 of the cubemap texels at 4 bytes instead of 6 or 8.
+class OctahedralAtlas
+{
+public:
+    static constexpr int ATLAS_TEXTURE_UNIT = 13;
+    static constexpr unsigned int kMaxMipLevels = 8; // size of iblAtlasPrefilterRects in the lighting shaders
+
+    ~OctahedralAtlas();
+
+    bool Initialize(const IBLSettings& settings, unsigned int slotCount, OctahedralFormat format);
+    // resamples the cubemaps baked with the settings passed to Initialize into the slot
+    void Store(unsigned int slot, unsigned int irradianceMap, unsigned int prefilterMap);
+
+    // binds the atlas and sets the uniforms so the shader currently in use reads the slot instead of the cubemaps
+    void Bind(shader::Shader& shader, unsigned int slot) const;
+    // sets the uniforms so the shader reads the cubemaps
+    static void BindDisabled(shader::Shader& shader);
+
+    inline unsigned int GetTexture() const { return m_texture; }
+    inline OctahedralFormat GetFormat() const { return m_format; }
+    size_t GetMemoryBytes() const;
+
+private:
+    // tile origin (including the gutter) and inner size, in texels relative to the slot
+    struct Tile
+    {
+        unsigned int x = 0;
+        unsigned int y = 0;
+        unsigned int size = 0;
+    };
+
+    void encodeTile(float lod, const Tile& tile, unsigned int baseY);
+
+    shader::Shader m_encodeShader;
+    IBLSettings m_settings;
+    OctahedralFormat m_format = OctahedralFormat::R11G11B10F;
+    unsigned int m_texture = 0;
+    unsigned int m_width = 0;
+    unsigned int m_slotHeight = 0;
+    unsigned int m_slotCount = 0;
+    Tile m_prefilterTiles[kMaxMipLevels];
+    Tile m_irradianceTile;
+};
+
+// bytes of the irradiance and prefilter cubemaps, RGB16F is counted as the RGBA16F drivers allocate for it
+size_t EstimateCubemapMemoryBytes(const IBLSettings& settings);
+} // namespace ibl
@@ -0,0 +1,442 @@
+#include <glad/glad.h>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include "ibl/precompute.h"
+#include "ibl/prefilter_samples.h"
+#include "profiling/profiler.h"
+#include "profiling/zones.h"
+#include "shader/shader.h"
+#include "utility/primitives.h"
+#include "utility/resources.h"
+#include "utility/stb_image.h"
+
+namespace ibl
+{
+using shader::Shader;
+using utility::renderCube;
+using utility::renderQuad;
+
+namespace
+{
+// must match prefilter.comp
+constexpr unsigned int PREFILTER_LOCAL_SIZE = 8;
+constexpr unsigned int PREFILTER_SAMPLE_BUFFER_BINDING = 3;
+// must match cubemap_layered.geom
+constexpr unsigned int CAPTURE_MATRICES_BINDING = 0;
+
+// attaches every face of the cubemap mip and clears it, ready for a single renderCube()
+void beginLayeredCapture(const LayeredCapture& layered, unsigned int cubemap, unsigned int mip)
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAPTURE_MATRICES_BINDING, layered.matricesBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, layered.framebuffer);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, cubemap, mip);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+shader::ShaderFuture initializeCaptureShader(Shader& shader, const char* fragmentShaderPath, CaptureMethod captureMethod)
+{
+    if (captureMethod == CaptureMethod::Layered) return shader.InitializeAsync(utility::ResourcePath("shader/cubemap_layered.vert").c_str(), utility::ResourcePath("shader/cubemap_layered.geom").c_str(), fragmentShaderPath);
+    return shader.InitializeAsync(utility::ResourcePath("shader/cubemap.vert").c_str(), fragmentShaderPath);
+}
+} // namespace
+
+void PrecomputeShaders::BeginInitialize(PrefilterMethod prefilterMethod, CaptureMethod captureMethod, bool bakeBRDFLUT)
+{
+    this->prefilterMethod = prefilterMethod;
+    this->captureMethod = captureMethod;
+    this->bakeBRDFLUT = bakeBRDFLUT;
+    m_compiling.push_back(initializeCaptureShader(equirectangularToCubemap, utility::ResourcePath("shader/equirectangular_to_cubemap.frag").c_str(), captureMethod));
+    m_compiling.push_back(initializeCaptureShader(irradiance, utility::ResourcePath("shader/irradiance_convolution.frag").c_str(), captureMethod));
+    if (prefilterMethod == PrefilterMethod::Compute) m_compiling.push_back(prefilter.InitializeComputeAsync(utility::ResourcePath("shader/prefilter.comp").c_str()));
+    else m_compiling.push_back(initializeCaptureShader(prefilter, utility::ResourcePath("shader/prefilter.frag").c_str(), captureMethod));
+    if (bakeBRDFLUT) m_compiling.push_back(brdf.InitializeAsync(utility::ResourcePath("shader/brdf.vert").c_str(), utility::ResourcePath("shader/brdf.frag").c_str()));
+}
+
+bool PrecomputeShaders::Wait()
+{
+    if (m_compiling.empty()) return m_ready;
+    m_ready = shader::WaitForShaders(m_compiling);
+    return m_ready;
+}
+
+void makeCaptureMatrices(glm::mat4& captureProjection, glm::mat4 captureViews[6])
+{
+    captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+    captureViews[0] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+    captureViews[1] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+    captureViews[2] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f));
+    captureViews[3] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f));
+    captureViews[4] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+    captureViews[5] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+}
+
+LayeredCapture CreateLayeredCapture(const glm::mat4& captureProjection, const glm::mat4 captureViews[6])
+{
+    LayeredCapture capture;
+    glGenFramebuffers(1, &capture.framebuffer);
+
+    glm::mat4 matrices[7];
+    matrices[0] = captureProjection;
+    for (int i = 0; i < 6; ++i) matrices[i + 1] = captureViews[i];
+    glGenBuffers(1, &capture.matricesBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, capture.matricesBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(matrices), matrices, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return capture;
+}
+
+void DestroyLayeredCapture(LayeredCapture& capture)
+{
+    glDeleteFramebuffers(1, &capture.framebuffer);
+    glDeleteBuffers(1, &capture.matricesBuffer);
+    capture = LayeredCapture();
+}
+
+void precompute(unsigned int& envCubemap, unsigned int& irradianceMap, unsigned int &prefilterMap, unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const char* hdrPath, const IBLSettings& settings, PrefilterMethod prefilterMethod/* = PrefilterMethod::Compute */, CaptureMethod captureMethod/* = CaptureMethod::Layered */, bool bakeBRDFLUT/* = true */, PrecomputeShaders* shaders/* = nullptr */)
+{
+    PrecomputeShaders ownShaders;
+    if (!shaders)
+    {
+        ownShaders.BeginInitialize(prefilterMethod, captureMethod, bakeBRDFLUT);
+        shaders = &ownShaders;
+    }
+    assert(shaders->prefilterMethod == prefilterMethod && shaders->captureMethod == captureMethod && (shaders->bakeBRDFLUT || !bakeBRDFLUT));
+    assert(shaders->Wait());
+
+    LayeredCapture layeredCapture;
+    const LayeredCapture* layered = nullptr;
+    if (captureMethod == CaptureMethod::Layered)
+    {
+        layeredCapture = CreateLayeredCapture(captureProjection, captureViews);
+        layered = &layeredCapture;
+    }
+
+    {
+        profiling::ProfileScope scope("ibl equirect");
+        equirectangularToCubemapShader(shaders->equirectangularToCubemap, envCubemap, captureFBO, captureRBO, captureProjection, captureViews, hdrPath, settings, layered);
+    }
+    {
+        profiling::ProfileScope scope("ibl irradiance");
+        renderIrradianceCubemap(shaders->irradiance, irradianceMap, envCubemap, captureFBO, captureRBO, captureProjection, captureViews, settings, layered);
+    }
+    {
+        profiling::ProfileScope scope("ibl prefilter");
+        if (prefilterMethod == PrefilterMethod::Compute)
+            renderPrefilterCubemapCompute(shaders->prefilter, prefilterMap, envCubemap, settings);
+        else
+            renderPrefilterCubemap(shaders->prefilter, prefilterMap, envCubemap, captureFBO, captureRBO, captureProjection, captureViews, settings, layered);
+    }
+    // the analytic environment BRDF approximations need no LUT
+    if (bakeBRDFLUT)
+    {
+        profiling::ProfileScope scope("ibl brdf lut");
+        renderBRDFLUT(shaders->brdf, brdfLUTTexture, captureFBO, captureRBO, settings);
+    }
+    else brdfLUTTexture = 0;
+
+    if (layered) DestroyLayeredCapture(layeredCapture);
+}
+
+IBLQuality precomputeWithinBudget(float budgetMilliseconds, unsigned int& envCubemap, unsigned int& irradianceMap, unsigned int &prefilterMap, unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const char* hdrPath, PrefilterMethod prefilterMethod/* = PrefilterMethod::Compute */, CaptureMethod captureMethod/* = CaptureMethod::Layered */, bool bakeBRDFLUT/* = true */, PrecomputeShaders* shaders/* = nullptr */)
+{
+    // both bakes share the programs
+    PrecomputeShaders ownShaders;
+    if (!shaders)
+    {
+        ownShaders.BeginInitialize(prefilterMethod, captureMethod, bakeBRDFLUT);
+        shaders = &ownShaders;
+    }
+
+    // the fast bake doubles as the measurement and as the fallback when nothing better fits
+    const IBLSettings fastSettings = GetIBLPreset(IBLQuality::Fast);
+    auto start = std::chrono::steady_clock::now();
+    precompute(envCubemap, irradianceMap, prefilterMap, brdfLUTTexture, captureFBO, captureRBO, captureProjection, captureViews, hdrPath, fastSettings, prefilterMethod, captureMethod, bakeBRDFLUT, shaders);
+    glFinish();
+    double fastMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // scaling the whole measured time, HDR decoding and shader compilation included, by the texture fetch
+    // ratio overestimates the better presets, so the choice errs on the side of the budget
+    double remainingMilliseconds = budgetMilliseconds - fastMilliseconds;
+    double fastWork = EstimateBakeWork(fastSettings);
+    IBLQuality selected = IBLQuality::Fast;
+    for (IBLQuality candidate : { IBLQuality::Balanced, IBLQuality::Quality })
+    {
+        double estimatedMilliseconds = fastMilliseconds * EstimateBakeWork(GetIBLPreset(candidate)) / fastWork;
+        if (estimatedMilliseconds <= remainingMilliseconds) selected = candidate;
+    }
+    std::cout << "IBL: fast bake " << fastMilliseconds << " ms of " << budgetMilliseconds << " ms budget, using " << GetIBLQualityName(selected) << std::endl;
+
+    if (selected != IBLQuality::Fast)
+    {
+        unsigned int textures[] = { envCubemap, irradianceMap, prefilterMap, brdfLUTTexture };
+        glDeleteTextures(4, textures);
+        precompute(envCubemap, irradianceMap, prefilterMap, brdfLUTTexture, captureFBO, captureRBO, captureProjection, captureViews, hdrPath, GetIBLPreset(selected), prefilterMethod, captureMethod, bakeBRDFLUT, shaders);
+    }
+    return selected;
+}
+
+void equirectangularToCubemapShader(Shader& equirectangularToCubemapShader, unsigned int& envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const char* hdrPath, const IBLSettings& settings, const LayeredCapture* layered/* = nullptr */)
+{
+    // pbr: load the HDR environment map
+    // ---------------------------------
+    int width, height, nrComponents;
+    float *data;
+    {
+        PROFILE_ZONE("stbi_loadf");
+        data = stbi_loadf(hdrPath, &width, &height, &nrComponents, 0);
+    }
+    unsigned int hdrTexture = 0;
+    if (data)
+    {
+        glGenTextures(1, &hdrTexture);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); // note how we specify the texture's data value to be float
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(data);
+    }
+    else
+    {
+        std::cout << "Failed to load HDR image " << hdrPath << "." << std::endl;
+    }
+
+    // pbr: setup cubemap to render to and attach to framebuffer
+    // ---------------------------------------------------------
+    glGenTextures(1, &envCubemap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, settings.environmentResolution, settings.environmentResolution, 0, GL_RGB, GL_FLOAT, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); 
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // pbr: convert HDR equirectangular environment map to cubemap equivalent
+    // ----------------------------------------------------------------------
+    equirectangularToCubemapShader.Use();
+    equirectangularToCubemapShader.SetUniform("equirectangularMap", 0);
+    equirectangularToCubemapShader.SetUniform("projection", captureProjection);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+
+    glViewport(0, 0, settings.environmentResolution, settings.environmentResolution); // don't forget to configure the viewport to the capture dimensions.
+    if (layered)
+    {
+        beginLayeredCapture(*layered, envCubemap, 0);
+        renderCube();
+    }
+    else
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, settings.environmentResolution, settings.environmentResolution);
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            equirectangularToCubemapShader.SetUniform("view", captureViews[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            renderCube();
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // then let OpenGL generate mipmaps from first mip face (combatting visible dots artifact)
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    glDeleteTextures(1, &hdrTexture);
+}
+
+void renderIrradianceCubemap(Shader& irradianceShader, unsigned int& irradianceMap, unsigned int envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const IBLSettings& settings, const LayeredCapture* layered/* = nullptr */)
+{
+    // pbr: create an irradiance cubemap, and re-scale capture FBO to irradiance scale.
+    // --------------------------------------------------------------------------------
+    glGenTextures(1, &irradianceMap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, settings.irradianceResolution, settings.irradianceResolution, 0, GL_RGB, GL_FLOAT, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // pbr: solve diffuse integral by convolution to create an irradiance (cube)map.
+    // -----------------------------------------------------------------------------
+    irradianceShader.Use();
+    irradianceShader.SetUniform("environmentMap", 0);
+    irradianceShader.SetUniform("projection", captureProjection);
+    irradianceShader.SetUniform("sampleDelta", settings.irradianceSampleDelta);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+
+    glViewport(0, 0, settings.irradianceResolution, settings.irradianceResolution); // don't forget to configure the viewport to the capture dimensions.
+    if (layered)
+    {
+        beginLayeredCapture(*layered, irradianceMap, 0);
+        renderCube();
+    }
+    else
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, settings.irradianceResolution, settings.irradianceResolution);
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            irradianceShader.SetUniform("view", captureViews[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            renderCube();
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void renderPrefilterCubemap(Shader& prefilterShader, unsigned int &prefilterMap, unsigned int envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const IBLSettings& settings, const LayeredCapture* layered/* = nullptr */)
+{
+    glGenTextures(1, &prefilterMap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, settings.prefilterResolution, settings.prefilterResolution, 0, GL_RGB, GL_FLOAT, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // be sure to set minification filter to mip_linear 
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, settings.prefilterMipLevels - 1);
+    // generate mipmaps for the cubemap so OpenGL automatically allocates the required memory.
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+    // pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map.
+    // ----------------------------------------------------------------------------------------------------
+    prefilterShader.Use();
+    prefilterShader.SetUniform("environmentMap", 0);
+    prefilterShader.SetUniform("projection", captureProjection);
+    prefilterShader.SetUniform("sourceResolution", (float)settings.environmentResolution);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+
+    unsigned int maxMipLevels = settings.prefilterMipLevels;
+    for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
+    {
+        // reisze framebuffer according to mip-level size.
+        unsigned int mipWidth = settings.prefilterResolution >> mip;
+        unsigned int mipHeight = settings.prefilterResolution >> mip;
+        glViewport(0, 0, mipWidth, mipHeight);
+
+        float roughness = (float)mip / (float)(maxMipLevels - 1);
+        prefilterShader.SetUniform("roughness", roughness);
+        prefilterShader.SetUniform("sampleCount", PrefilterSampleCount(roughness, settings.prefilterSampleCount));
+        if (layered)
+        {
+            beginLayeredCapture(*layered, prefilterMap, mip);
+            renderCube();
+            continue;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            prefilterShader.SetUniform("view", captureViews[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, prefilterMap, mip);
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderCube();
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void renderPrefilterCubemapCompute(Shader& prefilterShader, unsigned int &prefilterMap, unsigned int envCubemap, const IBLSettings& settings)
+{
+    // image load/store has no RGB16F format, so this path stores RGBA16F
+    const unsigned int maxMipLevels = settings.prefilterMipLevels;
+    glGenTextures(1, &prefilterMap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, maxMipLevels, GL_RGBA16F, settings.prefilterResolution, settings.prefilterResolution);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // the sample directions and source mip levels only depend on the roughness, compute them once.
+    // the mirror mip needs a single sample
+    std::vector<unsigned int> sampleCounts = PrefilterSampleCounts(maxMipLevels, settings.prefilterSampleCount);
+    PrefilterSampleSet sampleSet = GeneratePrefilterSamples(sampleCounts, settings.environmentResolution);
+    unsigned int sampleBuffer;
+    glGenBuffers(1, &sampleBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sampleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sampleSet.samples.size() * sizeof(glm::vec4), sampleSet.samples.data(), GL_STATIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PREFILTER_SAMPLE_BUFFER_BINDING, sampleBuffer);
+
+    prefilterShader.Use();
+    prefilterShader.SetUniform("environmentMap", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+
+    for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
+    {
+        unsigned int mipSize = settings.prefilterResolution >> mip;
+        prefilterShader.SetUniform("mipSize", mipSize);
+        prefilterShader.SetUniform("sampleOffset", sampleSet.offsets[mip]);
+        prefilterShader.SetUniform("sampleCount", sampleSet.counts[mip]);
+        prefilterShader.SetUniform("invTotalWeight", 1.0f / sampleSet.weightSums[mip]);
+        // all six faces at once through a layered image binding, no framebuffer or depth buffer involved
+        glBindImageTexture(0, prefilterMap, mip, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        unsigned int groups = (mipSize + PREFILTER_LOCAL_SIZE - 1) / PREFILTER_LOCAL_SIZE;
+        glDispatchCompute(groups, groups, 6);
+    }
+    // make the image writes visible to later texture fetches
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PREFILTER_SAMPLE_BUFFER_BINDING, 0);
+    glDeleteBuffers(1, &sampleBuffer);
+}
+
+void renderBRDFLUT(Shader& brdfShader, unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO, const IBLSettings& settings)
+{
+    glGenTextures(1, &brdfLUTTexture);
+
+    // pre-allocate enough memory for the LUT texture.
+    glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
+    // rg: split-sum scale and bias, b: average energy of the roughness for the multi-scatter compensation
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, settings.brdfLUTResolution, settings.brdfLUTResolution, 0, GL_RGB, GL_FLOAT, 0);
+    // be sure to set wrapping mode to GL_CLAMP_TO_EDGE
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // then re-configure capture framebuffer object and render screen-space quad with BRDF shader.
+    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, settings.brdfLUTResolution, settings.brdfLUTResolution);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
+
+    glViewport(0, 0, settings.brdfLUTResolution, settings.brdfLUTResolution);
+    brdfShader.Use();
+    brdfShader.SetUniform("sampleCount", settings.brdfSampleCount);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderQuad();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+} // namespace ibl
@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "ibl/ibl_settings.h"
+#include "shader/shader.h"
+
+namespace ibl
+{
+
+enum class PrefilterMethod
+{
+    Fragment, // one draw per face and mip through prefilter.frag
+    Compute   // one dispatch per mip through prefilter.comp, samples precomputed on the CPU
+};
+
+enum class CaptureMethod
+{
+    PerFace, // attach, clear and draw each cubemap face separately
+    Layered  // attach the whole cubemap, one instanced geometry shader draw fills all six faces
+};
+
+// resources of the layered capture path
+struct LayeredCapture
+{
+    unsigned int framebuffer = 0;    // color only, every attachment of a layered framebuffer has to be layered
+    unsigned int matricesBuffer = 0; // std140 CaptureMatrices { mat4 captureProjection; mat4 captureViews[6]; }
+};
+
+// the programs of a bake for one prefilter and capture method, compiled once and shared by every precompute call
+struct PrecomputeShaders
+{
+    shader::Shader equirectangularToCubemap;
+    shader::Shader irradiance;
+    shader::Shader prefilter; // prefilter.frag or prefilter.comp
+    shader::Shader brdf;      // only compiled when the BRDF LUT is baked
+
+    PrefilterMethod prefilterMethod = PrefilterMethod::Compute;
+    CaptureMethod captureMethod = CaptureMethod::Layered;
+    bool bakeBRDFLUT = true;
+
+    // starts compiling without waiting for the driver
+    void BeginInitialize(PrefilterMethod prefilterMethod, CaptureMethod captureMethod, bool bakeBRDFLUT);
+    // waits for the programs started by BeginInitialize, returns false when one failed
+    bool Wait();
+
+private:
+    std::vector<shader::ShaderFuture> m_compiling;
+    bool m_ready = false;
+};
+
+// 90 degree projection and the view of each cubemap face, in GL face order
+void makeCaptureMatrices(glm::mat4& captureProjection, glm::mat4 captureViews[6]);
+
+LayeredCapture CreateLayeredCapture(const glm::mat4& captureProjection, const glm::mat4 captureViews[6]);
+void DestroyLayeredCapture(LayeredCapture& capture);
+
+// shaders may come from an earlier PrecomputeShaders::BeginInitialize with the same methods, when null the programs are compiled here
+void precompute(unsigned int& envCubemap, unsigned int& irradianceMap, unsigned int &prefilterMap, unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const char* hdrPath, const IBLSettings& settings, PrefilterMethod prefilterMethod = PrefilterMethod::Compute, CaptureMethod captureMethod = CaptureMethod::Layered, bool bakeBRDFLUT = true, PrecomputeShaders* shaders = nullptr);
+// bakes the fast preset to measure this machine, then re-bakes with the highest preset whose
+// estimated time still fits the rest of the budget; returns the preset the textures were baked with
+IBLQuality precomputeWithinBudget(float budgetMilliseconds, unsigned int& envCubemap, unsigned int& irradianceMap, unsigned int &prefilterMap, unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const char* hdrPath, PrefilterMethod prefilterMethod = PrefilterMethod::Compute, CaptureMethod captureMethod = CaptureMethod::Layered, bool bakeBRDFLUT = true, PrecomputeShaders* shaders = nullptr);
+// the shader of each pass comes from PrecomputeShaders and must be compiled for the same capture method
+void equirectangularToCubemapShader(shader::Shader& equirectangularToCubemapShader, unsigned int& envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const char* hdrPath, const IBLSettings& settings, const LayeredCapture* layered = nullptr);
+void renderIrradianceCubemap(shader::Shader& irradianceShader, unsigned int& irradianceMap, unsigned int envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const IBLSettings& settings, const LayeredCapture* layered = nullptr);
+void renderPrefilterCubemap(shader::Shader& prefilterShader, unsigned int &prefilterMap, unsigned int envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6], const IBLSettings& settings, const LayeredCapture* layered = nullptr);
+void renderPrefilterCubemapCompute(shader::Shader& prefilterShader, unsigned int &prefilterMap, unsigned int envCubemap, const IBLSettings& settings);
+void renderBRDFLUT(shader::Shader& brdfShader, unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO, const IBLSettings& settings);
+} // namespace ibl
@@ -0,0 +1,108 @@
+#include "ibl/prefilter_samples.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ibl
+{
+
+namespace
+{
+constexpr float PI = 3.14159265359f;
+} // namespace
+
+// http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
+// efficient VanDerCorpus calculation.
+float RadicalInverseVdC(unsigned int bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return float(bits) * 2.3283064365386963e-10f; // / 0x100000000
+}
+
+glm::vec2 Hammersley(unsigned int i, unsigned int N)
+{
+    return glm::vec2(float(i) / float(N), RadicalInverseVdC(i));
+}
+
+glm::vec3 ImportanceSampleGGX(glm::vec2 Xi, float roughness)
+{
+    float a = roughness * roughness;
+
+    float phi = 2.0f * PI * Xi.x;
+    float cosTheta = std::sqrt((1.0f - Xi.y) / (1.0f + (a * a - 1.0f) * Xi.y));
+    float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+    // from spherical coordinates to cartesian coordinates - halfway vector
+    return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+}
+
+float DistributionGGX(float NdotH, float roughness)
+{
+    float a = roughness * roughness;
+    float a_square = a * a;
+    float NdotH2 = NdotH * NdotH;
+
+    float denom = (NdotH2 * (a_square - 1.0f) + 1.0f);
+    denom = PI * denom * denom;
+
+    return a_square / denom;
+}
+
+PrefilterSampleSet GeneratePrefilterSamples(unsigned int mipLevels, unsigned int sampleCount, unsigned int sourceResolution)
+{
+    return GeneratePrefilterSamples(std::vector<unsigned int>(mipLevels, sampleCount), sourceResolution);
+}
+
+PrefilterSampleSet GeneratePrefilterSamples(const std::vector<unsigned int>& sampleCounts, unsigned int sourceResolution)
+{
+    PrefilterSampleSet set;
+    unsigned int mipLevels = static_cast<unsigned int>(sampleCounts.size());
+    float saTexel = 4.0f * PI / (6.0f * sourceResolution * sourceResolution);
+    for (unsigned int mip = 0; mip < mipLevels; ++mip)
+    {
+        float roughness = mipLevels > 1 ? (float)mip / (float)(mipLevels - 1) : 0.0f;
+        unsigned int sampleCount = sampleCounts[mip];
+        set.offsets.push_back(static_cast<unsigned int>(set.samples.size()));
+        float weightSum = 0.0f;
+        for (unsigned int i = 0; i < sampleCount; ++i)
+        {
+            glm::vec3 H = ImportanceSampleGGX(Hammersley(i, sampleCount), roughness);
+            // V = N = +Z, so L = reflect(-V, H)
+            glm::vec3 L = glm::normalize(2.0f * H.z * H - glm::vec3(0.0f, 0.0f, 1.0f));
+            float NdotL = L.z;
+            if (NdotL <= 0.0f) continue;
+
+            // sample from the environment's mip level based on roughness/pdf, NdotH == HdotV here.
+            // the fewer the samples, the larger the solid angle each one stands for and the blurrier the mip it reads
+            float pdf = DistributionGGX(H.z, roughness) / 4.0f + 0.0001f;
+            float saSample = 1.0f / (float(sampleCount) * pdf + 0.0001f);
+            float mipLevel = roughness == 0.0f ? 0.0f : std::max(0.5f * std::log2(saSample / saTexel), 0.0f);
+
+            set.samples.push_back(glm::vec4(L, mipLevel));
+            weightSum += NdotL;
+        }
+        set.counts.push_back(static_cast<unsigned int>(set.samples.size()) - set.offsets.back());
+        set.weightSums.push_back(weightSum);
+    }
+    return set;
+}
+
+unsigned int PrefilterSampleCount(float roughness, unsigned int sampleCount)
+{
+    return roughness == 0.0f ? 1 : sampleCount;
+}
+
+std::vector<unsigned int> PrefilterSampleCounts(unsigned int mipLevels, unsigned int sampleCount)
+{
+    std::vector<unsigned int> counts;
+    for (unsigned int mip = 0; mip < mipLevels; ++mip)
+    {
+        float roughness = mipLevels > 1 ? (float)mip / (float)(mipLevels - 1) : 0.0f;
+        counts.push_back(PrefilterSampleCount(roughness, sampleCount));
+    }
+    return counts;
+}
+} // namespace ibl
@@ -0,0 +1,39 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ibl
+{
+
+// GGX importance samples for the prefiltered environment map, one set per roughness mip.
+// With the N = V = R assumption every sample only depends on the roughness, so the
+// Hammersley point, the GGX half vector, the reflected direction and the source mip level
+// are computed once here instead of per texel.
+struct PrefilterSampleSet
+{
+    // xyz: tangent space light direction (z = NdotL), w: environment map mip level to sample
+    std::vector<glm::vec4> samples;
+    // per roughness mip, samples with NdotL <= 0 are already dropped
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> counts;
+    std::vector<float> weightSums; // sum of NdotL
+};
+
+// roughness of mip level i is i / (mipLevels - 1), sourceResolution is the environment cubemap face size
+PrefilterSampleSet GeneratePrefilterSamples(unsigned int mipLevels, unsigned int sampleCount, unsigned int sourceResolution);
+// same with one sample count per mip level
+PrefilterSampleSet GeneratePrefilterSamples(const std::vector<unsigned int>& sampleCounts, unsigned int sourceResolution);
+
+// Sample count of the prefilter mip of the given roughness: 1 at roughness 0, where every GGX sample is the
+// reflected direction, sampleCount for every other mip. Measured with src/tools/prefilter_error.cpp, 512 samples
+// are clearly worse than 1024 at roughness 0.25 .. 0.75, so the rough mips keep the full count and the mirror mip
+// is the whole saving: 25% of the fixed 1024 sample bake at the default settings
+unsigned int PrefilterSampleCount(float roughness, unsigned int sampleCount);
+std::vector<unsigned int> PrefilterSampleCounts(unsigned int mipLevels, unsigned int sampleCount);
+
+float RadicalInverseVdC(unsigned int bits);
+glm::vec2 Hammersley(unsigned int i, unsigned int N);
+// GGX distributed half vector around +Z
+glm::vec3 ImportanceSampleGGX(glm::vec2 Xi, float roughness);
+float DistributionGGX(float NdotH, float roughness);
+} // namespace ibl
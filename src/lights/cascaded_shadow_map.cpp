@@ -0,0 +1,264 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+#include "lights/cascaded_shadow_map.h"
+#include "utility/resources.h"
+
+namespace lights
+{
+
+namespace
+{
+// blend between logarithmic and uniform split distances
+constexpr float kSplitLambda = 0.75f;
+// the cached region is this much larger than the camera slice, so small camera moves reuse it
+constexpr float kGuardBand = 1.25f;
+} // namespace
+
+CascadedShadowMap::~CascadedShadowMap()
+{
+    if (m_depthTextureArray != 0)
+    {
+        glDeleteTextures(1, &m_depthTextureArray);
+        glDeleteFramebuffers(1, &m_framebuffer);
+        for (Cascade& cascade : m_cascades)
+        {
+            glDeleteQueries(1, &cascade.timerQuery);
+        }
+    }
+}
+
+bool CascadedShadowMap::Initialize(unsigned int resolution/* = 2048 */)
+{
+    if (!m_depthShader.Initialize(utility::ResourcePath("shader/shadow_depth.vert").c_str(), utility::ResourcePath("shader/depth_only.frag").c_str())) return false;
+    m_resolution = resolution;
+
+    glGenTextures(1, &m_depthTextureArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTextureArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, kCascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    // linear filtering with compare mode gives 2x2 hardware PCF per tap
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (Cascade& cascade : m_cascades)
+    {
+        glGenQueries(1, &cascade.timerQuery);
+    }
+    return true;
+}
+
+void CascadedShadowMap::SetLight(const DirectionalLight& light)
+{
+    if (glm::normalize(light.direction) != glm::normalize(m_light.direction))
+    {
+        Invalidate();
+    }
+    m_light = light;
+}
+
+void CascadedShadowMap::Invalidate()
+{
+    for (Cascade& cascade : m_cascades)
+    {
+        cascade.fitted = false;
+        cascade.dirty = true;
+    }
+}
+
+void CascadedShadowMap::Update(object3ds::Model& model, const glm::mat4& view, const glm::mat4& projection)
+{
+    collectTimings();
+
+    // recover the frustum of glm::perspective
+    float near = projection[3][2] / (projection[2][2] - 1.0f);
+    float far = projection[3][2] / (projection[2][2] + 1.0f);
+    float tanHalfX = 1.0f / projection[0][0];
+    float tanHalfY = 1.0f / projection[1][1];
+    glm::mat4 invView = glm::inverse(view);
+
+    glm::vec3 lightDirection = glm::normalize(m_light.direction);
+    glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+
+    // the depth range has to contain every caster of the scene, not only the ones inside the slice
+    glm::vec3 boundsMin = model.GetBoundsMin();
+    glm::vec3 boundsMax = model.GetBoundsMax();
+    float sceneNear = std::numeric_limits<float>::max();
+    float sceneFar = std::numeric_limits<float>::lowest();
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec3 point((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z);
+        float depth = -(lightView * glm::vec4(point, 1.0f)).z;
+        sceneNear = std::min(sceneNear, depth);
+        sceneFar = std::max(sceneFar, depth);
+    }
+    float depthPadding = 0.01f * (sceneFar - sceneNear) + 0.01f;
+    sceneNear -= depthPadding;
+    sceneFar += depthPadding;
+
+    float splitNear = near;
+    for (unsigned int i = 0; i < kCascadeCount; ++i)
+    {
+        Cascade& cascade = m_cascades[i];
+        float t = static_cast<float>(i + 1) / kCascadeCount;
+        float splitFar = kSplitLambda * near * std::pow(far / near, t) + (1.0f - kSplitLambda) * (near + (far - near) * t);
+        cascade.splitFar = splitFar;
+
+        // bounding sphere of the slice, it only depends on the split distances and the fov
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            float depth = (corner & 4) ? splitFar : splitNear;
+            corners[corner] = glm::vec3(((corner & 1) ? 1.0f : -1.0f) * depth * tanHalfX, ((corner & 2) ? 1.0f : -1.0f) * depth * tanHalfY, -depth);
+            center += corners[corner] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (const glm::vec3& corner : corners)
+        {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+        splitNear = splitFar;
+
+        glm::vec3 lightSpaceCenter = lightView * (invView * glm::vec4(center, 1.0f));
+        bool contained = cascade.fitted
+            && std::abs(lightSpaceCenter.x - cascade.center.x) + radius <= cascade.extent
+            && std::abs(lightSpaceCenter.y - cascade.center.y) + radius <= cascade.extent;
+        if (contained) continue;
+
+        // re-center, snapping the origin to whole texels keeps the rasterization stable
+        cascade.extent = radius * kGuardBand;
+        cascade.texelWorldSize = 2.0f * cascade.extent / m_resolution;
+        cascade.center = glm::floor(glm::vec2(lightSpaceCenter.x, lightSpaceCenter.y) / cascade.texelWorldSize) * cascade.texelWorldSize;
+        glm::mat4 lightProjection = glm::ortho(cascade.center.x - cascade.extent, cascade.center.x + cascade.extent,
+            cascade.center.y - cascade.extent, cascade.center.y + cascade.extent, sceneNear, sceneFar);
+        cascade.lightSpaceMatrix = lightProjection * lightView;
+        cascade.fitted = true;
+        cascade.dirty = true;
+    }
+
+    // re-render the stale cascades, near ones first, within the frame budget
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_resolution, m_resolution);
+    glEnable(GL_DEPTH_CLAMP); // casters in front of the near plane still cast shadows
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    m_depthShader.Use();
+    m_depthShader.SetUniform("model", glm::mat4(1.0f));
+
+    double plannedMilliseconds = 0.0;
+    for (unsigned int i = 0; i < kCascadeCount; ++i)
+    {
+        Cascade& cascade = m_cascades[i];
+        if (!cascade.dirty)
+        {
+            ++cascade.stats.cachedCount;
+            continue;
+        }
+        double estimate = cascade.stats.averageGpuMilliseconds;
+        if (i > 0 && cascade.hasContent && plannedMilliseconds + estimate > m_frameBudgetMilliseconds)
+        {
+            ++cascade.stats.deferredCount;
+            continue;
+        }
+        plannedMilliseconds += estimate;
+        renderCascade(model, i);
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void CascadedShadowMap::Bind(shader::Shader& shader) const
+{
+    glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTextureArray);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.SetUniform("shadowMap", SHADOW_MAP_TEXTURE_UNIT);
+    shader.SetUniform("shadowTexelSize", 1.0f / m_resolution);
+    shader.SetUniform("sunDirection", glm::normalize(m_light.direction));
+    shader.SetUniform("sunRadiance", m_light.color * m_light.intensity);
+    for (unsigned int i = 0; i < kCascadeCount; ++i)
+    {
+        std::string index = "[" + std::to_string(i) + "]";
+        shader.SetUniform(("cascadeMatrices" + index).c_str(), m_cascades[i].renderedMatrix);
+        shader.SetUniform(("cascadeSplits" + index).c_str(), m_cascades[i].splitFar);
+        shader.SetUniform(("cascadeTexelWorldSizes" + index).c_str(), m_cascades[i].renderedTexelWorldSize);
+    }
+}
+
+void CascadedShadowMap::BindDisabled(shader::Shader& shader)
+{
+    // the sampler still needs a unit of its own, samplers of different types can't share one
+    shader.SetUniform("shadowMap", SHADOW_MAP_TEXTURE_UNIT);
+    shader.SetUniform("sunRadiance", glm::vec3(0.0f));
+}
+
+void CascadedShadowMap::renderCascade(object3ds::Model& model, unsigned int index)
+{
+    Cascade& cascade = m_cascades[index];
+    // a query still in flight keeps its object, skip timing this render rather than waiting for it
+    bool timed = !cascade.queryPending;
+    if (timed) glBeginQuery(GL_TIME_ELAPSED, cascade.timerQuery);
+
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTextureArray, 0, index);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    m_depthShader.SetUniform("lightSpaceMatrix", cascade.lightSpaceMatrix);
+    model.DrawGeometry();
+
+    if (timed)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        cascade.queryPending = true;
+    }
+    cascade.renderedMatrix = cascade.lightSpaceMatrix;
+    cascade.renderedTexelWorldSize = cascade.texelWorldSize;
+    cascade.hasContent = true;
+    cascade.dirty = false;
+    ++cascade.stats.renderCount;
+}
+
+void CascadedShadowMap::collectTimings()
+{
+    m_resolvedGpuMilliseconds = 0.0;
+    for (Cascade& cascade : m_cascades)
+    {
+        if (!cascade.queryPending) continue;
+        int available = 0;
+        glGetQueryObjectiv(cascade.timerQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(cascade.timerQuery, GL_QUERY_RESULT, &nanoseconds);
+        cascade.queryPending = false;
+
+        double milliseconds = nanoseconds / 1.0e6;
+        CascadeStats& stats = cascade.stats;
+        stats.lastGpuMilliseconds = milliseconds;
+        stats.averageGpuMilliseconds = stats.averageGpuMilliseconds == 0.0 ? milliseconds : 0.9 * stats.averageGpuMilliseconds + 0.1 * milliseconds;
+        m_resolvedGpuMilliseconds += milliseconds;
+    }
+}
+} // namespace lights
@@ -0,0 +1,89 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "lights/light.h"
+#include "object3ds/model.h"
+#include "shader/shader.h"
+
+namespace lights
+{
+
+struct CascadeStats
+{
+    double lastGpuMilliseconds = 0.0;    // cost of the most recent re-render
+    double averageGpuMilliseconds = 0.0; // exponential moving average of the re-render cost
+    unsigned int renderCount = 0;        // frames the cascade was re-rendered
+    unsigned int cachedCount = 0;        // frames the cached depth was reused
+    unsigned int deferredCount = 0;      // frames a stale cascade was postponed to respect the budget
+};
+
+// directional light shadows split into kCascadeCount cascades stored in one depth texture array.
+// Each cascade is fitted with a bounding sphere, so its size does not change when the camera rotates,
+// and its origin is snapped to whole texels, so the shadow edges don't shimmer when the camera moves.
+// All geometry of the scene is static: a cascade keeps its cached depth until the light moves or the
+// camera slice leaves the guard band around the cached region.
+class CascadedShadowMap
+{
+public:
+    static constexpr unsigned int kCascadeCount = 4;
+    static constexpr int SHADOW_MAP_TEXTURE_UNIT = 15;
+
+    ~CascadedShadowMap();
+
+    bool Initialize(unsigned int resolution = 2048);
+
+    void SetLight(const DirectionalLight& light);
+    inline const DirectionalLight& GetLight() const { return m_light; }
+    // max gpu time spent re-rendering cascades in one frame, stale far cascades beyond it wait a frame
+    inline void SetFrameBudget(double milliseconds) { m_frameBudgetMilliseconds = milliseconds; }
+    // forces every cascade to be re-rendered, needed when the geometry changes
+    void Invalidate();
+
+    // fits the cascades to the camera frustum and re-renders the stale ones
+    void Update(object3ds::Model& model, const glm::mat4& view, const glm::mat4& projection);
+
+    // binds the shadow map and sets the sun and cascade uniforms on the shader currently in use
+    void Bind(shader::Shader& shader) const;
+    // sets the uniforms so the shader runs without sun and shadows
+    static void BindDisabled(shader::Shader& shader);
+
+    inline const CascadeStats& GetStats(unsigned int cascade) const { return m_cascades[cascade].stats; }
+    // gpu time of the cascade re-renders whose timer queries resolved during the last Update,
+    // the queries are read one or more frames late so reading them never stalls
+    inline double GetResolvedGpuMilliseconds() const { return m_resolvedGpuMilliseconds; }
+
+private:
+    struct Cascade
+    {
+        // region the cascade should cover
+        glm::mat4 lightSpaceMatrix = glm::mat4(1.0f);
+        glm::vec2 center = glm::vec2(0.0f); // light space center
+        float extent = 0.0f;                 // half size
+        float texelWorldSize = 0.0f;
+        float splitFar = 0.0f;               // far view depth covered by the cascade
+        bool fitted = false;
+        bool dirty = true;
+
+        // region the depth layer currently holds, the shaders sample with these
+        glm::mat4 renderedMatrix = glm::mat4(1.0f);
+        float renderedTexelWorldSize = 0.0f;
+        bool hasContent = false;
+
+        unsigned int timerQuery = 0;
+        bool queryPending = false;
+        CascadeStats stats;
+    };
+
+    void renderCascade(object3ds::Model& model, unsigned int index);
+    void collectTimings();
+
+    DirectionalLight m_light;
+    Cascade m_cascades[kCascadeCount];
+    shader::Shader m_depthShader;
+
+    unsigned int m_resolution = 0;
+    unsigned int m_depthTextureArray = 0;
+    unsigned int m_framebuffer = 0;
+    double m_frameBudgetMilliseconds = 2.0;
+    double m_resolvedGpuMilliseconds = 0.0;
+};
+} // namespace lights
@@ -0,0 +1,218 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "lights/cluster_grid.h"
+#include "profiling/zones.h"
+
+namespace lights
+{
+
+namespace
+{
+int sliceFromDepth(float depth, float near, float far)
+{
+    float slice = std::log(depth / near) / std::log(far / near) * ClusteredLightGrid::kSlicesZ;
+    return std::clamp(static_cast<int>(std::floor(slice)), 0, static_cast<int>(ClusteredLightGrid::kSlicesZ) - 1);
+}
+
+int tileFromNDC(float ndc, unsigned int tileCount)
+{
+    int tile = static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * tileCount));
+    return std::clamp(tile, 0, static_cast<int>(tileCount) - 1);
+}
+} // namespace
+
+ClusteredLightGrid::~ClusteredLightGrid()
+{
+    if (m_lightBuffer != 0)
+    {
+        glDeleteBuffers(1, &m_lightBuffer);
+        glDeleteBuffers(1, &m_clusterBuffer);
+        glDeleteBuffers(1, &m_lightIndexBuffer);
+    }
+}
+
+bool ClusteredLightGrid::Initialize()
+{
+    glGenBuffers(1, &m_lightBuffer);
+    glGenBuffers(1, &m_clusterBuffer);
+    glGenBuffers(1, &m_lightIndexBuffer);
+    m_clusters.assign(kClusterCount, glm::uvec2(0, 0));
+    m_sliceIndices.resize(kSlicesZ);
+    upload({});
+    return true;
+}
+
+void ClusteredLightGrid::Update(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // recover the clip planes of glm::perspective
+    m_near = projection[3][2] / (projection[2][2] - 1.0f);
+    m_far = projection[3][2] / (projection[2][2] + 1.0f);
+
+    computeLightBounds(lights, view, projection);
+    // every slice owns its clusters, so the slices can be binned without synchronization
+    m_threadPool.ParallelFor(kSlicesZ, [this](size_t begin, size_t end)
+    {
+        PROFILE_ZONE("bin slices");
+        for (size_t slice = begin; slice < end; ++slice)
+        {
+            binSlice(static_cast<unsigned int>(slice));
+        }
+    });
+
+    // stitch the per slice lists together
+    m_lightIndices.clear();
+    for (unsigned int slice = 0; slice < kSlicesZ; ++slice)
+    {
+        uint32_t base = static_cast<uint32_t>(m_lightIndices.size());
+        for (unsigned int tile = 0; tile < kTilesX * kTilesY; ++tile)
+        {
+            m_clusters[slice * kTilesX * kTilesY + tile].x += base;
+        }
+        m_lightIndices.insert(m_lightIndices.end(), m_sliceIndices[slice].begin(), m_sliceIndices[slice].end());
+    }
+
+    upload(lights);
+    m_binningMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ClusteredLightGrid::Bind(shader::Shader& shader) const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BUFFER_BINDING, m_lightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BUFFER_BINDING, m_clusterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BUFFER_BINDING, m_lightIndexBuffer);
+
+    // slice = floor(log(depth) * scale - bias)
+    float logRatio = std::log(m_far / m_near);
+    shader.SetUniform("clusterDims", glm::vec3(kTilesX, kTilesY, kSlicesZ));
+    shader.SetUniform("clusterZScale", kSlicesZ / logRatio);
+    shader.SetUniform("clusterZBias", kSlicesZ * std::log(m_near) / logRatio);
+}
+
+void ClusteredLightGrid::computeLightBounds(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection)
+{
+    size_t count = lights.size();
+    m_minX.resize(count); m_maxX.resize(count);
+    m_minY.resize(count); m_maxY.resize(count);
+    m_minZ.resize(count); m_maxZ.resize(count);
+    m_visible.resize(count);
+
+    float scaleX = projection[0][0];
+    float scaleY = projection[1][1];
+    m_threadPool.ParallelFor(count, [&](size_t begin, size_t end)
+    {
+        PROFILE_ZONE("light bounds");
+        for (size_t i = begin; i < end; ++i)
+        {
+            glm::vec3 center = view * glm::vec4(glm::vec3(lights[i].positionRange), 1.0f);
+            float radius = lights[i].positionRange.w;
+            float depth = -center.z;
+            m_visible[i] = depth + radius > m_near && depth - radius < m_far;
+            if (!m_visible[i]) continue;
+
+            m_minZ[i] = sliceFromDepth(std::max(depth - radius, m_near), m_near, m_far);
+            m_maxZ[i] = sliceFromDepth(std::min(depth + radius, m_far), m_near, m_far);
+
+            if (depth - radius <= m_near)
+            {
+                // the sphere crosses the near plane, its projection is unbounded
+                m_minX[i] = 0; m_maxX[i] = kTilesX - 1;
+                m_minY[i] = 0; m_maxY[i] = kTilesY - 1;
+                continue;
+            }
+            // project the view space bounding box, x / depth is extremal at the box corners
+            float nearDepth = depth - radius;
+            float farDepth = depth + radius;
+            auto projectedRange = [nearDepth, farDepth](float c, float r, float scale, float& lo, float& hi)
+            {
+                float a = (c - r) / nearDepth, b = (c - r) / farDepth;
+                float d = (c + r) / nearDepth, e = (c + r) / farDepth;
+                lo = std::min(std::min(a, b), std::min(d, e)) * scale;
+                hi = std::max(std::max(a, b), std::max(d, e)) * scale;
+            };
+            float loX, hiX, loY, hiY;
+            projectedRange(center.x, radius, scaleX, loX, hiX);
+            projectedRange(center.y, radius, scaleY, loY, hiY);
+            if (hiX < -1.0f || loX > 1.0f || hiY < -1.0f || loY > 1.0f)
+            {
+                m_visible[i] = false;
+                continue;
+            }
+            m_minX[i] = tileFromNDC(loX, kTilesX); m_maxX[i] = tileFromNDC(hiX, kTilesX);
+            m_minY[i] = tileFromNDC(loY, kTilesY); m_maxY[i] = tileFromNDC(hiY, kTilesY);
+        }
+    });
+}
+
+void ClusteredLightGrid::binSlice(unsigned int slice)
+{
+    // lights overlapping this depth slice, in structure of arrays form
+    std::vector<uint32_t> candidates;
+    std::vector<int32_t> minX, maxX, minY, maxY;
+    for (size_t i = 0; i < m_visible.size(); ++i)
+    {
+        if (!m_visible[i] || m_minZ[i] > static_cast<int32_t>(slice) || m_maxZ[i] < static_cast<int32_t>(slice)) continue;
+        candidates.push_back(static_cast<uint32_t>(i));
+        minX.push_back(m_minX[i]); maxX.push_back(m_maxX[i]);
+        minY.push_back(m_minY[i]); maxY.push_back(m_maxY[i]);
+    }
+
+    // the overlap tests write a mask without branches over contiguous int32 ranges, so they vectorize; a
+    // compaction pass then appends the lights whose mask is set. Rows are tested first, a tile only tests
+    // the lights of its row
+    size_t candidateCount = candidates.size();
+    std::vector<uint8_t> mask(candidateCount);
+    std::vector<uint32_t> rowLights(candidateCount);
+    std::vector<int32_t> rowMinX(candidateCount), rowMaxX(candidateCount);
+    std::vector<uint32_t>& indices = m_sliceIndices[slice];
+    indices.clear();
+    for (int y = 0; y < static_cast<int>(kTilesY); ++y)
+    {
+        for (size_t c = 0; c < candidateCount; ++c) mask[c] = static_cast<uint8_t>((minY[c] <= y) & (y <= maxY[c]));
+        size_t rowCount = 0;
+        for (size_t c = 0; c < candidateCount; ++c)
+        {
+            rowLights[rowCount] = candidates[c];
+            rowMinX[rowCount] = minX[c];
+            rowMaxX[rowCount] = maxX[c];
+            rowCount += mask[c];
+        }
+
+        for (int x = 0; x < static_cast<int>(kTilesX); ++x)
+        {
+            for (size_t c = 0; c < rowCount; ++c) mask[c] = static_cast<uint8_t>((rowMinX[c] <= x) & (x <= rowMaxX[c]));
+            size_t offset = indices.size();
+            indices.resize(offset + rowCount);
+            size_t count = offset;
+            for (size_t c = 0; c < rowCount; ++c)
+            {
+                indices[count] = rowLights[c];
+                count += mask[c];
+            }
+            indices.resize(count);
+            m_clusters[(slice * kTilesY + y) * kTilesX + x] = glm::uvec2(static_cast<uint32_t>(offset), static_cast<uint32_t>(count - offset));
+        }
+    }
+}
+
+void ClusteredLightGrid::upload(const std::vector<Light>& lights)
+{
+    m_lightCount = static_cast<unsigned int>(lights.size());
+    // zero sized buffers can't be bound, keep at least one element around
+    static const Light emptyLight = {};
+    static const uint32_t emptyIndex = 0;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(lights.size(), 1) * sizeof(Light),
+        lights.empty() ? &emptyLight : lights.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_clusters.size() * sizeof(glm::uvec2), m_clusters.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(m_lightIndices.size(), 1) * sizeof(uint32_t),
+        m_lightIndices.empty() ? &emptyIndex : m_lightIndices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+} // namespace lights
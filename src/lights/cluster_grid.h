@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "lights/light.h"
+#include "shader/shader.h"
+#include "utility/thread_pool.h"
+
+namespace lights
+{
+
+// view space froxel grid: kTilesX x kTilesY screen tiles, kSlicesZ exponentially distributed depth slices.
+// The lights are binned on the CPU and uploaded to three SSBOs that common/lights.glsl walks per fragment:
+//   LIGHT_BUFFER_BINDING        Light lights[]
+//   CLUSTER_BUFFER_BINDING      uvec2 clusters[]     offset into the index list, light count
+//   LIGHT_INDEX_BUFFER_BINDING  uint lightIndices[]
+class ClusteredLightGrid
+{
+public:
+    static constexpr unsigned int kTilesX = 16;
+    static constexpr unsigned int kTilesY = 9;
+    static constexpr unsigned int kSlicesZ = 24;
+    static constexpr unsigned int kClusterCount = kTilesX * kTilesY * kSlicesZ;
+
+    static constexpr unsigned int LIGHT_BUFFER_BINDING = 0;
+    static constexpr unsigned int CLUSTER_BUFFER_BINDING = 1;
+    static constexpr unsigned int LIGHT_INDEX_BUFFER_BINDING = 2;
+
+    explicit ClusteredLightGrid(utility::ThreadPool& threadPool) : m_threadPool(threadPool) { }
+    ~ClusteredLightGrid();
+
+    ClusteredLightGrid(const ClusteredLightGrid&) = delete;
+    ClusteredLightGrid& operator=(const ClusteredLightGrid&) = delete;
+
+    bool Initialize();
+
+    // projection must be a perspective projection, the near and far planes are recovered from it
+    void Update(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection);
+
+    // binds the buffers and sets the cluster lookup uniforms on the shader currently in use
+    void Bind(shader::Shader& shader) const;
+
+    inline unsigned int GetLightCount() const { return m_lightCount; }
+    inline unsigned int GetIndexCount() const { return static_cast<unsigned int>(m_lightIndices.size()); }
+    inline double GetBinningMilliseconds() const { return m_binningMilliseconds; }
+
+private:
+    void computeLightBounds(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection);
+    void binSlice(unsigned int slice);
+    void upload(const std::vector<Light>& lights);
+
+    utility::ThreadPool& m_threadPool;
+
+    unsigned int m_lightBuffer = 0;
+    unsigned int m_clusterBuffer = 0;
+    unsigned int m_lightIndexBuffer = 0;
+
+    float m_near = 0.1f;
+    float m_far = 100.0f;
+
+    // per light cluster ranges, structure of arrays so the masked overlap tests of binSlice vectorize
+    std::vector<int32_t> m_minX, m_maxX, m_minY, m_maxY, m_minZ, m_maxZ;
+    std::vector<uint8_t> m_visible;
+
+    std::vector<glm::uvec2> m_clusters;
+    std::vector<std::vector<uint32_t>> m_sliceIndices;
+    std::vector<uint32_t> m_lightIndices;
+
+    unsigned int m_lightCount = 0;
+    double m_binningMilliseconds = 0.0;
+};
+} // namespace lights
@@ -0,0 +1,54 @@
+#include "lights/light.h"
+#include <cmath>
+#include <random>
+
+namespace lights
+{
+
+Light MakePointLight(glm::vec3 position, glm::vec3 color, float intensity, float range)
+{
+    Light light;
+    light.positionRange = glm::vec4(position, range);
+    light.colorIntensity = glm::vec4(color, intensity);
+    light.directionType = glm::vec4(0.0f, -1.0f, 0.0f, static_cast<float>(LightType::Point));
+    light.spotCosAngles = glm::vec4(-1.0f, -1.0f, 0.0f, 0.0f);
+    return light;
+}
+
+Light MakeSpotLight(glm::vec3 position, glm::vec3 direction, glm::vec3 color, float intensity, float range, float innerAngle, float outerAngle)
+{
+    Light light;
+    light.positionRange = glm::vec4(position, range);
+    light.colorIntensity = glm::vec4(color, intensity);
+    light.directionType = glm::vec4(glm::normalize(direction), static_cast<float>(LightType::Spot));
+    light.spotCosAngles = glm::vec4(std::cos(glm::radians(outerAngle)), std::cos(glm::radians(innerAngle)), 0.0f, 0.0f);
+    return light;
+}
+
+std::vector<Light> GenerateRandomLights(unsigned int count, glm::vec3 boundsMin, glm::vec3 boundsMax, float range, unsigned int seed/* = 1 */)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto randomVec3 = [&]() { return glm::vec3(unit(generator), unit(generator), unit(generator)); };
+
+    std::vector<Light> lights;
+    lights.reserve(count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        glm::vec3 position = boundsMin + randomVec3() * (boundsMax - boundsMin);
+        glm::vec3 color = glm::vec3(0.2f) + randomVec3() * 0.8f;
+        float intensity = 0.5f + unit(generator) * 1.5f;
+        if (i % 4 == 3)
+        {
+            glm::vec3 direction = randomVec3() * 2.0f - glm::vec3(1.0f);
+            if (glm::dot(direction, direction) < 1e-4f) direction = glm::vec3(0.0f, -1.0f, 0.0f);
+            lights.push_back(MakeSpotLight(position, direction, color, intensity, range, 20.0f, 30.0f));
+        }
+        else
+        {
+            lights.push_back(MakePointLight(position, color, intensity, range));
+        }
+    }
+    return lights;
+}
+} // namespace lights
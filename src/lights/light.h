@@ -0,0 +1,37 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace lights
+{
+
+enum class LightType : int
+{
+    Point = 0,
+    Spot = 1
+};
+
+// mirrors struct Light (std430) in common/lights.glsl
+struct Light
+{
+    glm::vec4 positionRange;  // xyz: world position, w: range, the light has no influence beyond it
+    glm::vec4 colorIntensity; // rgb: color, a: intensity
+    glm::vec4 directionType;  // xyz: spot direction, w: LightType
+    glm::vec4 spotCosAngles;  // x: cos(outer cone angle), y: cos(inner cone angle)
+};
+
+// infinitely distant light, e.g. the sun
+struct DirectionalLight
+{
+    glm::vec3 direction = glm::vec3(-0.3f, -1.0f, -0.4f); // direction the light travels in
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 3.0f;
+};
+
+Light MakePointLight(glm::vec3 position, glm::vec3 color, float intensity, float range);
+// angles are the cone half angles in degrees
+Light MakeSpotLight(glm::vec3 position, glm::vec3 direction, glm::vec3 color, float intensity, float range, float innerAngle, float outerAngle);
+
+// scatters point and spot lights with random colors inside the given box, used by the light count sweep
+std::vector<Light> GenerateRandomLights(unsigned int count, glm::vec3 boundsMin, glm::vec3 boundsMax, float range, unsigned int seed = 1);
+} // namespace lights
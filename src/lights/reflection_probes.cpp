@@ -0,0 +1,273 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+#include "lights/reflection_probes.h"
+#include "ibl/precompute.h"
+#include "utility/primitives.h"
+#include "utility/resources.h"
+
+namespace lights
+{
+
+namespace
+{
+// must match probe_blur.comp
+constexpr unsigned int BLUR_LOCAL_SIZE = 8;
+// spread of the reflected lobe at a given roughness, a rough fit of the GGX lobe width in radians
+float lobeSpread(float roughness)
+{
+    return roughness * roughness;
+}
+} // namespace
+
+ReflectionProbes::~ReflectionProbes()
+{
+    if (m_cubemapArray != 0)
+    {
+        glDeleteTextures(1, &m_cubemapArray);
+        glDeleteFramebuffers(1, &m_framebuffer);
+        glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+        for (const PendingTimer& timer : m_timers) glDeleteQueries(1, &timer.query);
+        if (!m_freeQueries.empty()) glDeleteQueries(static_cast<int>(m_freeQueries.size()), m_freeQueries.data());
+    }
+}
+
+bool ReflectionProbes::Initialize(unsigned int resolution/* = 128 */, unsigned int mipLevels/* = 5 */)
+{
+    // the probes reuse the vertex stage of the forward pass, so every mesh attribute is where pbr.vert expects it
+    if (!m_captureShader.Initialize(utility::ResourcePath("shader/pbr.vert").c_str(), utility::ResourcePath("shader/probe_capture.frag").c_str())) return false;
+    if (!m_backgroundShader.Initialize(utility::ResourcePath("shader/cubemap.vert").c_str(), utility::ResourcePath("shader/probe_background.frag").c_str())) return false;
+    if (!m_blurShader.InitializeCompute(utility::ResourcePath("shader/probe_blur.comp").c_str())) return false;
+    m_resolution = resolution;
+    m_mipLevels = std::min(mipLevels, static_cast<unsigned int>(std::log2(resolution)) + 1);
+    ibl::makeCaptureMatrices(m_captureProjection, m_captureViews);
+
+    // image load/store has no RGB16F format, the blur writes the mips through an image
+    glGenTextures(1, &m_cubemapArray);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_cubemapArray);
+    glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, m_mipLevels, GL_RGBA16F, resolution, resolution, 6 * kMaxProbes);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+    glGenRenderbuffers(1, &m_depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, resolution, resolution);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_cubemapArray, 0, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete)
+    {
+        std::cerr << "Reflection probe framebuffer is not complete" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ReflectionProbes::AddProbe(const glm::vec3& position, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    if (m_probes.size() >= kMaxProbes) return false;
+    Probe probe;
+    probe.position = position;
+    probe.boxMin = boxMin;
+    probe.boxMax = boxMax;
+    m_probes.push_back(probe);
+    return true;
+}
+
+void ReflectionProbes::SetEnvironment(unsigned int envCubemap, unsigned int irradianceMap)
+{
+    // the probes keep their old content until the round robin reaches them again, so nothing pops to black
+    m_envCubemap = envCubemap;
+    m_irradianceMap = irradianceMap;
+}
+
+void ReflectionProbes::Update(object3ds::Model& model, const DirectionalLight* sun)
+{
+    collectTimings();
+    m_stats.lastFrameSteps = 0;
+    if (m_probes.empty()) return;
+
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    double plannedMilliseconds = 0.0;
+    // one full round over every probe at most, more would only repeat work within the frame
+    for (unsigned int step = 0; step < m_probes.size() * kStepsPerProbe; ++step)
+    {
+        bool filter = m_nextStep == kStepsPerProbe - 1;
+        double estimate = filter ? m_stats.averageFilterMilliseconds : m_stats.averageCaptureMilliseconds;
+        // until a step of the kind was measured its cost is unknown, don't risk more than one step on it
+        if (step > 0 && (estimate == 0.0 || plannedMilliseconds + estimate > m_frameBudgetMilliseconds)) break;
+        plannedMilliseconds += estimate;
+
+        unsigned int query;
+        if (m_freeQueries.empty()) glGenQueries(1, &query);
+        else
+        {
+            query = m_freeQueries.back();
+            m_freeQueries.pop_back();
+        }
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        if (filter) filterProbe(m_nextProbe);
+        else captureFace(model, sun, m_nextProbe, m_nextStep);
+        glEndQuery(GL_TIME_ELAPSED);
+        m_timers.push_back({ query, filter });
+        ++m_stats.lastFrameSteps;
+
+        if (++m_nextStep == kStepsPerProbe)
+        {
+            m_probes[m_nextProbe].ready = true;
+            m_nextStep = 0;
+            m_nextProbe = (m_nextProbe + 1) % m_probes.size();
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void ReflectionProbes::Bind(shader::Shader& shader) const
+{
+    glActiveTexture(GL_TEXTURE0 + PROBE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_cubemapArray);
+    glActiveTexture(GL_TEXTURE0);
+
+    // the probes become ready in order, so the ready ones are the leading layers of the array
+    int readyCount = 0;
+    while (readyCount < static_cast<int>(m_probes.size()) && m_probes[readyCount].ready) ++readyCount;
+
+    shader.SetUniform("probeMaps", PROBE_TEXTURE_UNIT);
+    shader.SetUniform("probeCount", readyCount);
+    shader.SetUniform("probeMaxLod", static_cast<float>(m_mipLevels - 1));
+    for (int i = 0; i < readyCount; ++i)
+    {
+        std::string index = "[" + std::to_string(i) + "]";
+        shader.SetUniform(("probePositions" + index).c_str(), m_probes[i].position);
+        shader.SetUniform(("probeBoxMins" + index).c_str(), m_probes[i].boxMin);
+        shader.SetUniform(("probeBoxMaxs" + index).c_str(), m_probes[i].boxMax);
+    }
+}
+
+void ReflectionProbes::BindDisabled(shader::Shader& shader)
+{
+    // the sampler still needs a unit of its own, samplers of different types can't share one
+    shader.SetUniform("probeMaps", PROBE_TEXTURE_UNIT);
+    shader.SetUniform("probeCount", 0);
+}
+
+void ReflectionProbes::captureFace(object3ds::Model& model, const DirectionalLight* sun, unsigned int probe, unsigned int face)
+{
+    const Probe& current = m_probes[probe];
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_cubemapArray, 0, probe * 6 + face);
+    glViewport(0, 0, m_resolution, m_resolution);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    // environment behind the scene, the capture views have no translation so the unit cube surrounds the probe
+    glDepthMask(GL_FALSE);
+    m_backgroundShader.Use();
+    m_backgroundShader.SetUniform("projection", m_captureProjection);
+    m_backgroundShader.SetUniform("view", m_captureViews[face]);
+    m_backgroundShader.SetUniform("environmentMap", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
+    utility::renderCube();
+    glDepthMask(GL_TRUE);
+
+    // the depth range covers the whole scene as seen from the probe
+    glm::vec3 boundsMin = model.GetBoundsMin();
+    glm::vec3 boundsMax = model.GetBoundsMax();
+    glm::vec3 farthest = glm::max(glm::abs(boundsMin - current.position), glm::abs(boundsMax - current.position));
+    float farPlane = glm::length(farthest) * 1.01f + 0.01f;
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, farPlane * 1e-3f, farPlane);
+    glm::mat4 view = m_captureViews[face] * glm::translate(glm::mat4(1.0f), -current.position);
+
+    m_captureShader.Use();
+    m_captureShader.SetUniform("projection", projection);
+    m_captureShader.SetUniform("view", view);
+    m_captureShader.SetUniform("model", glm::mat4(1.0f));
+    m_captureShader.SetUniform("normalMatrix", glm::mat3(1.0f));
+    m_captureShader.SetUniform("irradianceMap", 0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_irradianceMap);
+    if (sun)
+    {
+        m_captureShader.SetUniform("sunDirection", glm::normalize(sun->direction));
+        m_captureShader.SetUniform("sunRadiance", sun->color * sun->intensity);
+    }
+    else m_captureShader.SetUniform("sunRadiance", glm::vec3(0.0f));
+    model.Draw(m_captureShader);
+    ++m_stats.faceCount;
+}
+
+void ReflectionProbes::filterProbe(unsigned int probe)
+{
+    m_blurShader.Use();
+    m_blurShader.SetUniform("sourceMaps", PROBE_TEXTURE_UNIT);
+    m_blurShader.SetUniform("firstLayer", probe * 6);
+    glActiveTexture(GL_TEXTURE0 + PROBE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_cubemapArray);
+    glActiveTexture(GL_TEXTURE0);
+
+    // each mip blurs the one above it just enough to grow the lobe from the previous roughness to its own,
+    // and at least by a source texel so the downsampling doesn't alias
+    float maxLod = static_cast<float>(std::max(m_mipLevels, 2u) - 1);
+    for (unsigned int mip = 1; mip < m_mipLevels; ++mip)
+    {
+        unsigned int mipSize = m_resolution >> mip;
+        float spread = lobeSpread(mip / maxLod);
+        float previousSpread = lobeSpread((mip - 1) / maxLod);
+        float growth = std::sqrt(std::max(spread * spread - previousSpread * previousSpread, 0.0f));
+        float sourceTexelAngle = 2.0f / (m_resolution >> (mip - 1));
+        // the 1 2 1 tent has a variance of half its tap spacing squared per axis
+        m_blurShader.SetUniform("tapSpacing", std::max(std::sqrt(2.0f) * growth, sourceTexelAngle));
+        m_blurShader.SetUniform("sourceLod", static_cast<float>(mip - 1));
+        m_blurShader.SetUniform("mipSize", mipSize);
+        glBindImageTexture(0, m_cubemapArray, mip, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        unsigned int groups = (mipSize + BLUR_LOCAL_SIZE - 1) / BLUR_LOCAL_SIZE;
+        glDispatchCompute(groups, groups, 6);
+        // the next mip reads this one
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    ++m_stats.filterCount;
+}
+
+void ReflectionProbes::collectTimings()
+{
+    double resolvedMilliseconds = 0.0;
+    for (size_t i = 0; i < m_timers.size();)
+    {
+        int available = 0;
+        glGetQueryObjectiv(m_timers[i].query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            ++i;
+            continue;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(m_timers[i].query, GL_QUERY_RESULT, &nanoseconds);
+        double milliseconds = nanoseconds / 1.0e6;
+        double& average = m_timers[i].filter ? m_stats.averageFilterMilliseconds : m_stats.averageCaptureMilliseconds;
+        average = average == 0.0 ? milliseconds : 0.9 * average + 0.1 * milliseconds;
+        resolvedMilliseconds += milliseconds;
+
+        m_freeQueries.push_back(m_timers[i].query);
+        m_timers[i] = m_timers.back();
+        m_timers.pop_back();
+    }
+    m_stats.lastFrameGpuMilliseconds = resolvedMilliseconds;
+    m_stats.averageFrameGpuMilliseconds = 0.9 * m_stats.averageFrameGpuMilliseconds + 0.1 * resolvedMilliseconds;
+}
+} // namespace lights
@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "lights/light.h"
+#include "object3ds/model.h"
+#include "shader/shader.h"
+
+namespace lights
+{
+
+struct ReflectionProbeStats
+{
+    double lastFrameGpuMilliseconds = 0.0;    // gpu time of the probe updates whose queries resolved last frame
+    double averageFrameGpuMilliseconds = 0.0; // exponential moving average of it
+    double averageCaptureMilliseconds = 0.0;  // cost of re-rendering one face
+    double averageFilterMilliseconds = 0.0;   // cost of blurring the mip chain of one probe
+    unsigned int faceCount = 0;               // faces re-rendered since the start
+    unsigned int filterCount = 0;             // mip chains rebuilt since the start
+    unsigned int lastFrameSteps = 0;          // faces and filters issued during the last Update
+};
+
+// local reflection probes re-rendered from the scene at runtime.
+// Every probe is a cubemap in one cubemap array, captured with a cheap diffuse-only shader around its position.
+// The updates are time-sliced: a probe is refreshed one face at a time, then its mip chain is rebuilt by a compute
+// blur that widens the lobe per mip instead of the importance sampled GGX convolution of the global prefilter map.
+// Each frame issues update steps until the estimated gpu time reaches the frame budget, at least one step.
+// The lighting shaders correct the lookup with the probe box (parallax correction) and fall back to the global
+// prefilter map outside of every box.
+class ReflectionProbes
+{
+public:
+    static constexpr unsigned int kMaxProbes = 4;
+    static constexpr int PROBE_TEXTURE_UNIT = 14;
+
+    ~ReflectionProbes();
+
+    bool Initialize(unsigned int resolution = 128, unsigned int mipLevels = 5);
+
+    // the probe sees the scene from position, reflections of points inside [boxMin, boxMax] are corrected
+    // against the box. Returns false when kMaxProbes are placed already
+    bool AddProbe(const glm::vec3& position, const glm::vec3& boxMin, const glm::vec3& boxMax);
+    inline unsigned int GetProbeCount() const { return static_cast<unsigned int>(m_probes.size()); }
+
+    // maps lighting the captured surfaces and drawn behind them, changing them refreshes every probe
+    void SetEnvironment(unsigned int envCubemap, unsigned int irradianceMap);
+    // max estimated gpu time spent on probe updates in one frame
+    inline void SetFrameBudget(double milliseconds) { m_frameBudgetMilliseconds = milliseconds; }
+
+    // issues the next update steps, sun may be null
+    void Update(object3ds::Model& model, const DirectionalLight* sun);
+
+    // binds the probe cubemap array and sets the probe uniforms on the shader currently in use,
+    // only probes with a complete capture are enabled
+    void Bind(shader::Shader& shader) const;
+    // sets the uniforms so the shader only uses the global prefilter map
+    static void BindDisabled(shader::Shader& shader);
+
+    inline const ReflectionProbeStats& GetStats() const { return m_stats; }
+
+private:
+    // steps of one probe: the six faces, then the mip chain
+    static constexpr unsigned int kStepsPerProbe = 7;
+
+    struct Probe
+    {
+        glm::vec3 position;
+        glm::vec3 boxMin;
+        glm::vec3 boxMax;
+        bool ready = false; // every face and the mip chain were updated at least once
+    };
+
+    struct PendingTimer
+    {
+        unsigned int query = 0;
+        bool filter = false;
+    };
+
+    void captureFace(object3ds::Model& model, const DirectionalLight* sun, unsigned int probe, unsigned int face);
+    void filterProbe(unsigned int probe);
+    void collectTimings();
+
+    std::vector<Probe> m_probes;
+    shader::Shader m_captureShader;
+    shader::Shader m_backgroundShader;
+    shader::Shader m_blurShader;
+
+    unsigned int m_resolution = 0;
+    unsigned int m_mipLevels = 0;
+    unsigned int m_cubemapArray = 0;
+    unsigned int m_framebuffer = 0;
+    unsigned int m_depthRenderbuffer = 0;
+    unsigned int m_envCubemap = 0;
+    unsigned int m_irradianceMap = 0;
+    glm::mat4 m_captureProjection;
+    glm::mat4 m_captureViews[6];
+
+    // round robin position over every step of every probe
+    unsigned int m_nextProbe = 0;
+    unsigned int m_nextStep = 0;
+
+    double m_frameBudgetMilliseconds = 0.5;
+    std::vector<PendingTimer> m_timers;
+    std::vector<unsigned int> m_freeQueries;
+    ReflectionProbeStats m_stats;
+};
+} // namespace lights
@@ -1,26 +1,72 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
 #include "shader/shader.h"
+#include "shader/program_cache.h"
 #include "cameras/camera.h"
 #include "object3ds/model.h"
 #include "utility/stb_image.h"
+#include "renderers/renderer.h"
+#include "lights/cluster_grid.h"
+#include "lights/cascaded_shadow_map.h"
+#include "lights/reflection_probes.h"
+#include "utility/thread_pool.h"
+#include "ibl/precompute.h"
+#include "ibl/environment_baker.h"
+#include "ibl/octahedral_atlas.h"
+#include "ibl/environment_brdf.h"
+#include "profiling/profiler.h"
+#include "profiling/zones.h"
+#include "profiling/frame_stats.h"
+#include "profiling/gl_counters.h"
+#include "platform/gl_context.h"
+#include "renderers/render_target.h"
+#include "renderers/async_readback.h"
+#include "renderers/stats_hud.h"
+#include "utility/image_writer.h"
+#include "utility/image_write_queue.h"
+#include "utility/resources.h"
+#include "batch/batch_job.h"
+#include "batch/batch_runner.h"
+#include "batch/golden.h"
 
 using object3ds::Model;
 using shader::Shader;
+using ibl::precompute;
 
 std::shared_ptr<cameras::Camera> camera;
+bool headless = false; // no window to present to, frames are only read back
 float deltaTime = 0.0f; // Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last frame
+renderers::StatsHud* statsHud = nullptr; // drawn over the window when set
+bool statsHudVisible = true;             // H toggles it
 
-void renderCube();
-void renderQuad();
-void precompute(unsigned int& envCubemap, unsigned int& irradianceMap, unsigned int &prefilterMap, unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6]);
-void equirectangularToCubemapShader(unsigned int& envCubemap, unsigned int captureFBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6]);
-void renderIrradianceCubemap(unsigned int& irradianceMap, unsigned int envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6]);
-void renderPrefilterCubemap(unsigned int &prefilterMap, unsigned int envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6]);
-void renderBRDFLUT(unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO);
+void presentFrame(GLFWwindow* window, const renderers::RenderTarget& target);
+bool writeFrame(const renderers::RenderTarget& target, const std::string& path);
+std::string numberedPath(const std::string& path, int number);
+void runLightSweep(GLFWwindow* window, renderers::Renderer& renderer, const renderers::RenderTarget& target, Model& model, const renderers::LightingInputs& lighting, lights::ClusteredLightGrid& lightGrid, float lightRange);
+
+// one side of an A/B comparison of lighting paths rendering the same view
+struct LightingVariant
+{
+    std::string name;
+    renderers::LightingInputs lighting;
+    double frameMilliseconds = 0.0;       // average over every timed frame
+    double frameMillisecondsSpread = 0.0; // max - min of the per round averages
+    std::vector<unsigned char> image;     // last frame, RGB8
+};
+void runLightingComparison(GLFWwindow* window, renderers::Renderer& renderer, const renderers::RenderTarget& target, Model& model, std::vector<LightingVariant>& variants);
+void runStorageComparison(GLFWwindow* window, renderers::Renderer& renderer, const renderers::RenderTarget& target, Model& model, const renderers::LightingInputs& lighting, const ibl::OctahedralAtlas& atlas, const ibl::IBLSettings& settings);
+void runMultiScatterComparison(GLFWwindow* window, renderers::Renderer& renderer, const renderers::RenderTarget& target, Model& model, const renderers::LightingInputs& lighting);
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
@@ -41,28 +87,148 @@ void processInput(GLFWwindow *window)
         camera->Truck(1.0f, 0.f);
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    glfwInit();
-    // tell glfw the version of opengl
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    GLFWwindow* window = glfwCreateWindow(800, 600, "OpenGL Viewer", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window); // make the window the current context
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    // the rendering path is chosen once at startup, both paths draw the same Model
+    renderers::RendererType rendererType = renderers::RendererType::Forward;
+    unsigned int lightCount = 0;
+    bool lightSweep = false;
+    bool sunEnabled = false;
+    ibl::PrefilterMethod prefilterMethod = ibl::PrefilterMethod::Compute;
+    ibl::CaptureMethod captureMethod = ibl::CaptureMethod::Layered;
+    ibl::IBLQuality iblQuality = ibl::IBLQuality::Balanced;
+    float iblBudgetMilliseconds = 0.0f; // 0: bake iblQuality regardless of time
+    std::vector<std::string> environments; // N cycles through them at runtime
+    float environmentBakeBudgetMilliseconds = 2.0f;
+    unsigned int probeCount = 0;
+    float probeBudgetMilliseconds = 0.5f;
+    ibl::EnvironmentStorage environmentStorage = ibl::EnvironmentStorage::Cubemap;
+    ibl::OctahedralFormat octahedralFormat = ibl::OctahedralFormat::R11G11B10F;
+    bool storageComparison = false;
+    ibl::EnvironmentBRDF environmentBRDF = ibl::EnvironmentBRDF::LUT;
+    const char* brdfLUTDumpPath = nullptr;
+    bool multiScatter = true;
+    bool multiScatterComparison = false;
+    std::string shaderCacheDirectory = "shader_cache"; // empty: always compile from source
+    bool clearShaderCache = false;
+    bool parallelShaderCompile = true;
+    bool shaderHotReload = false;
+    bool profile = false;
+    const char* profileTracePath = nullptr;
+    bool showStats = false;             // the overlay, and the frame stats summary at exit
+    const char* statsCSVPath = nullptr; // a row of frame stats per frame, written at exit
+    platform::ContextBackend contextBackend = platform::ContextBackend::Window;
+    int width = 800;
+    int height = 600;
+    std::string outputPath;   // the last frame, or every turntable frame, as .png or .exr
+    int frameLimit = 0;       // 0: until the window is closed, a single frame when headless
+    int turntableFrames = 0;  // frames of one orbit around the model
+    const char* batchPath = nullptr; // a job file, renders its images and exits
+    std::string goldenCheckDirectory;  // renders the golden views, compares them to the images there and exits
+    std::string goldenUpdateDirectory; // renders the golden views into it and exits
+    std::string goldenOutputDirectory = "golden_output";
+    bool contextChosen = false;
+    for (int i = 1; i < argc; ++i)
     {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        if (std::strcmp(argv[i], "--deferred") == 0) rendererType = renderers::RendererType::Deferred;
+        else if (std::strcmp(argv[i], "--forward") == 0) rendererType = renderers::RendererType::Forward;
+        else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc) lightCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--light-sweep") == 0) lightSweep = true;
+        else if (std::strcmp(argv[i], "--sun") == 0) sunEnabled = true;
+        else if (std::strcmp(argv[i], "--prefilter-fragment") == 0) prefilterMethod = ibl::PrefilterMethod::Fragment;
+        else if (std::strcmp(argv[i], "--capture-per-face") == 0) captureMethod = ibl::CaptureMethod::PerFace;
+        else if (std::strcmp(argv[i], "--ibl-quality") == 0 && i + 1 < argc)
+        {
+            if (!ibl::ParseIBLQuality(argv[++i], iblQuality)) std::cerr << "Warning: unknown IBL quality " << argv[i] << ", expected fast, balanced or quality" << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--ibl-budget") == 0 && i + 1 < argc) iblBudgetMilliseconds = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--environment") == 0 && i + 1 < argc) environments.push_back(argv[++i]);
+        else if (std::strcmp(argv[i], "--environment-budget") == 0 && i + 1 < argc) environmentBakeBudgetMilliseconds = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--probes") == 0 && i + 1 < argc) probeCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--probe-budget") == 0 && i + 1 < argc) probeBudgetMilliseconds = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--ibl-storage") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (std::strcmp(argv[i], "octahedral") == 0) environmentStorage = ibl::EnvironmentStorage::Octahedral;
+            else if (std::strcmp(argv[i], "cubemap") == 0) environmentStorage = ibl::EnvironmentStorage::Cubemap;
+            else std::cerr << "Warning: unknown IBL storage " << argv[i] << ", expected cubemap or octahedral" << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--octahedral-format") == 0 && i + 1 < argc)
+        {
+            if (!ibl::ParseOctahedralFormat(argv[++i], octahedralFormat)) std::cerr << "Warning: unknown octahedral format " << argv[i] << ", expected r11g11b10f or rgb9e5" << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--ibl-storage-compare") == 0) storageComparison = true;
+        else if (std::strcmp(argv[i], "--environment-brdf") == 0 && i + 1 < argc)
+        {
+            if (!ibl::ParseEnvironmentBRDF(argv[++i], environmentBRDF)) std::cerr << "Warning: unknown environment BRDF " << argv[i] << ", expected lut, karis or polynomial" << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--dump-brdf-lut") == 0 && i + 1 < argc) brdfLUTDumpPath = argv[++i];
+        else if (std::strcmp(argv[i], "--single-scatter") == 0) multiScatter = false;
+        else if (std::strcmp(argv[i], "--multiscatter-compare") == 0) multiScatterComparison = true;
+        else if (std::strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc) shaderCacheDirectory = argv[++i];
+        else if (std::strcmp(argv[i], "--no-shader-cache") == 0) shaderCacheDirectory.clear();
+        else if (std::strcmp(argv[i], "--clear-shader-cache") == 0) clearShaderCache = true;
+        else if (std::strcmp(argv[i], "--serial-shader-compile") == 0) parallelShaderCompile = false;
+        else if (std::strcmp(argv[i], "--hot-reload") == 0) shaderHotReload = true;
+        else if (std::strcmp(argv[i], "--profile") == 0) profile = true;
+        else if (std::strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc) profileTracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--stats") == 0) showStats = true;
+        else if (std::strcmp(argv[i], "--stats-csv") == 0 && i + 1 < argc) statsCSVPath = argv[++i];
+        else if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            contextBackend = platform::ContextBackend::OSMesa;
+            contextChosen = true;
+        }
+        else if (std::strcmp(argv[i], "--context") == 0 && i + 1 < argc)
+        {
+            contextChosen = true;
+            if (!platform::ParseContextBackend(argv[++i], contextBackend)) std::cerr << "Warning: unknown context " << argv[i] << ", expected window, osmesa or egl" << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+            {
+                std::cerr << "Warning: invalid size " << argv[i] << ", expected WIDTHxHEIGHT" << std::endl;
+                width = 800;
+                height = 600;
+            }
+        }
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frameLimit = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--turntable") == 0 && i + 1 < argc) turntableFrames = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batchPath = argv[++i];
+        else if (std::strcmp(argv[i], "--golden-check") == 0 && i + 1 < argc) goldenCheckDirectory = argv[++i];
+        else if (std::strcmp(argv[i], "--golden-update") == 0 && i + 1 < argc) goldenUpdateDirectory = argv[++i];
+        else if (std::strcmp(argv[i], "--golden-output") == 0 && i + 1 < argc) goldenOutputDirectory = argv[++i];
+        else if (std::strcmp(argv[i], "--resource-root") == 0 && i + 1 < argc) utility::SetResourceRoot(argv[++i]);
+        else std::cerr << "Warning: unknown argument " << argv[i] << std::endl;
     }
+    if (environments.empty()) environments.push_back(utility::ResourcePath("resources/environmentMap/courtyard.hdr"));
+    shader::SetProgramCacheDirectory(shaderCacheDirectory);
+    if (clearShaderCache) shader::ClearProgramCache();
+    shader::SetParallelShaderCompile(parallelShaderCompile);
+    shader::SetShaderHotReload(shaderHotReload);
+    // the startup bake is profiled too, its scopes land in the first frame
+    profiling::GetProfiler().SetEnabled(profile || profileTracePath);
+    PROFILE_THREAD_NAME("main");
+    bool golden = !goldenCheckDirectory.empty() || !goldenUpdateDirectory.empty();
+    // golden images come from the software rasterizer unless asked otherwise, the same on every machine
+    if (golden && !contextChosen) contextBackend = platform::ContextBackend::OSMesa;
+    headless = platform::IsHeadless(contextBackend);
+    // a turntable is one orbit, a headless run without a limit renders one frame
+    if (turntableFrames > 0) frameLimit = turntableFrames;
+    else if (headless && frameLimit <= 0) frameLimit = 1;
+    if (headless && outputPath.empty() && !batchPath && !golden) std::cerr << "Warning: headless without --output, the frames are rendered and discarded" << std::endl;
+
+    GLFWwindow* window = platform::CreateContext(contextBackend, width, height, "OpenGL Viewer");
+    // a golden check on a machine without the software rasterizer is skipped rather than failed
+    if (window == NULL) return !goldenCheckDirectory.empty() ? batch::GOLDEN_SKIPPED_EXIT_CODE : -1;
+    // before the first program is started, the compiler thread count only applies to later compiles
+    shader::InitializeParallelShaderCompile();
+    if (!headless) glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    // the counters hook the GL functions before anything is allocated, so the video memory estimate sees it all
+    bool collectStats = showStats || statsCSVPath;
+    if (collectStats) profiling::InstallGLCounters();
 
     // textures exported by blender are flipped vertically, so no need to flip it again 
     // stbi_set_flip_vertically_on_load(true);
@@ -71,11 +237,48 @@ int main()
     glDepthFunc(GL_LEQUAL); // set depth function to less than AND equal for skybox depth trick.
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS); // enable seamless cubemap sampling for lower mip levels in the pre-filter map.
 
-    glViewport(0, 0, 800, 600); // set the viewport to the whole window, left lower and right upper corner coordinates
+    glViewport(0, 0, width, height); // set the viewport to the whole window, left lower and right upper corner coordinates
+
+    if (batchPath || golden)
+    {
+        bool succeeded = false;
+        if (!goldenUpdateDirectory.empty()) succeeded = batch::UpdateGoldenImages(goldenUpdateDirectory);
+        else if (golden) succeeded = batch::CheckGoldenImages(goldenCheckDirectory, goldenOutputDirectory);
+        else
+        {
+            // the command line sets what the job file leaves out
+            batch::BatchJob job;
+            job.models.push_back(utility::ResourcePath("resources/psr-13/scene.gltf"));
+            job.environments = environments;
+            job.width = width;
+            job.height = height;
+            job.rendererType = rendererType;
+            job.iblQuality = iblQuality;
+            job.prefilterMethod = prefilterMethod;
+            job.captureMethod = captureMethod;
+            job.environmentBRDF = environmentBRDF;
+            job.multiScatter = multiScatter;
+            if (batch::LoadBatchJob(batchPath, job))
+            {
+                batch::BatchStats stats;
+                succeeded = batch::RunBatch(job, &stats);
+                batch::PrintBatchStats(stats);
+            }
+        }
+        profiling::Profiler& profiler = profiling::GetProfiler();
+        if (profiler.IsEnabled())
+        {
+            profiler.Flush();
+            if (profile) profiler.PrintStats();
+            if (profileTracePath) profiler.WriteChromeTrace(profileTracePath);
+        }
+        glfwTerminate();
+        return succeeded ? 0 : 1;
+    }
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback); // set the callback function for window resize
 
     // camera setup
-    camera = std::make_shared<cameras::PerspectiveCamera>(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0), 45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    camera = std::make_shared<cameras::PerspectiveCamera>(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0), 45.0f, static_cast<float>(width) / height, 0.1f, 100.0f);
     glfwSetCursorPosCallback(window, [](GLFWwindow* window, double xpos, double ypos)
     {
         camera->Rotate(xpos, ypos);
@@ -85,16 +288,17 @@ int main()
         camera->Dolly(yoffset);
     });
 
+    // start compiling the startup programs before loading the model, the driver compiles them while
+    // assimp and stb_image run. With --serial-shader-compile every program is finished right away instead
+    bool bakeBRDFLUT = environmentBRDF == ibl::EnvironmentBRDF::LUT || brdfLUTDumpPath;
+    auto precomputeShaders = std::make_unique<ibl::PrecomputeShaders>();
+    precomputeShaders->BeginInitialize(prefilterMethod, captureMethod, bakeBRDFLUT);
+    std::unique_ptr<renderers::Renderer> renderer = renderers::CreateRenderer(rendererType);
+    renderer->BeginInitialize();
+
     Model model;
-    model.Load("../resources/psr-13/scene.gltf");
+    model.Load(utility::ResourcePath("resources/psr-13/scene.gltf").c_str());
     {
-        Shader pbrShader;
-        assert(pbrShader.Initialize("../shader/pbr.vert", "../shader/pbr.frag"));
-
-        pbrShader.SetUniform("irradianceMap", 0);
-        pbrShader.SetUniform("prefilterMap", 1);
-        pbrShader.SetUniform("brdfLUT", 2);
-
         // pbr: setup framebuffer
         // ----------------------
         unsigned int captureFBO;
@@ -109,362 +313,457 @@ int main()
         
         // pbr: set up projection and view matrices for capturing data onto the 6 cubemap face directions
         // ----------------------------------------------------------------------------------------------
-        glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-        glm::mat4 captureViews[] =
-        {
-            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-        };
+        glm::mat4 captureProjection;
+        glm::mat4 captureViews[6];
+        ibl::makeCaptureMatrices(captureProjection, captureViews);
         unsigned int envCubemap, irradianceMap, prefilterMap, brdfLUTTexture;
-        precompute(envCubemap, irradianceMap, prefilterMap, brdfLUTTexture, captureFBO, captureRBO, captureProjection, captureViews);
+        if (iblBudgetMilliseconds > 0.0f)
+            iblQuality = ibl::precomputeWithinBudget(iblBudgetMilliseconds, envCubemap, irradianceMap, prefilterMap, brdfLUTTexture, captureFBO, captureRBO, captureProjection, captureViews, environments[0].c_str(), prefilterMethod, captureMethod, bakeBRDFLUT, precomputeShaders.get());
+        else
+            precompute(envCubemap, irradianceMap, prefilterMap, brdfLUTTexture, captureFBO, captureRBO, captureProjection, captureViews, environments[0].c_str(), ibl::GetIBLPreset(iblQuality), prefilterMethod, captureMethod, bakeBRDFLUT, precomputeShaders.get());
+        precomputeShaders.reset(); // later bakes go through the EnvironmentBaker
+        if (brdfLUTDumpPath)
+        {
+            // input of the brdf_fit tool
+            unsigned int resolution = ibl::GetIBLPreset(iblQuality).brdfLUTResolution;
+            std::vector<glm::vec2> texels(static_cast<size_t>(resolution) * resolution);
+            glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, texels.data());
+            if (!ibl::WriteBRDFLUT(brdfLUTDumpPath, resolution, resolution, texels)) std::cerr << "Failed to write BRDF LUT " << brdfLUTDumpPath << std::endl;
+        }
 
         // then before rendering, configure the viewport to the original framebuffer's screen dimensions
         int scrWidth, scrHeight;
         glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
         glViewport(0, 0, scrWidth, scrHeight);
 
+        assert(renderer->Initialize(scrWidth, scrHeight));
+        // every mode renders into the target, the window only gets a copy
+        renderers::RenderTarget target;
+        assert(target.Initialize(scrWidth, scrHeight));
+        renderer->SetOutputFramebuffer(target.GetFramebuffer());
+        renderers::LightingInputs lighting;
+        lighting.ibl.irradianceMap = irradianceMap;
+        lighting.ibl.prefilterMap = prefilterMap;
+        lighting.ibl.brdfLUT = brdfLUTTexture;
+        lighting.ibl.prefilterMipLevels = ibl::GetIBLPreset(iblQuality).prefilterMipLevels;
+        lighting.ibl.environmentBRDF = environmentBRDF;
+        lighting.ibl.multiScatter = multiScatter;
+
+        // later environments are baked a slice per frame while the current one stays bound
+        ibl::EnvironmentBaker environmentBaker;
+        assert(environmentBaker.Initialize(ibl::GetIBLPreset(iblQuality)));
+        environmentBaker.Adopt({ envCubemap, irradianceMap, prefilterMap });
+        size_t environmentIndex = 0;
+
+        // octahedral storage resamples the baked cubemaps into slot 0 of an atlas, again after every environment switch
+        ibl::OctahedralAtlas octahedralAtlas;
+        if (environmentStorage == ibl::EnvironmentStorage::Octahedral || storageComparison)
+        {
+            assert(octahedralAtlas.Initialize(ibl::GetIBLPreset(iblQuality), 1, octahedralFormat));
+            octahedralAtlas.Store(0, irradianceMap, prefilterMap);
+            if (environmentStorage == ibl::EnvironmentStorage::Octahedral) lighting.ibl.octahedralAtlas = &octahedralAtlas;
+        }
+        bool environmentKeyDown = false;
+        double environmentRequestTime = 0.0;
+
+        // analytic lights scattered through the model bounds
+        utility::ThreadPool threadPool;
+        lights::ClusteredLightGrid lightGrid(threadPool);
+        assert(lightGrid.Initialize());
+        lighting.lightGrid = &lightGrid;
+        float lightRange = 0.15f * glm::length(model.GetBoundsMax() - model.GetBoundsMin());
+        std::vector<lights::Light> sceneLights = lights::GenerateRandomLights(lightCount, model.GetBoundsMin(), model.GetBoundsMax(), lightRange);
+
+        // sun with cascaded shadows
+        lights::CascadedShadowMap shadowMap;
+        lights::DirectionalLight sun;
+        if (sunEnabled)
+        {
+            assert(shadowMap.Initialize());
+            shadowMap.SetLight(sun);
+            lighting.shadowMap = &shadowMap;
+        }
+
+        // local reflection probes, the model bounds are split into equal boxes along their longest axis
+        lights::ReflectionProbes probes;
+        if (probeCount > 0)
+        {
+            assert(probes.Initialize());
+            probes.SetEnvironment(envCubemap, irradianceMap);
+            probes.SetFrameBudget(probeBudgetMilliseconds);
+            glm::vec3 boundsMin = model.GetBoundsMin();
+            glm::vec3 boundsMax = model.GetBoundsMax();
+            glm::vec3 size = boundsMax - boundsMin;
+            int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+            for (unsigned int i = 0; i < probeCount; ++i)
+            {
+                glm::vec3 boxMin = boundsMin;
+                glm::vec3 boxMax = boundsMax;
+                boxMin[axis] = boundsMin[axis] + size[axis] * i / probeCount;
+                boxMax[axis] = boundsMin[axis] + size[axis] * (i + 1) / probeCount;
+                if (!probes.AddProbe(0.5f * (boxMin + boxMax), boxMin, boxMax))
+                {
+                    std::cerr << "Warning: at most " << lights::ReflectionProbes::kMaxProbes << " reflection probes are supported" << std::endl;
+                    break;
+                }
+            }
+            lighting.probes = &probes;
+        }
+        double lastStatsTime = glfwGetTime();
+        {
+            // run twice, or with --clear-shader-cache, to compare a cold and a warm cache
+            const shader::ProgramCacheStats& cacheStats = shader::GetProgramCacheStats();
+            std::cout << "Startup " << lastStatsTime * 1000.0 << " ms, shader programs: " << cacheStats.hits << " from the cache in " << cacheStats.loadMilliseconds
+                << " ms, " << cacheStats.misses << " compiled in " << cacheStats.compileMilliseconds << " ms on this thread";
+            std::cout << ", compile " << (!parallelShaderCompile ? "serial" : shader::IsParallelShaderCompileAvailable() ? "parallel (KHR_parallel_shader_compile)" : "deferred (no KHR_parallel_shader_compile)");
+            if (cacheStats.rejected > 0) std::cout << " (" << cacheStats.rejected << " cached binaries rejected by the driver)";
+            std::cout << std::endl;
+        }
+
+        if (lightSweep)
+        {
+            runLightSweep(window, *renderer, target, model, lighting, lightGrid, lightRange);
+            glfwSetWindowShouldClose(window, true);
+        }
+        if (storageComparison || multiScatterComparison)
+        {
+            // a static view, the lights and the shadows only need to be set up once
+            lightGrid.Update(sceneLights, camera->GetViewMatrix(), camera->GetProjectionMatrix());
+            if (sunEnabled) shadowMap.Update(model, camera->GetViewMatrix(), camera->GetProjectionMatrix());
+            if (storageComparison) runStorageComparison(window, *renderer, target, model, lighting, octahedralAtlas, ibl::GetIBLPreset(iblQuality));
+            if (multiScatterComparison) runMultiScatterComparison(window, *renderer, target, model, lighting);
+            glfwSetWindowShouldClose(window, true);
+        }
+
+        // the turntable orbits the model center at the start distance of the camera
+        glm::vec3 turntableCenter = 0.5f * (model.GetBoundsMin() + model.GetBoundsMax());
+        glm::vec3 turntableOffset = camera->GetPosition() - turntableCenter;
+        int frameIndex = 0;
+        // turntable frames are read back a few frames late and written on worker threads, the loop never waits on them
+        renderers::AsyncReadback readback;
+        std::unique_ptr<utility::ImageWriteQueue> frameWriter;
+        if (turntableFrames > 0 && !outputPath.empty())
+        {
+            assert(readback.Initialize());
+            frameWriter = std::make_unique<utility::ImageWriteQueue>();
+        }
+        profiling::Profiler& profiler = profiling::GetProfiler();
+        // frame times and GL counters from the first frame on, the overlay needs a window to show on
+        profiling::FrameStats frameStats;
+        renderers::StatsHud hud;
+        if (showStats && !headless)
+        {
+            assert(hud.Initialize());
+            statsHud = &hud;
+        }
+        bool hudKeyDown = false;
+        if (collectStats) frameStats.Start();
         while(!glfwWindowShouldClose(window))
         {
+            profiler.BeginFrame();
+            profiler.BeginScope("frame");
             float currentFrame = glfwGetTime();
             deltaTime = currentFrame - lastFrame;
             lastFrame = currentFrame;
             processInput(window);
-
-            glClearColor(0.2f, 0.3f, 0.3f, 1.0f); // set the color to clear the screen
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            pbrShader.Use();
-
-            // bind pre-computed IBL data
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
-
-            // render the loaded model
-            glm::mat4 model_mat = glm::mat4(1.0f);
-            pbrShader.SetUniform("model", model_mat);
-            pbrShader.SetUniform("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model_mat))));
-            auto view_mat = camera->GetViewMatrix();
-            pbrShader.SetUniform("view", view_mat);
-            auto projection_mat = camera->GetProjectionMatrix();
-            pbrShader.SetUniform("projection", projection_mat);
-            pbrShader.SetUniform("camPos", camera->GetPosition());
-            pbrShader.SetUniform("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model_mat))));
-            model.Draw(pbrShader);
-
-            glfwSwapBuffers(window);
-            glfwPollEvents();
+            if (turntableFrames > 0)
+            {
+                float angle = glm::radians(360.0f) * frameIndex / turntableFrames;
+                glm::vec3 offset = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(turntableOffset, 0.0f);
+                camera->LookAt(turntableCenter + offset, turntableCenter);
+            }
+            // edited shader files are recompiled between frames, the model and the IBL maps stay as they are
+            if (shaderHotReload) shader::ReloadChangedShaders();
+
+            glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
+            renderer->Resize(scrWidth, scrHeight);
+            target.Resize(scrWidth, scrHeight);
+            renderer->SetOutputFramebuffer(target.GetFramebuffer());
+            profiler.BeginScope("light binning");
+            lightGrid.Update(sceneLights, camera->GetViewMatrix(), camera->GetProjectionMatrix());
+            profiler.EndScope();
+
+            // N switches to the next environment
+            bool environmentKeyPressed = glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS;
+            if (environmentKeyPressed && !environmentKeyDown && environments.size() > 1)
+            {
+                environmentIndex = (environmentIndex + 1) % environments.size();
+                environmentBaker.Request(environments[environmentIndex]);
+                environmentRequestTime = glfwGetTime();
+            }
+            environmentKeyDown = environmentKeyPressed;
+            profiler.BeginScope("environment bake");
+            bool environmentBaked = environmentBaker.Update(environmentBakeBudgetMilliseconds);
+            profiler.EndScope();
+            if (environmentBaked)
+            {
+                lighting.ibl.irradianceMap = environmentBaker.GetMaps().irradianceMap;
+                lighting.ibl.prefilterMap = environmentBaker.GetMaps().prefilterMap;
+                probes.SetEnvironment(environmentBaker.GetMaps().envCubemap, environmentBaker.GetMaps().irradianceMap);
+                if (lighting.ibl.octahedralAtlas) octahedralAtlas.Store(0, environmentBaker.GetMaps().irradianceMap, environmentBaker.GetMaps().prefilterMap);
+                std::cout << "Environment " << environmentBaker.GetPath() << " baked in " << (glfwGetTime() - environmentRequestTime) * 1000.0 << " ms" << std::endl;
+            }
+
+            if (sunEnabled)
+            {
+                // Q/E swing the sun around the vertical axis, which invalidates the cached cascades
+                float sunTurn = 0.0f;
+                if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) sunTurn -= deltaTime;
+                if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) sunTurn += deltaTime;
+                if (sunTurn != 0.0f)
+                {
+                    sun.direction = glm::rotate(glm::mat4(1.0f), sunTurn, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(sun.direction, 0.0f);
+                    shadowMap.SetLight(sun);
+                }
+                profiler.BeginScope("shadows");
+                shadowMap.Update(model, camera->GetViewMatrix(), camera->GetProjectionMatrix());
+                profiler.EndScope();
+            }
+            if (probeCount > 0)
+            {
+                profiler.BeginScope("probes");
+                probes.Update(model, sunEnabled ? &sun : nullptr);
+                profiler.EndScope();
+            }
+
+            if ((sunEnabled || probeCount > 0) && currentFrame - lastStatsTime > 1.0)
+            {
+                lastStatsTime = currentFrame;
+                std::string title = "OpenGL Viewer";
+                if (sunEnabled)
+                {
+                    title += " | cascade ms";
+                    for (unsigned int i = 0; i < lights::CascadedShadowMap::kCascadeCount; ++i)
+                    {
+                        const lights::CascadeStats& stats = shadowMap.GetStats(i);
+                        title += " " + std::to_string(stats.averageGpuMilliseconds).substr(0, 5) + " (" + std::to_string(stats.renderCount) + "x)";
+                    }
+                }
+                if (probeCount > 0)
+                {
+                    // gpu time the probe updates take per frame, and the cost of each kind of step
+                    const lights::ReflectionProbeStats& stats = probes.GetStats();
+                    title += " | probe ms/frame " + std::to_string(stats.averageFrameGpuMilliseconds).substr(0, 5)
+                        + " face " + std::to_string(stats.averageCaptureMilliseconds).substr(0, 5)
+                        + " blur " + std::to_string(stats.averageFilterMilliseconds).substr(0, 5)
+                        + " (" + std::to_string(stats.faceCount) + " faces)";
+                }
+                glfwSetWindowTitle(window, title.c_str());
+            }
+            {
+                PROFILE_ZONE("submit");
+                renderer->Render(model, *camera, lighting);
+            }
+            profiler.EndScope();
+
+            if (frameWriter)
+            {
+                std::string path = numberedPath(outputPath, frameIndex);
+                readback.Request(target, renderers::GetReadbackFormat(path), [&frameWriter, path](utility::DisplayImage&& image)
+                {
+                    frameWriter->Write(path, std::move(image));
+                });
+                readback.Poll();
+            }
+            if (collectStats)
+            {
+                // the frame's counters stop here, the overlay and the swap don't add to them
+                frameStats.EndFrame();
+                bool hudKeyPressed = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+                if (hudKeyPressed && !hudKeyDown) statsHudVisible = !statsHudVisible;
+                hudKeyDown = hudKeyPressed;
+                if (statsHud) statsHud->Update(frameStats);
+            }
+            presentFrame(window, target);
+            ++frameIndex;
+            if (frameLimit > 0 && frameIndex >= frameLimit) glfwSetWindowShouldClose(window, true);
+        }
+        if (frameWriter)
+        {
+            readback.Flush();
+            frameWriter->Wait();
+            std::cout << "Wrote " << frameWriter->GetWrittenCount() << " frames to " << numberedPath(outputPath, 0) << " ..., " << readback.GetStallCount() << " readback stalls" << std::endl;
         }
+        else if (!outputPath.empty()) writeFrame(target, outputPath);
+        if (collectStats)
+        {
+            if (showStats) frameStats.PrintSummary();
+            if (statsCSVPath) frameStats.WriteCSV(statsCSVPath);
+        }
+        statsHud = nullptr;
+        if (profiler.IsEnabled())
+        {
+            // the last frames are still in flight, wait for them while the context is alive
+            profiler.Flush();
+            if (profile) profiler.PrintStats();
+            if (profileTracePath) profiler.WriteChromeTrace(profileTracePath);
+        }
+        renderer.reset(); // its programs and targets need the context
     }
     glfwTerminate();
     
     return 0;
 }
 
-unsigned int cubeVAO = 0;
-unsigned int cubeVBO = 0;
-void renderCube()
+// shows the frame in the window, headless there is nothing to show
+void presentFrame(GLFWwindow* window, const renderers::RenderTarget& target)
 {
-    // initialize (if necessary)
-    if (cubeVAO == 0)
+    if (!headless)
     {
-        float vertices[] = {
-            // back face
-            -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-             1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-             1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right         
-             1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-            -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-            -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
-            // front face
-            -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-             1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
-             1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-             1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-            -1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
-            -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-            // left face
-            -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-            -1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
-            -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-            -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-            -1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-            -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-            // right face
-             1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-             1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-             1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right         
-             1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-             1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-             1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left     
-            // bottom face
-            -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-             1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
-             1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-             1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-            -1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-            -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-            // top face
-            -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-             1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-             1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right     
-             1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-            -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-            -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
-        };
-        glGenVertexArrays(1, &cubeVAO);
-        glGenBuffers(1, &cubeVBO);
-        // fill buffer
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-        // link vertex attributes
-        glBindVertexArray(cubeVAO);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        target.BlitToDefault();
+        if (statsHud && statsHudVisible) statsHud->Draw(target.GetWidth(), target.GetHeight());
+        // blocks once the driver is frames ahead, time here is time waiting on the GPU
+        PROFILE_ZONE("swap");
+        glfwSwapBuffers(window);
     }
-    // render Cube
-    glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    glfwPollEvents();
 }
 
-// renderQuad() renders a 1x1 XY quad in NDC
-// -----------------------------------------
-unsigned int quadVAO = 0;
-unsigned int quadVBO;
-void renderQuad()
+// writes the target's image as displayed, see utility::WriteDisplayImage
+bool writeFrame(const renderers::RenderTarget& target, const std::string& path)
 {
-    if (quadVAO == 0)
-    {
-        float quadVertices[] = {
-            // positions        // texture Coords
-            -1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
-            -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-             1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
-             1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-        };
-        // setup plane VAO
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    }
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+    std::vector<float> pixels;
+    target.ReadRGB32F(pixels);
+    bool written = utility::WriteDisplayImage(path, target.GetWidth(), target.GetHeight(), pixels.data());
+    if (written) std::cout << "Wrote " << path << std::endl;
+    return written;
 }
 
-void precompute(unsigned int& envCubemap, unsigned int& irradianceMap, unsigned int &prefilterMap, unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6])
+// "turntable.png", 7 -> "turntable_0007.png"
+std::string numberedPath(const std::string& path, int number)
 {
-    equirectangularToCubemapShader(envCubemap, captureFBO, captureProjection, captureViews);
-    renderIrradianceCubemap(irradianceMap, envCubemap, captureFBO, captureRBO, captureProjection, captureViews);
-    renderPrefilterCubemap(prefilterMap, envCubemap, captureFBO, captureRBO, captureProjection, captureViews);
-    renderBRDFLUT(brdfLUTTexture, captureFBO, captureRBO);
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "_%04d", number);
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + suffix;
+    return path.substr(0, dot) + suffix + path.substr(dot);
 }
 
-void equirectangularToCubemapShader(unsigned int& envCubemap, unsigned int captureFBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6])
+// renders a fixed number of frames for growing light counts and prints the average cost of each step
+void runLightSweep(GLFWwindow* window, renderers::Renderer& renderer, const renderers::RenderTarget& target, Model& model, const renderers::LightingInputs& lighting, lights::ClusteredLightGrid& lightGrid, float lightRange)
 {
-    // pbr: load the HDR environment map
-    // ---------------------------------
-    int width, height, nrComponents;
-    float *data = stbi_loadf("../resources/environmentMap/courtyard.hdr", &width, &height, &nrComponents, 0);
-    unsigned int hdrTexture;
-    if (data)
-    {
-        glGenTextures(1, &hdrTexture);
-        glBindTexture(GL_TEXTURE_2D, hdrTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); // note how we specify the texture's data value to be float
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    const unsigned int lightCounts[] = { 1, 10, 100, 500, 1000, 2500, 5000, 10000 };
+    const int framesPerStep = 120;
 
-        stbi_image_free(data);
-    }
-    else
+    std::cout << "lights, binning ms, frame ms, light indices" << std::endl;
+    for (unsigned int count : lightCounts)
     {
-        std::cout << "Failed to load HDR image." << std::endl;
+        std::vector<lights::Light> sweepLights = lights::GenerateRandomLights(count, model.GetBoundsMin(), model.GetBoundsMax(), lightRange);
+        double binningMilliseconds = 0.0;
+        double frameMilliseconds = 0.0;
+        int frames = 0;
+        for (; frames < framesPerStep && !glfwWindowShouldClose(window); ++frames)
+        {
+            double start = glfwGetTime();
+            lightGrid.Update(sweepLights, camera->GetViewMatrix(), camera->GetProjectionMatrix());
+            renderer.Render(model, *camera, lighting);
+            glFinish(); // wait for the gpu so the frame time covers the whole frame
+            frameMilliseconds += (glfwGetTime() - start) * 1000.0;
+            binningMilliseconds += lightGrid.GetBinningMilliseconds();
+
+            presentFrame(window, target);
+        }
+        if (frames == 0) break;
+        std::cout << count << ", " << binningMilliseconds / frames << ", " << frameMilliseconds / frames << ", " << lightGrid.GetIndexCount() << std::endl;
     }
+}
 
-    Shader equirectangularToCubemapShader;
-    assert(equirectangularToCubemapShader.Initialize("../shader/cubemap.vert", "../shader/equirectangular_to_cubemap.frag"));
-    // pbr: setup cubemap to render to and attach to framebuffer
-    // ---------------------------------------------------------
-    glGenTextures(1, &envCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // pbr: convert HDR equirectangular environment map to cubemap equivalent
-    // ----------------------------------------------------------------------
-    equirectangularToCubemapShader.Use();
-    equirectangularToCubemapShader.SetUniform("equirectangularMap", 0);
-    equirectangularToCubemapShader.SetUniform("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrTexture);
-
-    glViewport(0, 0, 512, 512); // don't forget to configure the viewport to the capture dimensions.
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
+// renders the same view with every variant and fills in their frame time and last image.
+// The variants take turns over several rounds so clock and thermal drift affect all of them alike
+void runLightingComparison(GLFWwindow* window, renderers::Renderer& renderer, const renderers::RenderTarget& target, Model& model, std::vector<LightingVariant>& variants)
+{
+    const int rounds = 5;
+    const int warmupFrames = 10;
+    const int timedFrames = 60;
+
+    std::vector<double> minRound(variants.size(), std::numeric_limits<double>::max());
+    std::vector<double> maxRound(variants.size(), 0.0);
+    for (LightingVariant& variant : variants) variant.frameMilliseconds = 0.0;
+    for (int round = 0; round < rounds; ++round)
     {
-        equirectangularToCubemapShader.SetUniform("view", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        renderCube();
+        for (size_t v = 0; v < variants.size(); ++v)
+        {
+            LightingVariant& variant = variants[v];
+            double roundMilliseconds = 0.0;
+            for (int frame = 0; frame < warmupFrames + timedFrames; ++frame)
+            {
+                if (glfwWindowShouldClose(window)) return;
+                double start = glfwGetTime();
+                renderer.Render(model, *camera, variant.lighting);
+                glFinish(); // wait for the gpu so the frame time covers the whole frame
+                if (frame >= warmupFrames) roundMilliseconds += (glfwGetTime() - start) * 1000.0;
+                if (round == rounds - 1 && frame == warmupFrames + timedFrames - 1) target.ReadRGB8(variant.image);
+                presentFrame(window, target);
+            }
+            roundMilliseconds /= timedFrames;
+            variant.frameMilliseconds += roundMilliseconds / rounds;
+            minRound[v] = std::min(minRound[v], roundMilliseconds);
+            maxRound[v] = std::max(maxRound[v], roundMilliseconds);
+        }
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // then let OpenGL generate mipmaps from first mip face (combatting visible dots artifact)
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    for (size_t v = 0; v < variants.size(); ++v) variants[v].frameMillisecondsSpread = maxRound[v] - minRound[v];
 }
 
-void renderIrradianceCubemap(unsigned int& irradianceMap, unsigned int envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6])
+// PSNR and max channel difference of two RGB8 images of the same size
+void compareImages(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, double& psnr, int& maxDifference)
 {
-    Shader irradianceShader;
-    assert(irradianceShader.Initialize("../shader/cubemap.vert", "../shader/irradiance_convolution.frag"));
-    // pbr: create an irradiance cubemap, and re-scale capture FBO to irradiance scale.
-    // --------------------------------------------------------------------------------
-    glGenTextures(1, &irradianceMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-    for (unsigned int i = 0; i < 6; ++i)
+    double squaredError = 0.0;
+    maxDifference = 0;
+    for (size_t i = 0; i < a.size(); ++i)
     {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
+        int difference = std::abs(a[i] - b[i]);
+        squaredError += difference * difference;
+        maxDifference = std::max(maxDifference, difference);
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-    // pbr: solve diffuse integral by convolution to create an irradiance (cube)map.
-    // -----------------------------------------------------------------------------
-    irradianceShader.Use();
-    irradianceShader.SetUniform("environmentMap", 0);
-    irradianceShader.SetUniform("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-
-    glViewport(0, 0, 32, 32); // don't forget to configure the viewport to the capture dimensions.
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        irradianceShader.SetUniform("view", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        renderCube();
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    double meanSquaredError = squaredError / a.size();
+    psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
 }
 
-void renderPrefilterCubemap(unsigned int &prefilterMap, unsigned int envCubemap, unsigned int captureFBO, unsigned int captureRBO, const glm::mat4& captureProjection, const glm::mat4 captureViews[6])
+// prints the frame time of every variant and the difference of its last frame to the first variant
+void printLightingComparison(const std::vector<LightingVariant>& variants)
 {
-    Shader prefilterShader;
-    assert(prefilterShader.Initialize("../shader/cubemap.vert", "../shader/prefilter.frag"));
-    glGenTextures(1, &prefilterMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
-    for (unsigned int i = 0; i < 6; ++i)
+    std::cout << "variant, frame ms, round spread ms, PSNR dB, max difference" << std::endl;
+    for (const LightingVariant& variant : variants)
     {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 128, 128, 0, GL_RGB, GL_FLOAT, nullptr);
+        double psnr = std::numeric_limits<double>::infinity();
+        int maxDifference = 0;
+        if (!variant.image.empty() && variant.image.size() == variants[0].image.size()) compareImages(variants[0].image, variant.image, psnr, maxDifference);
+        std::cout << variant.name << ", " << variant.frameMilliseconds << ", " << variant.frameMillisecondsSpread << ", " << psnr << ", " << maxDifference << std::endl;
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // be sure to set minification filter to mip_linear 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // generate mipmaps for the cubemap so OpenGL automatically allocates the required memory.
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    // pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map.
-    // ----------------------------------------------------------------------------------------------------
-    prefilterShader.Use();
-    prefilterShader.SetUniform("environmentMap", 0);
-    prefilterShader.SetUniform("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    unsigned int maxMipLevels = 5;
-    for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
-    {
-        // reisze framebuffer according to mip-level size.
-        unsigned int mipWidth = static_cast<unsigned int>(128 * std::pow(0.5, mip));
-        unsigned int mipHeight = static_cast<unsigned int>(128 * std::pow(0.5, mip));
-        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-        glViewport(0, 0, mipWidth, mipHeight);
-
-        float roughness = (float)mip / (float)(maxMipLevels - 1);
-        prefilterShader.SetUniform("roughness", roughness);
-        for (unsigned int i = 0; i < 6; ++i)
-        {
-            prefilterShader.SetUniform("view", captureViews[i]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, prefilterMap, mip);
+}
 
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            renderCube();
-        }
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+// renders the same view with the cubemap and the octahedral IBL storage and prints memory, frame time and image difference
+void runStorageComparison(GLFWwindow* window, renderers::Renderer& renderer, const renderers::RenderTarget& target, Model& model, const renderers::LightingInputs& lighting, const ibl::OctahedralAtlas& atlas, const ibl::IBLSettings& settings)
+{
+    std::vector<LightingVariant> variants(2);
+    variants[0].name = "cubemap";
+    variants[0].lighting = lighting;
+    variants[0].lighting.ibl.octahedralAtlas = nullptr;
+    variants[1].name = std::string("octahedral ") + ibl::GetOctahedralFormatName(atlas.GetFormat());
+    variants[1].lighting = lighting;
+    variants[1].lighting.ibl.octahedralAtlas = &atlas;
+    variants[1].lighting.ibl.octahedralSlot = 0;
+    runLightingComparison(window, renderer, target, model, variants);
+
+    std::cout << "storage, IBL bytes" << std::endl;
+    std::cout << variants[0].name << ", " << ibl::EstimateCubemapMemoryBytes(settings) << std::endl;
+    std::cout << variants[1].name << ", " << atlas.GetMemoryBytes() << std::endl;
+    printLightingComparison(variants);
 }
 
-void renderBRDFLUT(unsigned int &brdfLUTTexture, unsigned int captureFBO, unsigned int captureRBO)
+// renders the same view with and without the multi-scatter energy compensation and prints frame time and image difference
+void runMultiScatterComparison(GLFWwindow* window, renderers::Renderer& renderer, const renderers::RenderTarget& target, Model& model, const renderers::LightingInputs& lighting)
 {
-    Shader brdfShader;
-    assert(brdfShader.Initialize("../shader/brdf.vert", "../shader/brdf.frag"));
-
-    glGenTextures(1, &brdfLUTTexture);
-
-    // pre-allocate enough memory for the LUT texture.
-    glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, 512, 512, 0, GL_RG, GL_FLOAT, 0);
-    // be sure to set wrapping mode to GL_CLAMP_TO_EDGE
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // then re-configure capture framebuffer object and render screen-space quad with BRDF shader.
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
-
-    glViewport(0, 0, 512, 512);
-    brdfShader.Use();
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    renderQuad();
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    std::vector<LightingVariant> variants(2);
+    variants[0].name = "single scatter";
+    variants[0].lighting = lighting;
+    variants[0].lighting.ibl.multiScatter = false;
+    variants[1].name = "multi scatter";
+    variants[1].lighting = lighting;
+    variants[1].lighting.ibl.multiScatter = true;
+    runLightingComparison(window, renderer, target, model, variants);
+    printLightingComparison(variants);
 }
\ No newline at end of file
@@ -6,6 +6,44 @@ namespace object3ds
 {
 using shader::Shader;
 
+const char* GetMaterialFeatureDefine(unsigned int featureBit)
+{
+    switch (featureBit)
+    {
+        case MaterialAlbedoMap: return "HAS_ALBEDO_MAP";
+        case MaterialNormalMap: return "HAS_NORMAL_MAP";
+        case MaterialMetallicRoughnessMap: return "HAS_METALLIC_ROUGHNESS_MAP";
+        case MaterialAOMap: return "HAS_AO_MAP";
+        case MaterialEmissiveMap: return "HAS_EMISSIVE_MAP";
+        default: return nullptr;
+    }
+}
+
+std::vector<const char*> GetMaterialFeatureDefines(unsigned int featureMask)
+{
+    std::vector<const char*> defines(kMaterialFeatureCount, nullptr);
+    for (unsigned int i = 0; i < kMaterialFeatureCount; ++i)
+    {
+        if (featureMask & (1u << i)) defines[i] = GetMaterialFeatureDefine(1u << i);
+    }
+    return defines;
+}
+
+unsigned int Mesh::computeMaterialFeatures(const std::vector<Texture>& textures)
+{
+    // the shaders only read the first texture of every type, see Draw
+    unsigned int features = 0;
+    for (const Texture& texture : textures)
+    {
+        if (texture.type == "albedo") features |= MaterialAlbedoMap;
+        else if (texture.type == "normal") features |= MaterialNormalMap;
+        else if (texture.type == "metallic") features |= MaterialMetallicRoughnessMap;
+        else if (texture.type == "ao") features |= MaterialAOMap;
+        else if (texture.type == "emissive") features |= MaterialEmissiveMap;
+    }
+    return features;
+}
+
 void Mesh::SetupMesh()
 {
     glGenVertexArrays(1, &m_VAO);
@@ -74,6 +112,13 @@ void Mesh::Draw(Shader& shader)
     glActiveTexture(GL_TEXTURE0);
 }
 
+void Mesh::DrawGeometry()
+{
+    glBindVertexArray(m_VAO);
+    glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
 Mesh::~Mesh()
 {
     glDeleteVertexArrays(1, &m_VAO);
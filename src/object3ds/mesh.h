@@ -22,29 +22,53 @@ struct Texture
     std::string type;
 };
 
+// material textures a mesh provides, the bitmask selects the shader permutation drawing it
+enum MaterialFeature : unsigned int
+{
+    MaterialAlbedoMap = 1u << 0,
+    MaterialNormalMap = 1u << 1,
+    MaterialMetallicRoughnessMap = 1u << 2, // metallic in b, roughness in g
+    MaterialAOMap = 1u << 3,
+    MaterialEmissiveMap = 1u << 4
+};
+constexpr unsigned int kMaterialFeatureCount = 5;
+
+// the #define the shaders test for the feature bit, e.g. HAS_NORMAL_MAP
+const char* GetMaterialFeatureDefine(unsigned int featureBit);
+// the defines of the features in the mask indexed by bit, null for the others (see shader::ShaderPermutations)
+std::vector<const char*> GetMaterialFeatureDefines(unsigned int featureMask);
+
 class Mesh
 {
 public:
     Mesh(std::vector<Vertex>&& vertices, std::vector<unsigned int>&& indices, std::vector<Texture>&& textures)
-        : m_vertices(vertices), m_indices(indices), m_textures(textures) { }
+        : m_vertices(vertices), m_indices(indices), m_textures(textures), m_materialFeatures(computeMaterialFeatures(m_textures)) { }
 
     Mesh(Mesh&& other)
         : m_vertices(std::move(other.m_vertices)), m_indices(std::move(other.m_indices)), m_textures(std::move(other.m_textures)),
-            m_VAO(other.m_VAO), m_VBO(other.m_VBO), m_EBO(other.m_EBO)
+            m_materialFeatures(other.m_materialFeatures), m_VAO(other.m_VAO), m_VBO(other.m_VBO), m_EBO(other.m_EBO)
     {
         other.m_vertices.clear(); other.m_indices.clear(); other.m_textures.clear();
+        other.m_materialFeatures = 0;
         other.m_VAO = 0; other.m_VBO = 0; other.m_EBO = 0;
     }
 
     void Draw(Shader& shader);
+    // draws the geometry without binding any material texture
+    void DrawGeometry();
+
+    // MaterialFeature bits of the textures the mesh has
+    inline unsigned int GetMaterialFeatures() const { return m_materialFeatures; }
     
     void SetupMesh();
     ~Mesh();
 private:
+    static unsigned int computeMaterialFeatures(const std::vector<Texture>& textures);
 
     std::vector<Vertex> m_vertices;
     std::vector<unsigned int> m_indices;
     std::vector<Texture> m_textures;
+    unsigned int m_materialFeatures = 0;
 
     unsigned int m_VAO;
     unsigned int m_VBO;
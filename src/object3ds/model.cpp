@@ -2,17 +2,49 @@
 #include "object3ds/model.h"
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
+#include <algorithm>
 #include <iostream>
+#include "profiling/zones.h"
 #include "utility/stb_image.h"
 
 namespace object3ds
 {
 using shader::Shader;
 
+void TransformVertices(const aiMesh& mesh, const glm::mat4& transform, std::vector<Vertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+    vertices.resize(mesh.mNumVertices);
+    for (unsigned int i = 0; i < mesh.mNumVertices; i++)
+    {
+        Vertex& vertex = vertices[i];
+        // process vertex positions, normals and texture coordinates
+        vertex.position = transform * glm::vec4(mesh.mVertices[i].x, mesh.mVertices[i].y, mesh.mVertices[i].z, 1.0f);
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+        vertex.normal = glm::normalize(normalMatrix * glm::vec3(mesh.mNormals[i].x, mesh.mNormals[i].y, mesh.mNormals[i].z));
+        // does the mesh contain texture coordinates?
+        vertex.texCoords = mesh.mTextureCoords[0] ? glm::vec2(mesh.mTextureCoords[0][i].x, mesh.mTextureCoords[0][i].y) : glm::vec2(0.0f, 0.0f);
+    }
+}
+
+Model::~Model()
+{
+    for (const auto& texture : m_textures_loaded) glDeleteTextures(1, &texture.second.id);
+}
+
 void Model::Load(const char* path)
 {
+    PROFILE_ZONE("Model::Load");
+    std::string pathString(path);
+    size_t slash = pathString.find_last_of("/\\");
+    m_directory = slash == std::string::npos ? "." : pathString.substr(0, slash);
     Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    const aiScene *scene;
+    {
+        PROFILE_ZONE("Assimp::ReadFile");
+        scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    }
     if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode)
     {
         std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
@@ -20,7 +52,9 @@ void Model::Load(const char* path)
     }
 
     processNode(scene->mRootNode, scene, glm::mat4(1.0f));
+    m_drawOrders.clear();
 
+    PROFILE_ZONE("SetupMesh");
     for (int i = 0; i < m_meshes.size(); ++i)
     {
         m_meshes[i].SetupMesh();
@@ -35,6 +69,54 @@ void Model::Draw(Shader& shader)
     }
 }
 
+void Model::Draw(shader::ShaderPermutations& shaders, const std::function<void(Shader&)>& bindProgram)
+{
+    unsigned int featureMask = shaders.GetFeatureMask();
+    unsigned int boundFeatures = 0;
+    Shader* shader = nullptr;
+    bool bound = false;
+    for (unsigned int index : getDrawOrder(featureMask))
+    {
+        unsigned int features = m_meshes[index].GetMaterialFeatures() & featureMask;
+        if (!bound || features != boundFeatures)
+        {
+            shader = shaders.Get(features);
+            boundFeatures = features;
+            bound = true;
+            if (shader)
+            {
+                shader->Use();
+                bindProgram(*shader);
+            }
+        }
+        // the permutation failed to compile, skip its meshes rather than drawing them with another program
+        if (shader) m_meshes[index].Draw(*shader);
+    }
+}
+
+const std::vector<unsigned int>& Model::getDrawOrder(unsigned int featureMask)
+{
+    auto iter = m_drawOrders.find(featureMask);
+    if (iter != m_drawOrders.end()) return iter->second;
+
+    std::vector<unsigned int> order(m_meshes.size());
+    for (unsigned int i = 0; i < order.size(); ++i) order[i] = i;
+    // stable, meshes of one permutation keep the file order
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+    {
+        return (m_meshes[a].GetMaterialFeatures() & featureMask) < (m_meshes[b].GetMaterialFeatures() & featureMask);
+    });
+    return m_drawOrders.emplace(featureMask, std::move(order)).first->second;
+}
+
+void Model::DrawGeometry()
+{
+    for (int i = 0; i < m_meshes.size(); ++i)
+    {
+        m_meshes[i].DrawGeometry();
+    }
+}
+
 void Model::processNode(aiNode* node, const aiScene* scene, const glm::mat4& parentTransform)
 {
     auto nodeTransform = node->mTransformation;
@@ -58,30 +140,13 @@ void Model::processNode(aiNode* node, const aiScene* scene, const glm::mat4& par
 
 Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, const glm::mat4& transform)
 {
+    PROFILE_ZONE("processMesh");
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
-    auto normalMatrix = glm::transpose(glm::inverse(transform));
-    // process vertices
-    for(unsigned int i = 0; i < mesh->mNumVertices; i++)
-    {
-        Vertex vertex;
-        // process vertex positions, normals and texture coordinates
-        vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
-        vertex.position = transform * glm::vec4(vertex.position, 1.0f);
-        vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-        vertex.normal = glm::normalize(normalMatrix * glm::vec4(vertex.normal, 0.0f));
-        if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
-        {
-            vertex.texCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-        }
-        else
-        {
-            vertex.texCoords = glm::vec2(0.0f, 0.0f);
-        }
-        vertices.push_back(vertex);
-    }
+    TransformVertices(*mesh, transform, vertices, m_boundsMin, m_boundsMax);
     // process indices
+    indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
     for(unsigned int i = 0; i < mesh->mNumFaces; i++)
     {
         aiFace face = mesh->mFaces[i];
@@ -140,7 +205,7 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material, aiTexture
         else
         {   // if texture hasn’t been loaded already, load it
             Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), "resources/psr-13/");
+            texture.id = TextureFromFile(str.C_Str(), m_directory);
             texture.type = typeName;
             textures.push_back(texture);
             m_textures_loaded.insert(std::make_pair(str.C_Str(), texture)); // store it as texture loaded for entire model, to ensure we won’t unnecesery load duplicate textures.
@@ -151,6 +216,7 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material, aiTexture
 
 unsigned int Model::TextureFromFile(const char* path, const std::string& directory)
 {
+    PROFILE_ZONE("TextureFromFile");
     std::string filename = std::string(path);
     filename = directory + '/' + filename;
     unsigned int textureID;
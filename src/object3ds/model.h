@@ -1,27 +1,55 @@
 #pragma once
+#include <functional>
 #include <vector>
 #include <unordered_map>
+#include <limits>
 #include "object3ds/mesh.h"
+#include "shader/shader_permutations.h"
 #include <assimp/scene.h>
 
 namespace object3ds
 {
 
+// the vertices of an assimp mesh in world space: positions by transform, normals by its inverse transpose.
+// boundsMin and boundsMax grow to enclose the transformed positions
+void TransformVertices(const aiMesh& mesh, const glm::mat4& transform, std::vector<Vertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
 class Model
 {
 public:
     Model() = default;
+    // deletes the textures, the meshes delete their own buffers
+    ~Model();
+
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
 
+    // the textures are looked up next to the model file
     void Load(const char* path);
 
     void Draw(Shader& shader);
+    // draws every mesh with the permutation of its material features. The meshes are drawn grouped by
+    // permutation, each program is bound once and bindProgram sets the per frame uniforms on it
+    void Draw(shader::ShaderPermutations& shaders, const std::function<void(Shader&)>& bindProgram);
+    void DrawGeometry();
+
+    // world space bounding box of all meshes
+    inline glm::vec3 GetBoundsMin() const { return m_boundsMin; }
+    inline glm::vec3 GetBoundsMax() const { return m_boundsMax; }
 private:
     void processNode(aiNode* node, const aiScene* scene, const glm::mat4& parentTransform);
     Mesh processMesh(aiMesh* mesh, const aiScene* scene, const glm::mat4& transform);
     std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
     unsigned int TextureFromFile(const char* path, const std::string& directory);
 
+    // mesh indices sorted by the material features a ShaderPermutations tells apart, keyed by its feature mask
+    const std::vector<unsigned int>& getDrawOrder(unsigned int featureMask);
+
     std::vector<Mesh> m_meshes;
+    std::unordered_map<unsigned int, std::vector<unsigned int>> m_drawOrders;
     std::unordered_map<std::string, Texture> m_textures_loaded;
+    std::string m_directory;
+    glm::vec3 m_boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 m_boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
 };
 } // namespace object3ds
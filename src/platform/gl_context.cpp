@@ -0,0 +1,77 @@
+#include <glad/glad.h>
+#include <cstring>
+#include <iostream>
+#include "platform/gl_context.h"
+
+namespace platform
+{
+
+const char* GetContextBackendName(ContextBackend backend)
+{
+    switch (backend)
+    {
+    case ContextBackend::Window: return "window";
+    case ContextBackend::OSMesa: return "osmesa";
+    case ContextBackend::EGL: return "egl";
+    }
+    return "unknown";
+}
+
+bool ParseContextBackend(const char* name, ContextBackend& backend)
+{
+    for (ContextBackend candidate : { ContextBackend::Window, ContextBackend::OSMesa, ContextBackend::EGL })
+    {
+        if (std::strcmp(name, GetContextBackendName(candidate)) == 0)
+        {
+            backend = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+GLFWwindow* CreateContext(ContextBackend backend, int width, int height, const char* title)
+{
+    // without it a missing display or library only shows up as a null window
+    glfwSetErrorCallback([](int error, const char* description)
+    {
+        std::cerr << "GLFW error " << error << ": " << description << std::endl;
+    });
+    if (IsHeadless(backend))
+    {
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+        std::cerr << "Failed to create a " << GetContextBackendName(backend) << " context: headless rendering needs GLFW 3.4 or newer" << std::endl;
+        return nullptr;
+#endif
+    }
+    if (!glfwInit())
+    {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return nullptr;
+    }
+    // tell glfw the version of opengl
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (backend == ContextBackend::OSMesa) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    else if (backend == ContextBackend::EGL) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+
+    GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
+    if (window == NULL)
+    {
+        std::cerr << "Failed to create a " << GetContextBackendName(backend) << " context" << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+    glfwMakeContextCurrent(window); // make the window the current context
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+    return window;
+}
+} // namespace platform
@@ -0,0 +1,24 @@
+#pragma once
+#include <GLFW/glfw3.h>
+
+namespace platform
+{
+
+// where the OpenGL context comes from
+enum class ContextBackend
+{
+    Window, // a GLFW window on the display
+    OSMesa, // headless, Mesa's software rasterizer (llvmpipe), no GPU or display needed
+    EGL     // headless, a surfaceless EGL context on the GPU's driver, no display needed
+};
+
+const char* GetContextBackendName(ContextBackend backend);
+bool ParseContextBackend(const char* name, ContextBackend& backend);
+inline bool IsHeadless(ContextBackend backend) { return backend != ContextBackend::Window; }
+
+// initializes GLFW, creates the 4.6 core context, makes it current and loads the GL functions.
+// The headless backends go through GLFW's null platform (GLFW 3.4): there is no display and nothing to show, frames
+// are rendered to a renderers::RenderTarget and read back. The returned GLFWwindow exists in every mode, so the
+// timer, the input polling and the close flag behave the same. Returns nullptr, with GLFW terminated, on failure
+GLFWwindow* CreateContext(ContextBackend backend, int width, int height, const char* title);
+} // namespace platform
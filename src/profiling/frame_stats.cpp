@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include "profiling/frame_stats.h"
+#include "profiling/statistics.h"
+#include "profiling/zones.h"
+
+namespace profiling
+{
+
+namespace
+{
+// the edge below bucket i
+double bucketEdge(double i)
+{
+    return FrameStats::kMinMilliseconds * std::pow(FrameStats::kMaxMilliseconds / FrameStats::kMinMilliseconds, i / FrameStats::kBucketCount);
+}
+} // namespace
+
+void FrameStats::Start()
+{
+    ResetGLCounters();
+    m_frameBegin = Now();
+    m_started = true;
+}
+
+void FrameStats::EndFrame()
+{
+    if (!m_started) Start();
+    int64_t now = Now();
+    FrameRecord frame;
+    frame.milliseconds = (now - m_frameBegin) / 1.0e6;
+    frame.counters = GetGLCounters();
+    frame.videoMemoryBytes = GetTrackedVideoMemoryBytes();
+    ResetGLCounters();
+    m_frameBegin = now;
+    m_lastFrame = frame;
+    ++m_frameCount;
+    if (m_records.size() < kMaxRecords) m_records.push_back(frame);
+
+    if (m_window.size() < kWindowFrames) m_window.push_back(frame.milliseconds);
+    else
+    {
+        // the oldest frame leaves the histogram
+        double& oldest = m_window[m_windowNext];
+        --m_buckets[bucketIndex(oldest)];
+        m_windowSum -= oldest;
+        oldest = frame.milliseconds;
+    }
+    m_windowNext = (m_windowNext + 1) % kWindowFrames;
+    m_windowSum += frame.milliseconds;
+    ++m_buckets[bucketIndex(frame.milliseconds)];
+}
+
+double FrameStats::GetPercentile(double fraction) const
+{
+    if (m_window.empty()) return 0.0;
+    size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(fraction * m_window.size())));
+    size_t count = 0;
+    for (size_t i = 0; i < kBucketCount; ++i)
+    {
+        count += m_buckets[i];
+        if (count >= rank) return bucketEdge(i + 0.5);
+    }
+    return kMaxMilliseconds;
+}
+
+double FrameStats::GetAverageMilliseconds() const
+{
+    return m_window.empty() ? 0.0 : m_windowSum / m_window.size();
+}
+
+void FrameStats::PrintSummary() const
+{
+    if (m_records.empty()) return;
+    std::vector<double> times(m_records.size());
+    GLCounters sum;
+    uint64_t peakVideoMemory = 0;
+    for (size_t i = 0; i < m_records.size(); ++i)
+    {
+        const FrameRecord& frame = m_records[i];
+        times[i] = frame.milliseconds;
+        sum.drawCalls += frame.counters.drawCalls;
+        sum.triangles += frame.counters.triangles;
+        sum.dispatches += frame.counters.dispatches;
+        sum.textureBinds += frame.counters.textureBinds;
+        sum.programSwitches += frame.counters.programSwitches;
+        sum.uploads += frame.counters.uploads;
+        sum.uploadBytes += frame.counters.uploadBytes;
+        peakVideoMemory = std::max(peakVideoMemory, frame.videoMemoryBytes);
+    }
+    double frames = static_cast<double>(m_records.size());
+    double total = 0.0;
+    for (double time : times) total += time;
+    std::cout << "frames, avg ms, p50 ms, p95 ms, p99 ms, max ms" << std::endl;
+    std::cout << m_records.size() << ", " << total / frames << ", " << Percentile(times, 0.5) << ", " << Percentile(times, 0.95) << ", "
+        << Percentile(times, 0.99) << ", " << *std::max_element(times.begin(), times.end()) << std::endl;
+    std::cout << "per frame: draws, triangles, dispatches, texture binds, program switches, uploads, upload KB; peak tracked VRAM MB" << std::endl;
+    std::cout << sum.drawCalls / frames << ", " << sum.triangles / frames << ", " << sum.dispatches / frames << ", " << sum.textureBinds / frames << ", "
+        << sum.programSwitches / frames << ", " << sum.uploads / frames << ", " << sum.uploadBytes / frames / 1024.0 << "; " << peakVideoMemory / (1024.0 * 1024.0) << std::endl;
+}
+
+bool FrameStats::WriteCSV(const std::string& path) const
+{
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        std::cerr << "Failed to write the frame stats " << path << std::endl;
+        return false;
+    }
+    std::fprintf(file, "frame,ms,draw_calls,triangles,dispatches,texture_binds,program_switches,uploads,upload_bytes,vram_bytes\n");
+    for (size_t i = 0; i < m_records.size(); ++i)
+    {
+        const FrameRecord& frame = m_records[i];
+        const GLCounters& counters = frame.counters;
+        std::fprintf(file, "%zu,%.4f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", i, frame.milliseconds,
+            static_cast<unsigned long long>(counters.drawCalls), static_cast<unsigned long long>(counters.triangles),
+            static_cast<unsigned long long>(counters.dispatches), static_cast<unsigned long long>(counters.textureBinds),
+            static_cast<unsigned long long>(counters.programSwitches), static_cast<unsigned long long>(counters.uploads),
+            static_cast<unsigned long long>(counters.uploadBytes), static_cast<unsigned long long>(frame.videoMemoryBytes));
+    }
+    bool written = std::ferror(file) == 0;
+    written = std::fclose(file) == 0 && written;
+    if (written) std::cout << "Wrote " << m_records.size() << " frames to " << path << std::endl;
+    else std::cerr << "Failed to write the frame stats " << path << std::endl;
+    return written;
+}
+
+size_t FrameStats::bucketIndex(double milliseconds) const
+{
+    if (milliseconds <= kMinMilliseconds) return 0;
+    double position = std::log(milliseconds / kMinMilliseconds) / std::log(kMaxMilliseconds / kMinMilliseconds) * kBucketCount;
+    return std::min(kBucketCount - 1, static_cast<size_t>(position));
+}
+} // namespace profiling
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "profiling/gl_counters.h"
+
+namespace profiling
+{
+
+// one frame: the time since the previous one and the GL work issued in it
+struct FrameRecord
+{
+    double milliseconds = 0.0;
+    GLCounters counters;
+    uint64_t videoMemoryBytes = 0; // GetTrackedVideoMemoryBytes at the end of the frame
+};
+
+// frame times and GL counters of the viewer. The percentiles come from a histogram of the latest kWindowFrames
+// frame times with logarithmic buckets, so reading them every frame costs the same however long the run is; every
+// frame is also recorded for the report and the CSV at exit. The counters come from InstallGLCounters
+class FrameStats
+{
+public:
+    static constexpr size_t kWindowFrames = 600;       // about 10 s at 60 Hz
+    static constexpr size_t kBucketCount = 256;
+    static constexpr double kMinMilliseconds = 0.05;   // the buckets span 0.05 ms .. 2 s, 4% wide each
+    static constexpr double kMaxMilliseconds = 2000.0;
+    static constexpr size_t kMaxRecords = 1u << 20;    // later frames still count in the histogram
+
+    // starts the first frame, the counters start from zero
+    void Start();
+    // closes the frame: its time since the previous EndFrame (or Start) and the counters since then,
+    // which start over for the next frame
+    void EndFrame();
+
+    // frame time percentile of the window, fraction in 0..1. The center of the bucket the rank falls into
+    double GetPercentile(double fraction) const;
+    double GetAverageMilliseconds() const; // of the window
+    inline const FrameRecord& GetLastFrame() const { return m_lastFrame; }
+    inline size_t GetFrameCount() const { return m_frameCount; }
+
+    // frame time percentiles and counter averages over the whole run
+    void PrintSummary() const;
+    // a row per frame: frame, ms, the counters and the tracked video memory
+    bool WriteCSV(const std::string& path) const;
+
+private:
+    size_t bucketIndex(double milliseconds) const;
+
+    int64_t m_frameBegin = 0; // Now()
+    bool m_started = false;
+    FrameRecord m_lastFrame;
+    size_t m_frameCount = 0;
+
+    std::vector<double> m_window; // ring of the latest frame times
+    size_t m_windowNext = 0;
+    double m_windowSum = 0.0;
+    std::vector<uint32_t> m_buckets = std::vector<uint32_t>(kBucketCount, 0);
+    std::vector<FrameRecord> m_records;
+};
+} // namespace profiling
@@ -0,0 +1,525 @@
+#include <glad/glad.h>
+#include <cstring>
+#include <unordered_map>
+#include "profiling/gl_counters.h"
+
+namespace profiling
+{
+
+namespace
+{
+// image keys of a texture's size table: the cube face (1..6, 0 for the other targets) and the level,
+// and the entries of glTexStorage and of glGenerateMipmap
+constexpr uint32_t kStorageKey = 0xFFFFFFFFu;
+constexpr uint32_t kMipmapKey = 0xFFFFFFFEu;
+
+struct TextureMemory
+{
+    std::unordered_map<uint32_t, uint64_t> images;
+    uint64_t bytes = 0;
+    bool immutable = false; // glTexStorage, every level is allocated up front
+};
+
+// the driver's entry points the hooks forward to
+struct GLFunctions
+{
+    PFNGLDRAWARRAYSPROC drawArrays;
+    PFNGLDRAWELEMENTSPROC drawElements;
+    PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced;
+    PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced;
+    PFNGLDISPATCHCOMPUTEPROC dispatchCompute;
+    PFNGLACTIVETEXTUREPROC activeTexture;
+    PFNGLBINDTEXTUREPROC bindTexture;
+    PFNGLBINDTEXTUREUNITPROC bindTextureUnit;
+    PFNGLUSEPROGRAMPROC useProgram;
+    PFNGLBINDBUFFERPROC bindBuffer;
+    PFNGLBINDBUFFERBASEPROC bindBufferBase;
+    PFNGLBUFFERDATAPROC bufferData;
+    PFNGLBUFFERSUBDATAPROC bufferSubData;
+    PFNGLDELETEBUFFERSPROC deleteBuffers;
+    PFNGLTEXIMAGE2DPROC texImage2D;
+    PFNGLTEXIMAGE3DPROC texImage3D;
+    PFNGLTEXSUBIMAGE2DPROC texSubImage2D;
+    PFNGLTEXSUBIMAGE3DPROC texSubImage3D;
+    PFNGLTEXSTORAGE2DPROC texStorage2D;
+    PFNGLTEXSTORAGE3DPROC texStorage3D;
+    PFNGLGENERATEMIPMAPPROC generateMipmap;
+    PFNGLDELETETEXTURESPROC deleteTextures;
+    PFNGLBINDRENDERBUFFERPROC bindRenderbuffer;
+    PFNGLRENDERBUFFERSTORAGEPROC renderbufferStorage;
+    PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC renderbufferStorageMultisample;
+    PFNGLDELETERENDERBUFFERSPROC deleteRenderbuffers;
+};
+
+struct CounterState
+{
+    bool installed = false;
+    bool paused = false;
+    bool driverMemoryInfo = false; // GL_NVX_gpu_memory_info
+    GLCounters counters;
+    GLFunctions gl = {};
+
+    // what is bound, to know which object an allocation goes to
+    GLenum activeTexture = GL_TEXTURE0;
+    std::unordered_map<uint64_t, GLuint> boundTextures; // (unit << 32) | target
+    std::unordered_map<GLenum, GLuint> boundBuffers;
+    GLuint boundRenderbuffer = 0;
+    GLuint boundProgram = 0;
+
+    std::unordered_map<GLuint, TextureMemory> textures;
+    std::unordered_map<GLuint, uint64_t> buffers;
+    std::unordered_map<GLuint, uint64_t> renderbuffers;
+    uint64_t totalBytes = 0;
+};
+
+CounterState g_state;
+
+// bytes a texel takes in video memory, three component formats are padded to four like most drivers do
+uint64_t bytesPerTexel(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_R8: case GL_RED: case GL_STENCIL_INDEX8:
+        return 1;
+    case GL_RG8: case GL_RG: case GL_R16F: case GL_R16: case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGB16F: case GL_RGBA16F: case GL_RG32F: case GL_RGBA16: case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGB32F: case GL_RGBA32F:
+        return 16;
+    default: // RGB(A)8, sRGB, R11G11B10F, RGB9E5, RGB10A2, R32F, RG16F and the 24 and 32 bit depth formats
+        return 4;
+    }
+}
+
+// bytes of a pixel in client memory
+uint64_t bytesPerPixel(GLenum format, GLenum type)
+{
+    switch (type)
+    {
+    case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_10F_11F_11F_REV: case GL_UNSIGNED_INT_5_9_9_9_REV: case GL_UNSIGNED_INT_2_10_10_10_REV:
+        return 4;
+    default:
+        break;
+    }
+    uint64_t components = 4;
+    switch (format)
+    {
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: components = 1; break;
+    case GL_RG: case GL_RG_INTEGER: components = 2; break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+    default: break;
+    }
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE: case GL_BYTE: return components;
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return 2 * components;
+    default: return 4 * components;
+    }
+}
+
+uint64_t countTriangles(GLenum mode, GLsizei count)
+{
+    switch (mode)
+    {
+    case GL_TRIANGLES: return count / 3;
+    case GL_TRIANGLE_STRIP: case GL_TRIANGLE_FAN: return count >= 3 ? count - 2 : 0;
+    case GL_TRIANGLES_ADJACENCY: return count / 6;
+    case GL_TRIANGLE_STRIP_ADJACENCY: return count >= 6 ? (count - 4) / 2 : 0;
+    default: return 0;
+    }
+}
+
+void countDraw(GLenum mode, GLsizei count, GLsizei instances)
+{
+    if (g_state.paused) return;
+    ++g_state.counters.drawCalls;
+    g_state.counters.triangles += countTriangles(mode, count) * static_cast<uint64_t>(instances);
+}
+
+void countUpload(uint64_t bytes)
+{
+    if (g_state.paused) return;
+    ++g_state.counters.uploads;
+    g_state.counters.uploadBytes += bytes;
+}
+
+// texture data comes from client memory unless a pixel unpack buffer is bound
+bool isClientPixels(const void* pixels)
+{
+    return pixels && g_state.boundBuffers[GL_PIXEL_UNPACK_BUFFER] == 0;
+}
+
+// the binding point an image target allocates through, a cube face through the cube map
+GLenum bindingTarget(GLenum target, uint32_t& face)
+{
+    face = 0;
+    if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+    {
+        face = 1 + (target - GL_TEXTURE_CUBE_MAP_POSITIVE_X);
+        return GL_TEXTURE_CUBE_MAP;
+    }
+    return target;
+}
+
+GLuint boundTexture(GLenum target)
+{
+    uint64_t unit = g_state.activeTexture - GL_TEXTURE0;
+    auto found = g_state.boundTextures.find((unit << 32) | target);
+    return found == g_state.boundTextures.end() ? 0 : found->second;
+}
+
+void setImageBytes(TextureMemory& texture, uint32_t key, uint64_t bytes)
+{
+    uint64_t& image = texture.images[key];
+    texture.bytes += bytes - image;
+    g_state.totalBytes += bytes - image;
+    image = bytes;
+}
+
+void trackTextureImage(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLsizei depth)
+{
+    uint32_t face;
+    GLuint name = boundTexture(bindingTarget(target, face));
+    if (name == 0) return; // a proxy target or nothing bound
+    uint64_t bytes = static_cast<uint64_t>(width) * height * depth * bytesPerTexel(internalFormat);
+    setImageBytes(g_state.textures[name], (face << 16) | static_cast<uint32_t>(level), bytes);
+}
+
+void trackTextureStorage(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height, GLsizei depth)
+{
+    GLuint name = boundTexture(target);
+    if (name == 0) return;
+    // only 3D textures shrink in depth, the layers of an array don't
+    bool volume = target == GL_TEXTURE_3D;
+    uint64_t faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    uint64_t bytes = 0;
+    for (GLsizei level = 0; level < levels; ++level)
+    {
+        uint64_t levelWidth = width >> level > 0 ? width >> level : 1;
+        uint64_t levelHeight = height >> level > 0 ? height >> level : 1;
+        uint64_t levelDepth = !volume ? depth : (depth >> level > 0 ? depth >> level : 1);
+        bytes += levelWidth * levelHeight * levelDepth * faces * bytesPerTexel(internalFormat);
+    }
+    TextureMemory& texture = g_state.textures[name];
+    texture.immutable = true;
+    setImageBytes(texture, kStorageKey, bytes);
+}
+
+void releaseTexture(GLuint name)
+{
+    auto found = g_state.textures.find(name);
+    if (found == g_state.textures.end()) return;
+    g_state.totalBytes -= found->second.bytes;
+    g_state.textures.erase(found);
+}
+
+void APIENTRY countedDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    countDraw(mode, count, 1);
+    g_state.gl.drawArrays(mode, first, count);
+}
+
+void APIENTRY countedDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    countDraw(mode, count, 1);
+    g_state.gl.drawElements(mode, count, type, indices);
+}
+
+void APIENTRY countedDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+{
+    countDraw(mode, count, instances);
+    g_state.gl.drawArraysInstanced(mode, first, count, instances);
+}
+
+void APIENTRY countedDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances)
+{
+    countDraw(mode, count, instances);
+    g_state.gl.drawElementsInstanced(mode, count, type, indices, instances);
+}
+
+void APIENTRY countedDispatchCompute(GLuint x, GLuint y, GLuint z)
+{
+    if (!g_state.paused) ++g_state.counters.dispatches;
+    g_state.gl.dispatchCompute(x, y, z);
+}
+
+void APIENTRY countedActiveTexture(GLenum texture)
+{
+    g_state.activeTexture = texture;
+    g_state.gl.activeTexture(texture);
+}
+
+void APIENTRY countedBindTexture(GLenum target, GLuint texture)
+{
+    if (!g_state.paused) ++g_state.counters.textureBinds;
+    uint64_t unit = g_state.activeTexture - GL_TEXTURE0;
+    g_state.boundTextures[(unit << 32) | target] = texture;
+    g_state.gl.bindTexture(target, texture);
+}
+
+void APIENTRY countedBindTextureUnit(GLuint unit, GLuint texture)
+{
+    // the target isn't known here, allocations go through glBindTexture in this code
+    if (!g_state.paused) ++g_state.counters.textureBinds;
+    g_state.gl.bindTextureUnit(unit, texture);
+}
+
+void APIENTRY countedUseProgram(GLuint program)
+{
+    if (program != g_state.boundProgram && !g_state.paused) ++g_state.counters.programSwitches;
+    g_state.boundProgram = program;
+    g_state.gl.useProgram(program);
+}
+
+void APIENTRY countedBindBuffer(GLenum target, GLuint buffer)
+{
+    g_state.boundBuffers[target] = buffer;
+    g_state.gl.bindBuffer(target, buffer);
+}
+
+void APIENTRY countedBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    // binds the generic point of the target as well
+    g_state.boundBuffers[target] = buffer;
+    g_state.gl.bindBufferBase(target, index, buffer);
+}
+
+void APIENTRY countedBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    GLuint name = g_state.boundBuffers[target];
+    if (name != 0)
+    {
+        uint64_t& bytes = g_state.buffers[name];
+        g_state.totalBytes += static_cast<uint64_t>(size) - bytes;
+        bytes = static_cast<uint64_t>(size);
+    }
+    if (data) countUpload(static_cast<uint64_t>(size));
+    g_state.gl.bufferData(target, size, data, usage);
+}
+
+void APIENTRY countedBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    countUpload(static_cast<uint64_t>(size));
+    g_state.gl.bufferSubData(target, offset, size, data);
+}
+
+void APIENTRY countedDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        auto found = g_state.buffers.find(buffers[i]);
+        if (found == g_state.buffers.end()) continue;
+        g_state.totalBytes -= found->second;
+        g_state.buffers.erase(found);
+    }
+    g_state.gl.deleteBuffers(n, buffers);
+}
+
+void APIENTRY countedTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    trackTextureImage(target, level, internalFormat, width, height, 1);
+    if (isClientPixels(pixels)) countUpload(static_cast<uint64_t>(width) * height * bytesPerPixel(format, type));
+    g_state.gl.texImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+}
+
+void APIENTRY countedTexImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    trackTextureImage(target, level, internalFormat, width, height, depth);
+    if (isClientPixels(pixels)) countUpload(static_cast<uint64_t>(width) * height * depth * bytesPerPixel(format, type));
+    g_state.gl.texImage3D(target, level, internalFormat, width, height, depth, border, format, type, pixels);
+}
+
+void APIENTRY countedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+    if (isClientPixels(pixels)) countUpload(static_cast<uint64_t>(width) * height * bytesPerPixel(format, type));
+    g_state.gl.texSubImage2D(target, level, x, y, width, height, format, type, pixels);
+}
+
+void APIENTRY countedTexSubImage3D(GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+{
+    if (isClientPixels(pixels)) countUpload(static_cast<uint64_t>(width) * height * depth * bytesPerPixel(format, type));
+    g_state.gl.texSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels);
+}
+
+void APIENTRY countedTexStorage2D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    trackTextureStorage(target, levels, internalFormat, width, height, 1);
+    g_state.gl.texStorage2D(target, levels, internalFormat, width, height);
+}
+
+void APIENTRY countedTexStorage3D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height, GLsizei depth)
+{
+    trackTextureStorage(target, levels, internalFormat, width, height, depth);
+    g_state.gl.texStorage3D(target, levels, internalFormat, width, height, depth);
+}
+
+void APIENTRY countedGenerateMipmap(GLenum target)
+{
+    GLuint name = boundTexture(target);
+    auto found = g_state.textures.find(name);
+    if (name != 0 && found != g_state.textures.end() && !found->second.immutable)
+    {
+        // the chain below a level adds up to a third of it
+        uint64_t baseBytes = 0;
+        for (const auto& image : found->second.images)
+        {
+            if (image.first != kMipmapKey && (image.first & 0xFFFFu) == 0) baseBytes += image.second;
+        }
+        setImageBytes(found->second, kMipmapKey, baseBytes / 3);
+    }
+    g_state.gl.generateMipmap(target);
+}
+
+void APIENTRY countedDeleteTextures(GLsizei n, const GLuint* textures)
+{
+    for (GLsizei i = 0; i < n; ++i) releaseTexture(textures[i]);
+    g_state.gl.deleteTextures(n, textures);
+}
+
+void APIENTRY countedBindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+    g_state.boundRenderbuffer = renderbuffer;
+    g_state.gl.bindRenderbuffer(target, renderbuffer);
+}
+
+void trackRenderbuffer(GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    if (g_state.boundRenderbuffer == 0) return;
+    uint64_t& bytes = g_state.renderbuffers[g_state.boundRenderbuffer];
+    uint64_t newBytes = static_cast<uint64_t>(width) * height * (samples > 1 ? samples : 1) * bytesPerTexel(internalFormat);
+    g_state.totalBytes += newBytes - bytes;
+    bytes = newBytes;
+}
+
+void APIENTRY countedRenderbufferStorage(GLenum target, GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    trackRenderbuffer(1, internalFormat, width, height);
+    g_state.gl.renderbufferStorage(target, internalFormat, width, height);
+}
+
+void APIENTRY countedRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    trackRenderbuffer(samples, internalFormat, width, height);
+    g_state.gl.renderbufferStorageMultisample(target, samples, internalFormat, width, height);
+}
+
+void APIENTRY countedDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
+{
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        auto found = g_state.renderbuffers.find(renderbuffers[i]);
+        if (found == g_state.renderbuffers.end()) continue;
+        g_state.totalBytes -= found->second;
+        g_state.renderbuffers.erase(found);
+    }
+    g_state.gl.deleteRenderbuffers(n, renderbuffers);
+}
+} // namespace
+
+void InstallGLCounters()
+{
+    if (g_state.installed) return;
+    g_state.installed = true;
+    GLFunctions& gl = g_state.gl;
+    gl.drawArrays = glad_glDrawArrays;
+    gl.drawElements = glad_glDrawElements;
+    gl.drawArraysInstanced = glad_glDrawArraysInstanced;
+    gl.drawElementsInstanced = glad_glDrawElementsInstanced;
+    gl.dispatchCompute = glad_glDispatchCompute;
+    gl.activeTexture = glad_glActiveTexture;
+    gl.bindTexture = glad_glBindTexture;
+    gl.bindTextureUnit = glad_glBindTextureUnit;
+    gl.useProgram = glad_glUseProgram;
+    gl.bindBuffer = glad_glBindBuffer;
+    gl.bindBufferBase = glad_glBindBufferBase;
+    gl.bufferData = glad_glBufferData;
+    gl.bufferSubData = glad_glBufferSubData;
+    gl.deleteBuffers = glad_glDeleteBuffers;
+    gl.texImage2D = glad_glTexImage2D;
+    gl.texImage3D = glad_glTexImage3D;
+    gl.texSubImage2D = glad_glTexSubImage2D;
+    gl.texSubImage3D = glad_glTexSubImage3D;
+    gl.texStorage2D = glad_glTexStorage2D;
+    gl.texStorage3D = glad_glTexStorage3D;
+    gl.generateMipmap = glad_glGenerateMipmap;
+    gl.deleteTextures = glad_glDeleteTextures;
+    gl.bindRenderbuffer = glad_glBindRenderbuffer;
+    gl.renderbufferStorage = glad_glRenderbufferStorage;
+    gl.renderbufferStorageMultisample = glad_glRenderbufferStorageMultisample;
+    gl.deleteRenderbuffers = glad_glDeleteRenderbuffers;
+
+    glad_glDrawArrays = countedDrawArrays;
+    glad_glDrawElements = countedDrawElements;
+    glad_glDrawArraysInstanced = countedDrawArraysInstanced;
+    glad_glDrawElementsInstanced = countedDrawElementsInstanced;
+    glad_glDispatchCompute = countedDispatchCompute;
+    glad_glActiveTexture = countedActiveTexture;
+    glad_glBindTexture = countedBindTexture;
+    glad_glBindTextureUnit = countedBindTextureUnit;
+    glad_glUseProgram = countedUseProgram;
+    glad_glBindBuffer = countedBindBuffer;
+    glad_glBindBufferBase = countedBindBufferBase;
+    glad_glBufferData = countedBufferData;
+    glad_glBufferSubData = countedBufferSubData;
+    glad_glDeleteBuffers = countedDeleteBuffers;
+    glad_glTexImage2D = countedTexImage2D;
+    glad_glTexImage3D = countedTexImage3D;
+    glad_glTexSubImage2D = countedTexSubImage2D;
+    glad_glTexSubImage3D = countedTexSubImage3D;
+    glad_glTexStorage2D = countedTexStorage2D;
+    glad_glTexStorage3D = countedTexStorage3D;
+    glad_glGenerateMipmap = countedGenerateMipmap;
+    glad_glDeleteTextures = countedDeleteTextures;
+    glad_glBindRenderbuffer = countedBindRenderbuffer;
+    glad_glRenderbufferStorage = countedRenderbufferStorage;
+    glad_glRenderbufferStorageMultisample = countedRenderbufferStorageMultisample;
+    glad_glDeleteRenderbuffers = countedDeleteRenderbuffers;
+
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; ++i)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, "GL_NVX_gpu_memory_info") == 0) g_state.driverMemoryInfo = true;
+    }
+}
+
+bool AreGLCountersInstalled()
+{
+    return g_state.installed;
+}
+
+const GLCounters& GetGLCounters()
+{
+    return g_state.counters;
+}
+
+void ResetGLCounters()
+{
+    g_state.counters = GLCounters();
+}
+
+void SetGLCountersPaused(bool paused)
+{
+    g_state.paused = paused;
+}
+
+uint64_t GetTrackedVideoMemoryBytes()
+{
+    return g_state.totalBytes;
+}
+
+uint64_t QueryDriverVideoMemoryBytes()
+{
+    if (!g_state.driverMemoryInfo) return 0;
+    // GL_NVX_gpu_memory_info, in KB
+    const GLenum totalAvailableMemory = 0x9048;
+    const GLenum currentAvailableMemory = 0x9049;
+    GLint total = 0;
+    GLint available = 0;
+    glGetIntegerv(totalAvailableMemory, &total);
+    glGetIntegerv(currentAvailableMemory, &available);
+    return total > available ? static_cast<uint64_t>(total - available) * 1024 : 0;
+}
+} // namespace profiling
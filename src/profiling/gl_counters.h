@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+
+namespace profiling
+{
+
+// the GL work issued since the counters were last reset
+struct GLCounters
+{
+    uint64_t drawCalls = 0;
+    uint64_t triangles = 0;       // strips and fans count the triangles they make, instances multiply
+    uint64_t dispatches = 0;
+    uint64_t textureBinds = 0;
+    uint64_t programSwitches = 0; // glUseProgram of a program other than the bound one
+    uint64_t uploads = 0;         // buffer and texture data sent from client memory
+    uint64_t uploadBytes = 0;
+};
+
+// wraps the glad function pointers of the draws, the binds, the uploads and the allocations with counting
+// versions, once the GL functions are loaded. Nothing is counted before, and without it the calls go straight to
+// the driver. The counters are the context thread's, like the GL calls themselves
+void InstallGLCounters();
+bool AreGLCountersInstalled();
+
+const GLCounters& GetGLCounters();
+void ResetGLCounters();
+// paused, the calls are not counted, the allocations still are. For overlays that shouldn't show up in what they show
+void SetGLCountersPaused(bool paused);
+
+// bytes of the textures, buffers and renderbuffers alive, from their sizes and formats. Mipmaps made by
+// glGenerateMipmap are estimated at a third of the base level, drivers may pad and compress differently
+uint64_t GetTrackedVideoMemoryBytes();
+// what the driver reports in use by every process, 0 without GL_NVX_gpu_memory_info
+uint64_t QueryDriverVideoMemoryBytes();
+} // namespace profiling
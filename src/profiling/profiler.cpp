@@ -0,0 +1,290 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include "profiling/profiler.h"
+#include "profiling/statistics.h"
+
+namespace profiling
+{
+
+namespace
+{
+// names are literals from the code, only quotes and backslashes need escaping
+void writeJsonString(std::FILE* file, const char* text)
+{
+    std::fputc('"', file);
+    for (const char* c = text; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\') std::fputc('\\', file);
+        std::fputc(*c, file);
+    }
+    std::fputc('"', file);
+}
+} // namespace
+
+void Profiler::PassSamples::Add(double milliseconds)
+{
+    minimum = count == 0 ? milliseconds : std::min(minimum, milliseconds);
+    sum += milliseconds;
+    ++count;
+    if (latest.size() < kMaxSamples) latest.push_back(milliseconds);
+    else latest[next] = milliseconds;
+    next = (next + 1) % kMaxSamples;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    SetZonesEnabled(enabled);
+}
+
+void Profiler::BeginFrame()
+{
+    if (!m_enabled) return;
+    // the frames finish in order, stop at the first the GPU is still working on
+    while (m_frames.size() > 1 && resolveFrame(m_frames.front(), false)) m_frames.pop_front();
+    while (m_frames.size() > kMaxFramesInFlight)
+    {
+        // the GPU is far behind, waiting here would stall the frame the profiler is meant to measure
+        Frame& stale = m_frames.front();
+        for (Scope& scope : stale.scopes)
+        {
+            m_cpuPasses[passIndex(scope.name)].Add((scope.cpuEnd - scope.cpuBegin) / 1.0e6);
+            m_freeQueries.push_back(scope.beginQuery);
+            m_freeQueries.push_back(scope.endQuery);
+        }
+        ++m_droppedFrames;
+        m_frames.pop_front();
+    }
+    m_frames.emplace_back();
+    // GL_TIMESTAMP read directly is the GPU clock now, without waiting for the commands in flight
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    m_frames.back().gpuToCpu = Now() - gpuNow;
+}
+
+void Profiler::BeginScope(const char* name)
+{
+    if (!m_enabled) return;
+    Frame& frame = currentFrame();
+    Scope scope;
+    scope.name = name;
+    scope.beginQuery = acquireQuery();
+    scope.endQuery = acquireQuery();
+    glQueryCounter(scope.beginQuery, GL_TIMESTAMP);
+    scope.cpuBegin = Now();
+    m_openScopes.push_back(frame.scopes.size());
+    frame.scopes.push_back(scope);
+}
+
+void Profiler::EndScope()
+{
+    if (m_openScopes.empty()) return;
+    Scope& scope = currentFrame().scopes[m_openScopes.back()];
+    m_openScopes.pop_back();
+    scope.cpuEnd = Now();
+    glQueryCounter(scope.endQuery, GL_TIMESTAMP);
+}
+
+void Profiler::Flush()
+{
+    for (Frame& frame : m_frames) resolveFrame(frame, true);
+    m_frames.clear();
+    m_openScopes.clear();
+    if (!m_freeQueries.empty()) glDeleteQueries(static_cast<GLsizei>(m_freeQueries.size()), m_freeQueries.data());
+    m_freeQueries.clear();
+}
+
+std::vector<PassStats> Profiler::GetStats() const
+{
+    std::vector<PassStats> stats(m_cpuPasses.size());
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        const PassSamples& cpu = m_cpuPasses[i];
+        const PassSamples& gpu = m_gpuPasses[i];
+        PassStats& pass = stats[i];
+        pass.name = cpu.name;
+        pass.count = cpu.count;
+        pass.gpuCount = gpu.count;
+        if (cpu.count > 0)
+        {
+            pass.cpuMinMilliseconds = cpu.minimum;
+            pass.cpuAverageMilliseconds = cpu.sum / cpu.count;
+            pass.cpuP99Milliseconds = Percentile(cpu.latest, 0.99);
+        }
+        if (gpu.count > 0)
+        {
+            pass.gpuMinMilliseconds = gpu.minimum;
+            pass.gpuAverageMilliseconds = gpu.sum / gpu.count;
+            pass.gpuP99Milliseconds = Percentile(gpu.latest, 0.99);
+        }
+    }
+    return stats;
+}
+
+void Profiler::PrintStats() const
+{
+    std::cout << "pass, count, cpu min ms, cpu avg ms, cpu p99 ms, gpu min ms, gpu avg ms, gpu p99 ms" << std::endl;
+    for (const PassStats& pass : GetStats())
+    {
+        std::cout << pass.name << ", " << pass.count << ", " << pass.cpuMinMilliseconds << ", " << pass.cpuAverageMilliseconds << ", " << pass.cpuP99Milliseconds
+            << ", " << pass.gpuMinMilliseconds << ", " << pass.gpuAverageMilliseconds << ", " << pass.gpuP99Milliseconds << std::endl;
+    }
+    if (m_droppedFrames > 0) std::cout << m_droppedFrames << " frames had no GPU times, the GPU was more than " << kMaxFramesInFlight << " frames behind" << std::endl;
+
+    std::vector<ThreadZones> threads = CollectZones();
+    if (threads.empty()) return;
+    std::cout << "zone, thread, count, min ms, avg ms, p99 ms" << std::endl;
+    for (const ThreadZones& thread : threads)
+    {
+        // per name in the order the zones first closed, pointers of one literal compare equal
+        std::vector<const char*> names;
+        std::vector<std::vector<double>> durations;
+        for (const ZoneEvent& event : thread.events)
+        {
+            size_t index = std::find(names.begin(), names.end(), event.name) - names.begin();
+            if (index == names.size())
+            {
+                names.push_back(event.name);
+                durations.emplace_back();
+            }
+            durations[index].push_back((event.end - event.begin) / 1.0e6);
+        }
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            const std::vector<double>& zone = durations[i];
+            double sum = 0.0;
+            for (double duration : zone) sum += duration;
+            std::cout << names[i] << ", " << thread.name << ", " << zone.size() << ", " << *std::min_element(zone.begin(), zone.end()) << ", "
+                << sum / zone.size() << ", " << Percentile(zone, 0.99) << std::endl;
+        }
+        if (thread.overwritten > 0) std::cout << thread.overwritten << " older zones of " << thread.name << " were overwritten" << std::endl;
+    }
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) const
+{
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        std::cerr << "Failed to write the trace " << path << std::endl;
+        return false;
+    }
+    // complete ("X") events in microseconds, thread 1 is the CPU and thread 2 the GPU side of the passes,
+    // the zones of recording thread N are on thread 3 + N
+    std::vector<ThreadZones> threads = CollectZones();
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU passes\"}},\n");
+    std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU passes\"}}");
+    for (const ThreadZones& thread : threads)
+    {
+        std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", 3 + thread.index);
+        writeJsonString(file, thread.name.c_str());
+        std::fprintf(file, "}}");
+    }
+    for (const TraceEvent& event : m_trace)
+    {
+        std::fprintf(file, ",\n{\"name\":");
+        writeJsonString(file, event.name);
+        std::fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            event.gpu ? "gpu" : "cpu", event.gpu ? 2 : 1, event.begin / 1.0e3, event.duration / 1.0e3);
+    }
+    for (const ThreadZones& thread : threads)
+    {
+        for (const ZoneEvent& event : thread.events)
+        {
+            std::fprintf(file, ",\n{\"name\":");
+            writeJsonString(file, event.name);
+            std::fprintf(file, ",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                3 + thread.index, event.begin / 1.0e3, (event.end - event.begin) / 1.0e3);
+        }
+    }
+    std::fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    bool written = std::ferror(file) == 0;
+    written = std::fclose(file) == 0 && written;
+    if (!written) std::cerr << "Failed to write the trace " << path << std::endl;
+    return written;
+}
+
+unsigned int Profiler::acquireQuery()
+{
+    unsigned int query;
+    if (m_freeQueries.empty()) glGenQueries(1, &query);
+    else
+    {
+        query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+    return query;
+}
+
+Profiler::Frame& Profiler::currentFrame()
+{
+    // scopes before the first BeginFrame, the startup bake, make a frame of their own
+    if (m_frames.empty())
+    {
+        m_frames.emplace_back();
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        m_frames.back().gpuToCpu = Now() - gpuNow;
+    }
+    return m_frames.back();
+}
+
+bool Profiler::resolveFrame(Frame& frame, bool wait)
+{
+    if (!wait && !frame.scopes.empty())
+    {
+        // the queries complete in order, the last one issued being available covers the rest
+        int available = 0;
+        glGetQueryObjectiv(frame.scopes.back().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+        for (const Scope& scope : frame.scopes)
+        {
+            glGetQueryObjectiv(scope.endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return false;
+        }
+    }
+    for (const Scope& scope : frame.scopes)
+    {
+        GLuint64 gpuBegin = 0;
+        GLuint64 gpuEnd = 0;
+        glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &gpuBegin);
+        glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &gpuEnd);
+        m_freeQueries.push_back(scope.beginQuery);
+        m_freeQueries.push_back(scope.endQuery);
+
+        size_t pass = passIndex(scope.name);
+        int64_t gpuDuration = static_cast<int64_t>(gpuEnd - gpuBegin);
+        m_cpuPasses[pass].Add((scope.cpuEnd - scope.cpuBegin) / 1.0e6);
+        m_gpuPasses[pass].Add(gpuDuration / 1.0e6);
+        if (m_trace.size() + 2 <= kMaxTraceEvents)
+        {
+            m_trace.push_back({ scope.name, false, scope.cpuBegin, scope.cpuEnd - scope.cpuBegin });
+            m_trace.push_back({ scope.name, true, static_cast<int64_t>(gpuBegin) + frame.gpuToCpu, gpuDuration });
+        }
+    }
+    frame.scopes.clear();
+    return true;
+}
+
+size_t Profiler::passIndex(const char* name)
+{
+    auto found = m_passIndices.find(name);
+    if (found != m_passIndices.end()) return found->second;
+    size_t index = m_cpuPasses.size();
+    m_passIndices[name] = index;
+    m_cpuPasses.emplace_back();
+    m_cpuPasses.back().name = name;
+    m_gpuPasses.emplace_back();
+    m_gpuPasses.back().name = name;
+    return index;
+}
+
+Profiler& GetProfiler()
+{
+    static Profiler profiler;
+    return profiler;
+}
+} // namespace profiling
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "profiling/zones.h"
+
+namespace profiling
+{
+
+// aggregate of every resolved scope of one name
+struct PassStats
+{
+    std::string name;
+    unsigned int count = 0;    // scopes measured on the CPU
+    unsigned int gpuCount = 0; // of those, the ones whose GPU queries were read back
+    double cpuMinMilliseconds = 0.0;
+    double cpuAverageMilliseconds = 0.0;
+    double cpuP99Milliseconds = 0.0;
+    double gpuMinMilliseconds = 0.0;
+    double gpuAverageMilliseconds = 0.0;
+    double gpuP99Milliseconds = 0.0;
+};
+
+// named, nestable scopes timed on the CPU and on the GPU, for the per-pass cost of the bake and of the frame.
+// A scope brackets the GL commands issued inside it with two GL_TIMESTAMP queries, queries of the time elapsed
+// can't nest. The queries come from a pool and are read back frames later, once the GPU reports them available,
+// so reading never waits; a frame still unresolved after kMaxFramesInFlight newer ones loses its GPU times instead.
+// Scopes must be opened and closed on the thread owning the context, names must outlive the profiler (literals)
+class Profiler
+{
+public:
+    static constexpr size_t kMaxFramesInFlight = 8;
+    static constexpr size_t kMaxSamples = 4096;           // per pass and clock, the percentile covers the latest ones
+    static constexpr size_t kMaxTraceEvents = 1u << 18;   // later scopes still count in the stats
+
+    // disabled (default), scopes cost one branch. Enables the CPU zones as well
+    void SetEnabled(bool enabled);
+    inline bool IsEnabled() const { return m_enabled; }
+
+    // starts the next frame and reads back the frames the GPU has finished
+    void BeginFrame();
+    void BeginScope(const char* name);
+    void EndScope();
+    // waits for every query issued so far and deletes the pool, for the report at exit while the context is alive.
+    // The profiler is a static that outlives the context, it holds no GL objects after this
+    void Flush();
+
+    // in the order the passes first appeared
+    std::vector<PassStats> GetStats() const;
+    // the passes, then the CPU zones of every thread
+    void PrintStats() const;
+    // chrome://tracing / Perfetto JSON, the CPU and the GPU scopes on two tracks of one timeline and the zones
+    // on a track per thread
+    bool WriteChromeTrace(const std::string& path) const;
+
+private:
+    struct Scope
+    {
+        const char* name = nullptr;
+        int64_t cpuBegin = 0; // Now()
+        int64_t cpuEnd = 0;
+        unsigned int beginQuery = 0;
+        unsigned int endQuery = 0;
+    };
+
+    struct Frame
+    {
+        std::vector<Scope> scopes;
+        int64_t gpuToCpu = 0; // offset from the GPU clock to Now(), sampled when the frame began
+    };
+
+    struct PassSamples
+    {
+        std::string name;
+        unsigned int count = 0;
+        double minimum = 0.0;
+        double sum = 0.0;
+        std::vector<double> latest; // ring of the last kMaxSamples
+        size_t next = 0;
+
+        void Add(double milliseconds);
+    };
+
+    struct TraceEvent
+    {
+        const char* name;
+        bool gpu;
+        int64_t begin; // Now()
+        int64_t duration;
+    };
+
+    unsigned int acquireQuery();
+    Frame& currentFrame();
+    // reads the frame's queries back, when wait is false only if the GPU finished them. Returns whether it did
+    bool resolveFrame(Frame& frame, bool wait);
+    size_t passIndex(const char* name);
+
+    bool m_enabled = false;
+    std::deque<Frame> m_frames; // oldest first, the back is being recorded
+    std::vector<size_t> m_openScopes;
+    std::vector<unsigned int> m_freeQueries;
+    std::vector<PassSamples> m_cpuPasses;
+    std::vector<PassSamples> m_gpuPasses;
+    std::unordered_map<std::string, size_t> m_passIndices;
+    std::vector<TraceEvent> m_trace;
+    unsigned int m_droppedFrames = 0;
+};
+
+// the profiler the renderers and the IBL bake record to
+Profiler& GetProfiler();
+
+// times the enclosing block under the name
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) { GetProfiler().BeginScope(name); }
+    ~ProfileScope() { GetProfiler().EndScope(); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+} // namespace profiling
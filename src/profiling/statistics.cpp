@@ -0,0 +1,16 @@
+#include <algorithm>
+#include <cmath>
+#include "profiling/statistics.h"
+
+namespace profiling
+{
+
+double Percentile(std::vector<double> samples, double fraction)
+{
+    if (samples.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(fraction * samples.size()));
+    size_t index = std::min(samples.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+} // namespace profiling
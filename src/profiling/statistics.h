@@ -0,0 +1,9 @@
+#pragma once
+#include <vector>
+
+namespace profiling
+{
+
+// the nearest rank percentile of the samples, fraction 0..1, 0 without samples
+double Percentile(std::vector<double> samples, double fraction);
+} // namespace profiling
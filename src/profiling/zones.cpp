@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include "profiling/zones.h"
+
+namespace profiling
+{
+
+namespace
+{
+// a ZoneEvent whose fields CollectZones may read while the owner overwrites them
+struct RingSlot
+{
+    std::atomic<const char*> name;
+    std::atomic<int64_t> begin;
+    std::atomic<int64_t> end;
+};
+
+struct ThreadRing
+{
+    std::string name;
+    unsigned int index = 0;
+    std::unique_ptr<RingSlot[]> events{ new RingSlot[kZoneRingCapacity] };
+    std::atomic<uint64_t> written{ 0 }; // zones ever recorded, the next one goes to written % kZoneRingCapacity
+};
+
+// the rings outlive their threads, a worker that exits before the export still shows up in it.
+// The mutex guards the list and the names, never the recording
+std::mutex ringsMutex;
+std::vector<std::unique_ptr<ThreadRing>> rings;
+thread_local ThreadRing* threadRing = nullptr;
+
+ThreadRing& currentRing()
+{
+    if (!threadRing)
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(std::make_unique<ThreadRing>());
+        threadRing = rings.back().get();
+        threadRing->index = static_cast<unsigned int>(rings.size() - 1);
+        threadRing->name = "thread " + std::to_string(threadRing->index);
+    }
+    return *threadRing;
+}
+} // namespace
+
+int64_t Now()
+{
+    static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void SetZonesEnabled(bool enabled)
+{
+    Now(); // pins the origin before the first zone
+    detail::zonesEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void SetThreadName(const char* name)
+{
+    ThreadRing& ring = currentRing();
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ring.name = name;
+}
+
+void RecordZone(const char* name, int64_t begin, int64_t end)
+{
+    ThreadRing& ring = currentRing();
+    uint64_t written = ring.written.load(std::memory_order_relaxed);
+    // a seqlock with written as the sequence: the fence orders the publication of the earlier zones before the
+    // slot is overwritten, so a CollectZones that read any of the new fields then sees written at this zone at least
+    std::atomic_thread_fence(std::memory_order_release);
+    RingSlot& slot = ring.events[written % kZoneRingCapacity];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.begin.store(begin, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    // publishes the event to CollectZones
+    ring.written.store(written + 1, std::memory_order_release);
+}
+
+std::vector<ThreadZones> CollectZones()
+{
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    std::vector<ThreadZones> collected;
+    for (const std::unique_ptr<ThreadRing>& ring : rings)
+    {
+        ThreadZones zones;
+        zones.name = ring->name;
+        zones.index = ring->index;
+        uint64_t end = ring->written.load(std::memory_order_acquire);
+        uint64_t begin = end > kZoneRingCapacity ? end - kZoneRingCapacity : 0;
+        zones.events.reserve(end - begin);
+        for (uint64_t i = begin; i < end; ++i)
+        {
+            const RingSlot& slot = ring->events[i % kZoneRingCapacity];
+            zones.events.push_back({ slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed) });
+        }
+        // the owner may have wrapped around onto the oldest slots while they were copied, those are dropped. Besides
+        // the after zones it published, it may be writing zone after, over the slot of zone after - kZoneRingCapacity
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = ring->written.load(std::memory_order_relaxed);
+        uint64_t valid = after + 1 > kZoneRingCapacity ? after + 1 - kZoneRingCapacity : 0;
+        if (valid > begin)
+        {
+            size_t torn = static_cast<size_t>(std::min<uint64_t>(valid - begin, zones.events.size()));
+            zones.events.erase(zones.events.begin(), zones.events.begin() + torn);
+            begin += torn;
+        }
+        zones.overwritten = begin;
+        if (!zones.events.empty()) collected.push_back(std::move(zones));
+    }
+    return collected;
+}
+} // namespace profiling
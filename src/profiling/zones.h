@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace profiling
+{
+
+// nanoseconds on the steady clock since the first call, the time base of the zones and of the profiler's scopes
+int64_t Now();
+
+// one closed zone, name is the literal the zone was opened with
+struct ZoneEvent
+{
+    const char* name;
+    int64_t begin;
+    int64_t end;
+};
+
+// the zones one thread recorded, oldest first
+struct ThreadZones
+{
+    std::string name;
+    unsigned int index = 0;   // order the threads recorded their first zone in, the trace's thread id
+    std::vector<ZoneEvent> events;
+    uint64_t overwritten = 0; // older zones the ring no longer holds
+};
+
+namespace detail
+{
+inline std::atomic<bool> zonesEnabled{ false };
+} // namespace detail
+
+// zones record nothing until enabled, a disabled zone costs one relaxed load
+void SetZonesEnabled(bool enabled);
+// the name the calling thread gets in the trace, "thread N" otherwise
+void SetThreadName(const char* name);
+// appends the zone to the calling thread's ring. Every thread owns its ring and is its only writer, recording takes no
+// lock and never waits; the ring keeps the latest kZoneRingCapacity zones
+void RecordZone(const char* name, int64_t begin, int64_t end);
+// copies every ring. Safe while the threads keep recording, zones written during the copy may be missing
+std::vector<ThreadZones> CollectZones();
+
+constexpr size_t kZoneRingCapacity = 1u << 16;
+
+// times the enclosing block on the CPU, see PROFILE_ZONE
+class Zone
+{
+public:
+    explicit Zone(const char* name)
+        : m_name(detail::zonesEnabled.load(std::memory_order_relaxed) ? name : nullptr), m_begin(m_name ? Now() : 0) { }
+    ~Zone() { if (m_name) RecordZone(m_name, m_begin, Now()); }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_begin;
+};
+} // namespace profiling
+
+// PROFILE_ZONE("name") times the rest of the block, the name must be a literal. Building without GLPBR_PROFILING
+// (cmake -DGLPBR_PROFILING=OFF) removes the zones entirely
+#ifdef GLPBR_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ::profiling::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) ::profiling::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,134 @@
+#include <glad/glad.h>
+#include <cstring>
+#include <iostream>
+#include "renderers/async_readback.h"
+#include "profiling/zones.h"
+
+namespace renderers
+{
+
+AsyncReadback::~AsyncReadback()
+{
+    // the callbacks may refer to things already gone, the copies in flight are dropped
+    for (Slot& slot : m_slots)
+    {
+        if (slot.fence) glDeleteSync(static_cast<GLsync>(slot.fence));
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+bool AsyncReadback::Initialize(unsigned int bufferCount)
+{
+    if (bufferCount == 0 || !m_slots.empty()) return false;
+    m_slots.resize(bufferCount);
+    for (Slot& slot : m_slots) glGenBuffers(1, &slot.buffer);
+    return true;
+}
+
+void AsyncReadback::Request(const RenderTarget& target, ReadbackFormat format, Callback onReady)
+{
+    if (m_inFlight == m_slots.size())
+    {
+        ++m_stallCount;
+        complete(m_slots[m_oldest], true);
+    }
+    Slot& slot = m_slots[m_next];
+    slot.width = target.GetWidth();
+    slot.height = target.GetHeight();
+    slot.format = format;
+    slot.onReady = std::move(onReady);
+
+    size_t pixelBytes = format == ReadbackFormat::RGB8 ? 3 : 3 * sizeof(float);
+    size_t bytes = pixelBytes * slot.width * slot.height;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (bytes > slot.capacity)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        slot.capacity = bytes;
+    }
+    // with a pack buffer bound glReadPixels only queues the copy, the pointer is an offset into the buffer
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target.GetFramebuffer());
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, slot.width, slot.height, GL_RGB, format == ReadbackFormat::RGB8 ? GL_UNSIGNED_BYTE : GL_FLOAT, nullptr);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_next = (m_next + 1) % m_slots.size();
+    ++m_inFlight;
+}
+
+unsigned int AsyncReadback::Poll()
+{
+    unsigned int completed = 0;
+    while (m_inFlight > 0 && complete(m_slots[m_oldest], false)) ++completed;
+    return completed;
+}
+
+void AsyncReadback::Flush()
+{
+    while (m_inFlight > 0) complete(m_slots[m_oldest], true);
+}
+
+bool AsyncReadback::complete(Slot& slot, bool wait)
+{
+    GLsync fence = static_cast<GLsync>(slot.fence);
+    // the flush bit makes sure the fence reaches the GPU, otherwise a wait could never end
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        if (!wait) return false;
+        PROFILE_ZONE("readback wait");
+        do
+        {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    slot.fence = nullptr;
+
+    utility::DisplayImage image;
+    image.width = slot.width;
+    image.height = slot.height;
+    size_t rowBytes;
+    unsigned char* pixels;
+    if (slot.format == ReadbackFormat::RGB8)
+    {
+        image.rgb8.resize(static_cast<size_t>(slot.width) * slot.height * 3);
+        rowBytes = static_cast<size_t>(slot.width) * 3;
+        pixels = image.rgb8.data();
+    }
+    else
+    {
+        image.rgb32f.resize(static_cast<size_t>(slot.width) * slot.height * 3);
+        rowBytes = static_cast<size_t>(slot.width) * 3 * sizeof(float);
+        pixels = reinterpret_cast<unsigned char*>(image.rgb32f.data());
+    }
+    {
+        PROFILE_ZONE("readback copy");
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const unsigned char* mapped = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rowBytes * slot.height, GL_MAP_READ_BIT));
+        if (mapped)
+        {
+            // GL rows start at the bottom
+            for (int y = 0; y < slot.height; ++y) std::memcpy(pixels + y * rowBytes, mapped + (slot.height - 1 - y) * rowBytes, rowBytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        else std::cerr << "Error: failed to map a readback buffer" << std::endl;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    Callback onReady = std::move(slot.onReady);
+    slot.onReady = nullptr;
+    m_oldest = (m_oldest + 1) % m_slots.size();
+    --m_inFlight;
+    if (onReady) onReady(std::move(image));
+    return true;
+}
+
+ReadbackFormat GetReadbackFormat(const std::string& path)
+{
+    return utility::IsEXRPath(path) ? ReadbackFormat::RGB32F : ReadbackFormat::RGB8;
+}
+} // namespace renderers
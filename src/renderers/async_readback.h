@@ -0,0 +1,66 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "renderers/render_target.h"
+#include "utility/image_writer.h"
+
+namespace renderers
+{
+
+enum class ReadbackFormat
+{
+    RGB8,  // as displayed, what a PNG stores
+    RGB32F // the float color, for EXR
+};
+
+// reads frames back without stalling the pipeline. Request copies the target's color into a pixel pack buffer
+// of a small ring and fences it; the copy runs on the GPU after the frame. Poll maps the buffers whose fence has
+// signaled and hands the pixels on. With three buffers frame N-2 is mapped while frame N renders; only when
+// every buffer is still in flight does Request wait for the oldest. Everything runs on the GL thread, the
+// callbacks too: they get the pixels already copied out of the mapping and usually queue them on a
+// utility::ImageWriteQueue
+class AsyncReadback
+{
+public:
+    using Callback = std::function<void(utility::DisplayImage&& image)>;
+
+    ~AsyncReadback();
+
+    bool Initialize(unsigned int bufferCount = 3);
+
+    // queues a copy of the target's current color, onReady gets it, rows top to bottom, from a later Poll or Flush
+    void Request(const RenderTarget& target, ReadbackFormat format, Callback onReady);
+    // completes the finished copies, oldest first, without waiting. Returns how many completed
+    unsigned int Poll();
+    // waits for every copy in flight
+    void Flush();
+
+    // copies Request had to wait for because the ring was full, each a pipeline stall
+    inline unsigned int GetStallCount() const { return m_stallCount; }
+    inline unsigned int GetBufferCount() const { return static_cast<unsigned int>(m_slots.size()); }
+
+private:
+    struct Slot
+    {
+        unsigned int buffer = 0;
+        size_t capacity = 0; // bytes of the buffer's storage
+        void* fence = nullptr; // GLsync, set while the copy is in flight
+        int width = 0;
+        int height = 0;
+        ReadbackFormat format = ReadbackFormat::RGB8;
+        Callback onReady;
+    };
+
+    // waits for the slot's fence when wait is set, otherwise only completes it when already signaled
+    bool complete(Slot& slot, bool wait);
+
+    std::vector<Slot> m_slots;
+    size_t m_next = 0;   // slot the next Request uses
+    size_t m_oldest = 0; // oldest slot in flight when m_inFlight > 0
+    size_t m_inFlight = 0;
+    unsigned int m_stallCount = 0;
+};
+
+// RGB32F for .exr paths, RGB8 otherwise
+ReadbackFormat GetReadbackFormat(const std::string& path);
+} // namespace renderers
@@ -0,0 +1,185 @@
+#include <glad/glad.h>
+#include <cassert>
+#include <iostream>
+#include "profiling/profiler.h"
+#include "renderers/deferred_renderer.h"
+#include "utility/primitives.h"
+#include "utility/resources.h"
+
+namespace renderers
+{
+
+DeferredRenderer::~DeferredRenderer()
+{
+    deleteTargets();
+}
+
+namespace
+{
+const unsigned int G_BUFFER_FEATURES = object3ds::MaterialAlbedoMap | object3ds::MaterialNormalMap | object3ds::MaterialMetallicRoughnessMap;
+} // namespace
+
+void DeferredRenderer::BeginInitialize()
+{
+    m_compileStarted = true;
+    m_compiling.push_back(m_depthShader.InitializeAsync(utility::ResourcePath("shader/pbr.vert").c_str(), utility::ResourcePath("shader/depth_only.frag").c_str()));
+    m_gBufferShaders.Initialize(utility::ResourcePath("shader/pbr.vert").c_str(), utility::ResourcePath("shader/gbuffer.frag").c_str(), object3ds::GetMaterialFeatureDefines(G_BUFFER_FEATURES));
+    m_gBufferShaders.Prepare(G_BUFFER_FEATURES);
+    // brdf.vert is a plain screen-space quad pass-through, reuse it for the lighting pass
+    m_compiling.push_back(m_lightingShader.InitializeAsync(utility::ResourcePath("shader/brdf.vert").c_str(), utility::ResourcePath("shader/deferred_lighting.frag").c_str()));
+}
+
+bool DeferredRenderer::Initialize(int width, int height)
+{
+    if (!m_compileStarted) BeginInitialize();
+    if (!shader::WaitForShaders(m_compiling)) return false;
+    if (!m_gBufferShaders.Get(G_BUFFER_FEATURES)) return false;
+
+    m_lightingShader.Use();
+    m_lightingShader.SetUniform("irradianceMap", 0);
+    m_lightingShader.SetUniform("prefilterMap", 1);
+    m_lightingShader.SetUniform("brdfLUT", 2);
+    m_lightingShader.SetUniform("gAlbedoMetallic", 3);
+    m_lightingShader.SetUniform("gNormalRoughness", 4);
+    m_lightingShader.SetUniform("gDepth", 5);
+
+    return createTargets(width, height);
+}
+
+void DeferredRenderer::Resize(int width, int height)
+{
+    if (width == m_width && height == m_height) return;
+    deleteTargets();
+    createTargets(width, height);
+}
+
+void DeferredRenderer::Render(object3ds::Model& model, const cameras::Camera& camera, const LightingInputs& lighting)
+{
+    const IBLTextures& ibl = lighting.ibl;
+    glm::mat4 model_mat = glm::mat4(1.0f);
+    glm::mat3 normal_mat = glm::transpose(glm::inverse(glm::mat3(model_mat)));
+    glm::mat4 view_mat = camera.GetViewMatrix();
+    glm::mat4 projection_mat = camera.GetProjectionMatrix();
+    profiling::Profiler& profiler = profiling::GetProfiler();
+
+    profiler.BeginScope("depth prepass");
+    glBindFramebuffer(GL_FRAMEBUFFER, m_gBuffer);
+    glViewport(0, 0, m_width, m_height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // depth pre-pass: geometry only, no material textures bound
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthFunc(GL_LESS);
+    m_depthShader.Use();
+    m_depthShader.SetUniform("model", model_mat);
+    m_depthShader.SetUniform("view", view_mat);
+    m_depthShader.SetUniform("projection", projection_mat);
+    model.DrawGeometry();
+    profiler.EndScope();
+
+    // G-buffer pass: only the front-most surface passes GL_EQUAL, so overdraw costs no material fetches
+    profiler.BeginScope("gbuffer");
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_EQUAL);
+    model.Draw(m_gBufferShaders, [&](shader::Shader& shader)
+    {
+        shader.SetUniform("model", model_mat);
+        shader.SetUniform("normalMatrix", normal_mat);
+        shader.SetUniform("view", view_mat);
+        shader.SetUniform("projection", projection_mat);
+    });
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LEQUAL);
+    profiler.EndScope();
+
+    // lighting pass
+    profiler.BeginScope("deferred lighting");
+    glBindFramebuffer(GL_FRAMEBUFFER, m_outputFramebuffer);
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_DEPTH_TEST);
+
+    m_lightingShader.Use();
+    m_lightingShader.SetUniform("invViewProjection", glm::inverse(projection_mat * view_mat));
+    m_lightingShader.SetUniform("camPos", camera.GetPosition());
+    m_lightingShader.SetUniform("view", view_mat);
+    m_lightingShader.SetUniform("screenSize", glm::vec2(m_width, m_height));
+    assert(lighting.lightGrid);
+    lighting.lightGrid->Bind(m_lightingShader);
+    if (lighting.shadowMap) lighting.shadowMap->Bind(m_lightingShader);
+    else lights::CascadedShadowMap::BindDisabled(m_lightingShader);
+    if (lighting.probes) lighting.probes->Bind(m_lightingShader);
+    else lights::ReflectionProbes::BindDisabled(m_lightingShader);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, ibl.irradianceMap);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, ibl.prefilterMap);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, ibl.brdfLUT);
+    m_lightingShader.SetUniform("maxReflectionLod", (float)(ibl.prefilterMipLevels - 1));
+    m_lightingShader.SetUniform("environmentBRDFMethod", static_cast<int>(ibl.environmentBRDF));
+    m_lightingShader.SetUniform("multiScatter", ibl.multiScatter);
+    if (ibl.octahedralAtlas) ibl.octahedralAtlas->Bind(m_lightingShader, ibl.octahedralSlot);
+    else ibl::OctahedralAtlas::BindDisabled(m_lightingShader);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, m_gAlbedoMetallic);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, m_gNormalRoughness);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, m_gDepth);
+    utility::renderQuad();
+
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_DEPTH_TEST);
+    profiler.EndScope();
+}
+
+bool DeferredRenderer::createTargets(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    glGenFramebuffers(1, &m_gBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_gBuffer);
+
+    auto createTarget = [width, height](unsigned int& texture, GLenum internalFormat, GLenum format, GLenum type)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    };
+    createTarget(m_gAlbedoMetallic, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    createTarget(m_gNormalRoughness, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    createTarget(m_gDepth, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_gAlbedoMetallic, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_gNormalRoughness, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_gDepth, 0);
+
+    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, attachments);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete)
+    {
+        std::cerr << "ERROR::DEFERRED_RENDERER::GBUFFER_INCOMPLETE" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+void DeferredRenderer::deleteTargets()
+{
+    if (m_gBuffer == 0) return;
+    glDeleteFramebuffers(1, &m_gBuffer);
+    glDeleteTextures(1, &m_gAlbedoMetallic);
+    glDeleteTextures(1, &m_gNormalRoughness);
+    glDeleteTextures(1, &m_gDepth);
+    m_gBuffer = m_gAlbedoMetallic = m_gNormalRoughness = m_gDepth = 0;
+}
+} // namespace renderers
@@ -0,0 +1,43 @@
+#pragma once
+#include "renderers/renderer.h"
+#include "shader/shader.h"
+#include "shader/shader_permutations.h"
+
+namespace renderers
+{
+
+// thin G-buffer path: a depth pre-pass lets the G-buffer pass run the material
+// fetches once per visible pixel, then a single screen-space pass does the lighting.
+//   gAlbedoMetallic  RGBA8    albedo (as stored in the texture), metallic
+//   gNormalRoughness RGBA16F  world space normal, roughness
+//   gDepth           DEPTH32F world position is reconstructed from it
+// The G-buffer pass uses the gbuffer.frag permutation of the mesh's albedo, normal and metallic textures,
+// the thin G-buffer has no room for ao and emissive so those textures are ignored.
+class DeferredRenderer : public Renderer
+{
+public:
+    ~DeferredRenderer();
+
+    void BeginInitialize() override;
+    bool Initialize(int width, int height) override;
+    void Resize(int width, int height) override;
+    void Render(object3ds::Model& model, const cameras::Camera& camera, const LightingInputs& lighting) override;
+
+private:
+    bool createTargets(int width, int height);
+    void deleteTargets();
+
+    shader::Shader m_depthShader;
+    shader::ShaderPermutations m_gBufferShaders;
+    shader::Shader m_lightingShader;
+    std::vector<shader::ShaderFuture> m_compiling; // started by BeginInitialize
+    bool m_compileStarted = false;
+
+    unsigned int m_gBuffer = 0;
+    unsigned int m_gAlbedoMetallic = 0;
+    unsigned int m_gNormalRoughness = 0;
+    unsigned int m_gDepth = 0;
+    int m_width = 0;
+    int m_height = 0;
+};
+} // namespace renderers
@@ -0,0 +1,77 @@
+#include <glad/glad.h>
+#include <cassert>
+#include "profiling/profiler.h"
+#include "renderers/forward_renderer.h"
+#include "utility/resources.h"
+
+namespace renderers
+{
+
+void ForwardRenderer::BeginInitialize()
+{
+    m_compileStarted = true;
+    m_pbrShaders.Initialize(utility::ResourcePath("shader/pbr.vert").c_str(), utility::ResourcePath("shader/pbr.frag").c_str(), object3ds::GetMaterialFeatureDefines(~0u), [](shader::Shader& shader)
+    {
+        shader.SetUniform("irradianceMap", 0);
+        shader.SetUniform("prefilterMap", 1);
+        shader.SetUniform("brdfLUT", 2);
+    });
+    // compile the fully textured permutation up front, it catches errors in pbr.frag and is the common one
+    m_pbrShaders.Prepare(~0u);
+}
+
+bool ForwardRenderer::Initialize(int width, int height)
+{
+    Resize(width, height);
+    if (!m_compileStarted) BeginInitialize();
+    return m_pbrShaders.Get(~0u) != nullptr;
+}
+
+void ForwardRenderer::Resize(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+}
+
+void ForwardRenderer::Render(object3ds::Model& model, const cameras::Camera& camera, const LightingInputs& lighting)
+{
+    profiling::ProfileScope scope("pbr");
+    const IBLTextures& ibl = lighting.ibl;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_outputFramebuffer);
+    glViewport(0, 0, m_width, m_height);
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f); // set the color to clear the screen
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // bind pre-computed IBL data
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, ibl.irradianceMap);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, ibl.prefilterMap);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, ibl.brdfLUT);
+    assert(lighting.lightGrid);
+
+    // the uniforms are per program, set them once on every permutation the model binds
+    glm::mat4 model_mat = glm::mat4(1.0f);
+    model.Draw(m_pbrShaders, [&](shader::Shader& shader)
+    {
+        shader.SetUniform("maxReflectionLod", (float)(ibl.prefilterMipLevels - 1));
+        shader.SetUniform("environmentBRDFMethod", static_cast<int>(ibl.environmentBRDF));
+        shader.SetUniform("multiScatter", ibl.multiScatter);
+        if (ibl.octahedralAtlas) ibl.octahedralAtlas->Bind(shader, ibl.octahedralSlot);
+        else ibl::OctahedralAtlas::BindDisabled(shader);
+
+        shader.SetUniform("model", model_mat);
+        shader.SetUniform("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model_mat))));
+        shader.SetUniform("view", camera.GetViewMatrix());
+        shader.SetUniform("projection", camera.GetProjectionMatrix());
+        shader.SetUniform("camPos", camera.GetPosition());
+        shader.SetUniform("screenSize", glm::vec2(m_width, m_height));
+        lighting.lightGrid->Bind(shader);
+        if (lighting.shadowMap) lighting.shadowMap->Bind(shader);
+        else lights::CascadedShadowMap::BindDisabled(shader);
+        if (lighting.probes) lighting.probes->Bind(shader);
+        else lights::ReflectionProbes::BindDisabled(shader);
+    });
+}
+} // namespace renderers
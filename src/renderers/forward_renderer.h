@@ -0,0 +1,24 @@
+#pragma once
+#include "renderers/renderer.h"
+#include "shader/shader.h"
+#include "shader/shader_permutations.h"
+
+namespace renderers
+{
+
+// shades every fragment of every mesh in a single pbr pass, with the pbr.frag permutation of the mesh's material textures
+class ForwardRenderer : public Renderer
+{
+public:
+    void BeginInitialize() override;
+    bool Initialize(int width, int height) override;
+    void Resize(int width, int height) override;
+    void Render(object3ds::Model& model, const cameras::Camera& camera, const LightingInputs& lighting) override;
+
+private:
+    shader::ShaderPermutations m_pbrShaders;
+    bool m_compileStarted = false;
+    int m_width = 0;
+    int m_height = 0;
+};
+} // namespace renderers
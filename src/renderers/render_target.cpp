@@ -0,0 +1,106 @@
+#include <glad/glad.h>
+#include <cstring>
+#include <iostream>
+#include "renderers/render_target.h"
+
+namespace renderers
+{
+
+RenderTarget::~RenderTarget()
+{
+    deleteAttachments();
+}
+
+bool RenderTarget::Initialize(int width, int height)
+{
+    deleteAttachments();
+    return createAttachments(width, height);
+}
+
+void RenderTarget::Resize(int width, int height)
+{
+    if (width == m_width && height == m_height) return;
+    if (width <= 0 || height <= 0) return; // minimized window
+    deleteAttachments();
+    createAttachments(width, height);
+}
+
+void RenderTarget::BlitToDefault() const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::ReadRGB8(std::vector<unsigned char>& pixels) const
+{
+    pixels.resize(static_cast<size_t>(m_width) * m_height * 3);
+    readPixels(GL_UNSIGNED_BYTE, pixels.data(), 3);
+}
+
+void RenderTarget::ReadRGB32F(std::vector<float>& pixels) const
+{
+    pixels.resize(static_cast<size_t>(m_width) * m_height * 3);
+    readPixels(GL_FLOAT, pixels.data(), 3 * sizeof(float));
+}
+
+bool RenderTarget::createAttachments(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glGenTextures(1, &m_color);
+    glBindTexture(GL_TEXTURE_2D, m_color);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color, 0);
+    glGenRenderbuffers(1, &m_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete)
+    {
+        std::cerr << "ERROR::RENDER_TARGET::INCOMPLETE" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+void RenderTarget::deleteAttachments()
+{
+    if (m_framebuffer == 0) return;
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteTextures(1, &m_color);
+    glDeleteRenderbuffers(1, &m_depth);
+    m_framebuffer = m_color = m_depth = 0;
+    m_width = m_height = 0;
+}
+
+void RenderTarget::readPixels(unsigned int type, void* pixels, size_t pixelBytes) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGB, type, pixels);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    // GL rows start at the bottom
+    size_t rowBytes = pixelBytes * m_width;
+    std::vector<unsigned char> row(rowBytes);
+    unsigned char* bytes = static_cast<unsigned char*>(pixels);
+    for (int y = 0; y < m_height / 2; ++y)
+    {
+        unsigned char* top = bytes + y * rowBytes;
+        unsigned char* bottom = bytes + (m_height - 1 - y) * rowBytes;
+        std::memcpy(row.data(), top, rowBytes);
+        std::memcpy(top, bottom, rowBytes);
+        std::memcpy(bottom, row.data(), rowBytes);
+    }
+}
+} // namespace renderers
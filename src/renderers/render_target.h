@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+
+namespace renderers
+{
+
+// the framebuffer a frame is rendered into, RGBA16F color and depth. The window shows it with a blit, headless runs
+// read it back; either way the renderers draw the same frame into the same kind of target
+class RenderTarget
+{
+public:
+    ~RenderTarget();
+
+    bool Initialize(int width, int height);
+    // recreates the attachments when the size changed
+    void Resize(int width, int height);
+
+    // copies the color to the window's back buffer
+    void BlitToDefault() const;
+    // the color as displayed, rows top to bottom
+    void ReadRGB8(std::vector<unsigned char>& pixels) const;
+    void ReadRGB32F(std::vector<float>& pixels) const;
+
+    inline unsigned int GetFramebuffer() const { return m_framebuffer; }
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+
+private:
+    bool createAttachments(int width, int height);
+    void deleteAttachments();
+    void readPixels(unsigned int type, void* pixels, size_t pixelBytes) const;
+
+    unsigned int m_framebuffer = 0;
+    unsigned int m_color = 0;
+    unsigned int m_depth = 0;
+    int m_width = 0;
+    int m_height = 0;
+};
+} // namespace renderers
@@ -0,0 +1,17 @@
+#include "renderers/renderer.h"
+#include "renderers/forward_renderer.h"
+#include "renderers/deferred_renderer.h"
+
+namespace renderers
+{
+
+std::unique_ptr<Renderer> CreateRenderer(RendererType type)
+{
+    switch (type)
+    {
+        case RendererType::Deferred: return std::make_unique<DeferredRenderer>();
+        case RendererType::Forward:
+        default: return std::make_unique<ForwardRenderer>();
+    }
+}
+} // namespace renderers
@@ -0,0 +1,64 @@
+#pragma once
+#include <memory>
+#include "cameras/camera.h"
+#include "object3ds/model.h"
+#include "lights/cluster_grid.h"
+#include "lights/cascaded_shadow_map.h"
+#include "lights/reflection_probes.h"
+#include "ibl/octahedral_atlas.h"
+#include "ibl/environment_brdf.h"
+
+namespace renderers
+{
+
+// pre-computed image based lighting data shared by every rendering path
+struct IBLTextures
+{
+    unsigned int irradianceMap = 0;
+    unsigned int prefilterMap = 0;
+    unsigned int brdfLUT = 0; // 0 when an analytic environment BRDF is used
+    unsigned int prefilterMipLevels = 5; // ibl::IBLSettings::prefilterMipLevels the prefilter map was baked with
+    // when set the irradiance and prefilter data are read from this atlas slot instead of the cubemaps
+    const ibl::OctahedralAtlas* octahedralAtlas = nullptr;
+    unsigned int octahedralSlot = 0;
+    ibl::EnvironmentBRDF environmentBRDF = ibl::EnvironmentBRDF::LUT;
+    bool multiScatter = true; // energy compensation of the specular term, the single scattering split-sum darkens rough metals
+};
+
+// everything besides the geometry a renderer needs to light a frame
+struct LightingInputs
+{
+    IBLTextures ibl;
+    const lights::ClusteredLightGrid* lightGrid = nullptr;
+    const lights::CascadedShadowMap* shadowMap = nullptr; // no sun when null
+    const lights::ReflectionProbes* probes = nullptr;     // only the global prefilter map when null
+};
+
+enum class RendererType
+{
+    Forward,
+    Deferred
+};
+
+class Renderer
+{
+public:
+    virtual ~Renderer() = default;
+
+    // starts compiling the renderer's programs without waiting for the driver, Initialize finishes them.
+    // Calling it is optional, it lets the compilation overlap with loading the scene
+    virtual void BeginInitialize() { }
+    virtual bool Initialize(int width, int height) = 0;
+    virtual void Resize(int width, int height) { }
+    virtual void Render(object3ds::Model& model, const cameras::Camera& camera, const LightingInputs& lighting) = 0;
+
+    // the framebuffer Render draws the final image into, the window's default framebuffer (0) unless set.
+    // Render binds it and sets the viewport to the renderer's size itself
+    inline void SetOutputFramebuffer(unsigned int framebuffer) { m_outputFramebuffer = framebuffer; }
+
+protected:
+    unsigned int m_outputFramebuffer = 0;
+};
+
+std::unique_ptr<Renderer> CreateRenderer(RendererType type);
+} // namespace renderers
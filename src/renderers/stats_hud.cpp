@@ -0,0 +1,258 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <iterator>
+#include "renderers/stats_hud.h"
+#include "profiling/zones.h"
+#include "utility/resources.h"
+
+namespace renderers
+{
+
+namespace
+{
+constexpr int kGlyphWidth = 5;
+constexpr int kGlyphHeight = 7;
+// every glyph has a blank column and row after it in the font texture, nearest filtering never reaches a neighbor
+constexpr int kCellWidth = kGlyphWidth + 1;
+constexpr int kCellHeight = kGlyphHeight + 1;
+constexpr int kLineHeight = kGlyphHeight + 3; // font pixels
+constexpr int kMargin = 4;
+
+struct Glyph
+{
+    char character;
+    const char* rows[kGlyphHeight];
+};
+
+// lower case is drawn upper case, characters without a glyph as blanks
+const Glyph kGlyphs[] = {
+    { ' ', { ".....", ".....", ".....", ".....", ".....", ".....", "....." } },
+    { '0', { ".###.", "#...#", "#..##", "#.#.#", "##..#", "#...#", ".###." } },
+    { '1', { "..#..", ".##..", "..#..", "..#..", "..#..", "..#..", ".###." } },
+    { '2', { ".###.", "#...#", "....#", "...#.", "..#..", ".#...", "#####" } },
+    { '3', { "#####", "...#.", "..#..", "...#.", "....#", "#...#", ".###." } },
+    { '4', { "...#.", "..##.", ".#.#.", "#..#.", "#####", "...#.", "...#." } },
+    { '5', { "#####", "#....", "####.", "....#", "....#", "#...#", ".###." } },
+    { '6', { "..##.", ".#...", "#....", "####.", "#...#", "#...#", ".###." } },
+    { '7', { "#####", "....#", "...#.", "..#..", ".#...", ".#...", ".#..." } },
+    { '8', { ".###.", "#...#", "#...#", ".###.", "#...#", "#...#", ".###." } },
+    { '9', { ".###.", "#...#", "#...#", ".####", "....#", "...#.", ".##.." } },
+    { 'A', { ".###.", "#...#", "#...#", "#####", "#...#", "#...#", "#...#" } },
+    { 'B', { "####.", "#...#", "#...#", "####.", "#...#", "#...#", "####." } },
+    { 'C', { ".###.", "#...#", "#....", "#....", "#....", "#...#", ".###." } },
+    { 'D', { "###..", "#..#.", "#...#", "#...#", "#...#", "#..#.", "###.." } },
+    { 'E', { "#####", "#....", "#....", "####.", "#....", "#....", "#####" } },
+    { 'F', { "#####", "#....", "#....", "####.", "#....", "#....", "#...." } },
+    { 'G', { ".###.", "#...#", "#....", "#.###", "#...#", "#...#", ".####" } },
+    { 'H', { "#...#", "#...#", "#...#", "#####", "#...#", "#...#", "#...#" } },
+    { 'I', { ".###.", "..#..", "..#..", "..#..", "..#..", "..#..", ".###." } },
+    { 'J', { "..###", "...#.", "...#.", "...#.", "...#.", "#..#.", ".##.." } },
+    { 'K', { "#...#", "#..#.", "#.#..", "##...", "#.#..", "#..#.", "#...#" } },
+    { 'L', { "#....", "#....", "#....", "#....", "#....", "#....", "#####" } },
+    { 'M', { "#...#", "##.##", "#.#.#", "#.#.#", "#...#", "#...#", "#...#" } },
+    { 'N', { "#...#", "#...#", "##..#", "#.#.#", "#..##", "#...#", "#...#" } },
+    { 'O', { ".###.", "#...#", "#...#", "#...#", "#...#", "#...#", ".###." } },
+    { 'P', { "####.", "#...#", "#...#", "####.", "#....", "#....", "#...." } },
+    { 'Q', { ".###.", "#...#", "#...#", "#...#", "#.#.#", "#..#.", ".##.#" } },
+    { 'R', { "####.", "#...#", "#...#", "####.", "#.#..", "#..#.", "#...#" } },
+    { 'S', { ".####", "#....", "#....", ".###.", "....#", "....#", "####." } },
+    { 'T', { "#####", "..#..", "..#..", "..#..", "..#..", "..#..", "..#.." } },
+    { 'U', { "#...#", "#...#", "#...#", "#...#", "#...#", "#...#", ".###." } },
+    { 'V', { "#...#", "#...#", "#...#", "#...#", "#...#", ".#.#.", "..#.." } },
+    { 'W', { "#...#", "#...#", "#...#", "#.#.#", "#.#.#", "#.#.#", ".#.#." } },
+    { 'X', { "#...#", "#...#", ".#.#.", "..#..", ".#.#.", "#...#", "#...#" } },
+    { 'Y', { "#...#", "#...#", ".#.#.", "..#..", "..#..", "..#..", "..#.." } },
+    { 'Z', { "#####", "....#", "...#.", "..#..", ".#...", "#....", "#####" } },
+    { '.', { ".....", ".....", ".....", ".....", ".....", ".##..", ".##.." } },
+    { ',', { ".....", ".....", ".....", ".....", ".##..", "..#..", ".#..." } },
+    { ':', { ".....", ".##..", ".##..", ".....", ".##..", ".##..", "....." } },
+    { '/', { ".....", "....#", "...#.", "..#..", ".#...", "#....", "....." } },
+    { '%', { "##...", "##..#", "...#.", "..#..", ".#...", "#..##", "...##" } },
+    { '(', { "...#.", "..#..", ".#...", ".#...", ".#...", "..#..", "...#." } },
+    { ')', { ".#...", "..#..", "...#.", "...#.", "...#.", "..#..", ".#..." } },
+    { '-', { ".....", ".....", ".....", "#####", ".....", ".....", "....." } },
+    { '+', { ".....", "..#..", "..#..", "#####", "..#..", "..#..", "....." } },
+};
+constexpr int kGlyphCount = sizeof(kGlyphs) / sizeof(kGlyphs[0]);
+
+int glyphIndex(char character)
+{
+    char upper = static_cast<char>(std::toupper(static_cast<unsigned char>(character)));
+    for (int i = 0; i < kGlyphCount; ++i)
+    {
+        if (kGlyphs[i].character == upper) return i;
+    }
+    return 0;
+}
+
+// 1234 -> "1234", 56789 -> "56.8K", 1250000 -> "1.25M"
+std::string formatCount(uint64_t count)
+{
+    char text[32];
+    if (count < 10000) std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(count));
+    else if (count < 1000000) std::snprintf(text, sizeof(text), "%.1fK", count / 1.0e3);
+    else std::snprintf(text, sizeof(text), "%.2fM", count / 1.0e6);
+    return text;
+}
+
+std::string formatBytes(uint64_t bytes)
+{
+    char text[32];
+    if (bytes < 1024 * 1024) std::snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+    else std::snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+    return text;
+}
+} // namespace
+
+StatsHud::~StatsHud()
+{
+    if (m_fontTexture != 0)
+    {
+        glDeleteTextures(1, &m_fontTexture);
+        glDeleteVertexArrays(1, &m_VAO);
+        glDeleteBuffers(1, &m_VBO);
+    }
+}
+
+bool StatsHud::Initialize()
+{
+    if (!m_shader.Initialize(utility::ResourcePath("shader/hud.vert").c_str(), utility::ResourcePath("shader/hud.frag").c_str())) return false;
+
+    // the glyphs side by side in one row of cells, the top row of a glyph in texture row 0
+    int fontWidth = kGlyphCount * kCellWidth;
+    std::vector<unsigned char> pixels(static_cast<size_t>(fontWidth) * kCellHeight, 0);
+    for (int i = 0; i < kGlyphCount; ++i)
+    {
+        for (int y = 0; y < kGlyphHeight; ++y)
+        {
+            for (int x = 0; x < kGlyphWidth; ++x)
+            {
+                if (kGlyphs[i].rows[y][x] == '#') pixels[static_cast<size_t>(y) * fontWidth + i * kCellWidth + x] = 255;
+            }
+        }
+    }
+    glGenTextures(1, &m_fontTexture);
+    glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, fontWidth, kCellHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // x, y in window pixels, then the font texture coordinates
+    glGenVertexArrays(1, &m_VAO);
+    glGenBuffers(1, &m_VBO);
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glBindVertexArray(0);
+
+    m_shader.Use();
+    m_shader.SetUniform("font", 0);
+    return true;
+}
+
+void StatsHud::Update(const profiling::FrameStats& stats)
+{
+    int64_t now = profiling::Now();
+    if (m_updated && now - m_lastUpdate < kRefreshNanoseconds) return;
+    m_lastUpdate = now;
+    m_updated = true;
+
+    const profiling::FrameRecord& frame = stats.GetLastFrame();
+    const profiling::GLCounters& counters = frame.counters;
+    double average = stats.GetAverageMilliseconds();
+    char line[128];
+    std::vector<std::string> lines;
+    std::snprintf(line, sizeof(line), "FRAME %.2f MS  %.0f FPS", average, average > 0.0 ? 1000.0 / average : 0.0);
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "P50 %.2f  P95 %.2f  P99 %.2f MS", stats.GetPercentile(0.5), stats.GetPercentile(0.95), stats.GetPercentile(0.99));
+    lines.push_back(line);
+    lines.push_back("DRAWS " + formatCount(counters.drawCalls) + "  TRIS " + formatCount(counters.triangles) + "  DISPATCHES " + formatCount(counters.dispatches));
+    lines.push_back("TEXTURE BINDS " + formatCount(counters.textureBinds) + "  PROGRAMS " + formatCount(counters.programSwitches));
+    lines.push_back("UPLOADS " + formatCount(counters.uploads) + "  " + formatBytes(counters.uploadBytes));
+    std::string memory = "VRAM " + formatBytes(frame.videoMemoryBytes);
+    uint64_t driverBytes = profiling::QueryDriverVideoMemoryBytes();
+    if (driverBytes > 0) memory += "  DRIVER " + formatBytes(driverBytes);
+    lines.push_back(memory);
+    buildGeometry(lines);
+}
+
+void StatsHud::Draw(int width, int height)
+{
+    if (m_vertexCount == 0 || width <= 0 || height <= 0) return;
+    profiling::SetGLCountersPaused(true);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    glViewport(0, 0, width, height);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_shader.Use();
+    m_shader.SetUniform("screenSize", glm::vec2(width, height));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+    glBindVertexArray(m_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, m_vertexCount);
+    glBindVertexArray(0);
+
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+    if (cullFace) glEnable(GL_CULL_FACE);
+    if (!blend) glDisable(GL_BLEND);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    profiling::SetGLCountersPaused(false);
+}
+
+void StatsHud::buildGeometry(const std::vector<std::string>& lines)
+{
+    std::vector<float> vertices;
+    auto addQuad = [&vertices](float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1)
+    {
+        const float quad[] = { x0, y0, u0, v0, x0, y1, u0, v1, x1, y1, u1, v1,
+                               x0, y0, u0, v0, x1, y1, u1, v1, x1, y0, u1, v0 };
+        vertices.insert(vertices.end(), std::begin(quad), std::end(quad));
+    };
+
+    // the panel behind the text, negative texture coordinates tell the shader
+    size_t columns = 0;
+    for (const std::string& line : lines) columns = std::max(columns, line.size());
+    float panelWidth = static_cast<float>((2 * kMargin + columns * kCellWidth) * kScale);
+    float panelHeight = static_cast<float>((2 * kMargin + lines.size() * kLineHeight) * kScale);
+    addQuad(0.0f, 0.0f, panelWidth, panelHeight, -1.0f, -1.0f, -1.0f, -1.0f);
+
+    float fontWidth = static_cast<float>(kGlyphCount * kCellWidth);
+    for (size_t row = 0; row < lines.size(); ++row)
+    {
+        for (size_t column = 0; column < lines[row].size(); ++column)
+        {
+            int glyph = glyphIndex(lines[row][column]);
+            if (glyph == 0) continue; // blank
+            float x = static_cast<float>((kMargin + column * kCellWidth) * kScale);
+            float y = static_cast<float>((kMargin + row * kLineHeight) * kScale);
+            float u = glyph * kCellWidth / fontWidth;
+            addQuad(x, y, x + kGlyphWidth * kScale, y + kGlyphHeight * kScale,
+                u, 0.0f, u + kGlyphWidth / fontWidth, static_cast<float>(kGlyphHeight) / kCellHeight);
+        }
+    }
+
+    profiling::SetGLCountersPaused(true);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    profiling::SetGLCountersPaused(false);
+    m_vertexCount = static_cast<int>(vertices.size() / 4);
+}
+} // namespace renderers
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "profiling/frame_stats.h"
+#include "shader/shader.h"
+
+namespace renderers
+{
+
+// the frame statistics as text in the top left corner of the window: frame time and its percentiles, the GL counters
+// of the last frame and the video memory. A built-in 5x7 pixel font, one draw for the whole text. It is drawn over the
+// window's back buffer after the blit, so read back and written frames never contain it, and its GL calls are left
+// out of the counters it shows
+class StatsHud
+{
+public:
+    static constexpr int kScale = 2;                 // window pixels per font pixel
+    static constexpr int64_t kRefreshNanoseconds = 250000000;
+
+    ~StatsHud();
+
+    bool Initialize();
+    // rebuilds the text from the stats, at most every kRefreshNanoseconds so the numbers stay readable
+    void Update(const profiling::FrameStats& stats);
+    // draws into the bound framebuffer of the given size
+    void Draw(int width, int height);
+
+private:
+    void buildGeometry(const std::vector<std::string>& lines);
+
+    shader::Shader m_shader;
+    unsigned int m_fontTexture = 0;
+    unsigned int m_VAO = 0;
+    unsigned int m_VBO = 0;
+    int m_vertexCount = 0;
+    int64_t m_lastUpdate = 0; // profiling::Now()
+    bool m_updated = false;
+};
+} // namespace renderers
@@ -0,0 +1,162 @@
+#include <glad/glad.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "shader/program_cache.h"
+
+namespace shader
+{
+
+namespace
+{
+constexpr char CACHE_MAGIC[4] = { 'G', 'L', 'P', 'B' };
+constexpr uint32_t CACHE_FORMAT_VERSION = 1;
+
+// written in front of the driver's binary
+struct CacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+std::string cacheDirectory = "shader_cache";
+ProgramCacheStats cacheStats;
+
+// FNV-1a, 64 bit
+void hashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+void hashString(uint64_t& hash, const char* text)
+{
+    // the terminator separates the strings, "ab" + "c" and "a" + "bc" hash differently
+    if (text) hashBytes(hash, text, std::strlen(text) + 1);
+    else hashBytes(hash, "", 1);
+}
+
+std::string cachePath(uint64_t key)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(cacheDirectory) / name).string();
+}
+
+bool binaryFormatsSupported()
+{
+    int formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+} // namespace
+
+void SetProgramCacheDirectory(const std::string& directory)
+{
+    cacheDirectory = directory;
+}
+
+bool IsProgramCacheEnabled()
+{
+    return !cacheDirectory.empty();
+}
+
+void ClearProgramCache()
+{
+    if (cacheDirectory.empty()) return;
+    std::error_code error;
+    std::filesystem::remove_all(cacheDirectory, error);
+    if (error) std::cerr << "Warning: Fail to clear the shader cache " << cacheDirectory << ": " << error.message() << std::endl;
+}
+
+ProgramCacheStats& GetProgramCacheStats()
+{
+    return cacheStats;
+}
+
+uint64_t ComputeProgramKey(const std::vector<std::string>& stageSources)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hashBytes(hash, &CACHE_FORMAT_VERSION, sizeof(CACHE_FORMAT_VERSION));
+    hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    hashString(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    for (const std::string& source : stageSources) hashString(hash, source.c_str());
+    return hash;
+}
+
+unsigned int LoadCachedProgram(uint64_t key)
+{
+    if (!IsProgramCacheEnabled()) return 0;
+    std::string path = cachePath(key);
+    std::ifstream input(path, std::ios::binary);
+    if (!input.is_open()) return 0;
+
+    CacheHeader header;
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.version != CACHE_FORMAT_VERSION || header.key != key)
+    {
+        return 0;
+    }
+    std::vector<char> binary(header.binaryLength);
+    if (!input.read(binary.data(), binary.size())) return 0;
+    input.close();
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<int>(binary.size()));
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        // the driver changed without changing its strings, recompile and overwrite the file
+        glDeleteProgram(program);
+        ++cacheStats.rejected;
+        return 0;
+    }
+    return program;
+}
+
+void StoreCachedProgram(uint64_t key, unsigned int program)
+{
+    if (!IsProgramCacheEnabled() || !binaryFormatsSupported()) return;
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_FORMAT_VERSION;
+    header.key = key;
+    std::vector<char> binary(length);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+    header.binaryFormat = binaryFormat;
+    header.binaryLength = static_cast<uint32_t>(length);
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+    // write to a temporary file and rename it, a crash never leaves a truncated binary behind
+    std::string path = cachePath(key);
+    std::string temporaryPath = path + ".tmp";
+    std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!output.is_open())
+    {
+        std::cerr << "Warning: Fail to write the shader cache " << temporaryPath << std::endl;
+        return;
+    }
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(binary.data(), length);
+    output.close();
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) std::cerr << "Warning: Fail to write the shader cache " << path << ": " << error.message() << std::endl;
+}
+} // namespace shader
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace shader
+{
+
+struct ProgramCacheStats
+{
+    unsigned int hits = 0;            // programs created from a cached binary
+    unsigned int misses = 0;          // programs compiled from source
+    unsigned int rejected = 0;        // cached binaries the driver refused, they are compiled and replaced
+    double loadMilliseconds = 0.0;    // creating the programs from binaries
+    double compileMilliseconds = 0.0; // compiling and linking from source, including writing the binary
+};
+
+// Linked program binaries (glGetProgramBinary) persisted in a directory, one file per program.
+// The key hashes the sources of every stage as compiled, defines included, with the driver's vendor,
+// renderer and version strings, so an edited shader or another driver misses the cache.
+// A binary the driver refuses anyway falls back to compiling from source.
+
+// an empty directory disables the cache, it is created on the first store
+void SetProgramCacheDirectory(const std::string& directory);
+bool IsProgramCacheEnabled();
+// deletes the cached binaries, the next programs are compiled cold
+void ClearProgramCache();
+ProgramCacheStats& GetProgramCacheStats();
+
+// needs a current context for the driver strings
+uint64_t ComputeProgramKey(const std::vector<std::string>& stageSources);
+// the linked program, 0 when there is no usable binary
+unsigned int LoadCachedProgram(uint64_t key);
+// program must be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+void StoreCachedProgram(uint64_t key, unsigned int program);
+} // namespace shader
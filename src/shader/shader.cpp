@@ -1,28 +1,206 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
-#include <fstream>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <string>
-#include <sstream>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "utility/stb_image.h"
 #include "shader/shader.h"
+#include "shader/program_cache.h"
+#include "shader/shader_preprocessor.h"
+#include "utility/file_watcher.h"
 
 namespace shader
 {
 
-bool Shader::Initialize(const char* vertexShaderPath, const char* fragmentShaderPath)
+namespace
 {
-    glm::value_ptr(glm::mat4(1.0f));
-    if (prepareShader(vertexShaderPath, fragmentShaderPath))
+// KHR_parallel_shader_compile, not part of the loader
+constexpr GLenum COMPLETION_STATUS_KHR = 0x91B1;
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+bool parallelCompileEnabled = true;
+int parallelCompileSupport = -1; // unknown until queried with a current context
+
+// hot reload, the watcher exists while it is enabled
+std::unique_ptr<utility::FileWatcher> fileWatcher;
+std::vector<Shader*> watchedShaders;
+
+// inserts the defines after the #version line, which must stay first. The #line directive
+// keeps the line numbers of the compiler messages matching the file
+std::string injectDefines(const std::string& source, const std::string& defines)
+{
+    if (defines.empty()) return source;
+    size_t version = source.find("#version");
+    size_t versionEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+    if (versionEnd == std::string::npos) return source;
+    long nextLine = std::count(source.begin(), source.begin() + versionEnd + 1, '\n') + 1;
+    return source.substr(0, versionEnd + 1) + defines + "#line " + std::to_string(nextLine) + "\n" + source.substr(versionEnd + 1);
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
+void SetParallelShaderCompile(bool enabled)
+{
+    parallelCompileEnabled = enabled;
+}
+
+void InitializeParallelShaderCompile()
+{
+    if (parallelCompileSupport >= 0) return;
+    parallelCompileSupport = 0;
+    int extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (int i = 0; i < extensionCount; ++i)
     {
-        m_initialized = true;
-        return true;
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 || std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0)
+        {
+            parallelCompileSupport = 1;
+            break;
+        }
     }
-    return false;
+    if (!parallelCompileSupport) return;
+    auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+    if (!maxShaderCompilerThreads) maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+    if (maxShaderCompilerThreads) maxShaderCompilerThreads(0xFFFFFFFFu);
+}
+
+bool IsParallelShaderCompileAvailable()
+{
+    InitializeParallelShaderCompile();
+    return parallelCompileEnabled && parallelCompileSupport == 1;
+}
+
+bool WaitForShaders(std::vector<ShaderFuture>& futures)
+{
+    bool usable = true;
+    while (!futures.empty())
+    {
+        // none completed yet: wait on the oldest. Without the extension every program reports ready, in order
+        size_t next = 0;
+        for (size_t i = 0; i < futures.size(); ++i)
+        {
+            if (futures[i].IsReady())
+            {
+                next = i;
+                break;
+            }
+        }
+        if (!futures[next].Get()) usable = false;
+        futures.erase(futures.begin() + next);
+    }
+    return usable;
+}
+
+void SetShaderHotReload(bool enabled)
+{
+    if (enabled && !fileWatcher) fileWatcher = std::make_unique<utility::FileWatcher>();
+    else if (!enabled) fileWatcher.reset();
+}
+
+unsigned int ReloadChangedShaders()
+{
+    if (!fileWatcher) return 0;
+    std::vector<std::string> changed = fileWatcher->Poll();
+    if (changed.empty()) return 0;
+    for (const std::string& path : changed) InvalidateShaderFile(path);
+
+    // start every affected program before waiting on any, with KHR_parallel_shader_compile they compile side by side
+    std::vector<Shader*> reloading;
+    for (Shader* shader : watchedShaders)
+    {
+        bool affected = false;
+        for (int i = 0; i < shader->m_sourceCount; ++i)
+        {
+            for (const std::string& file : shader->m_sourceFiles[i])
+            {
+                affected = affected || std::find(changed.begin(), changed.end(), file) != changed.end();
+            }
+        }
+        if (!affected) continue;
+        shader->beginReload();
+        reloading.push_back(shader);
+    }
+
+    unsigned int swapped = 0;
+    for (Shader* shader : reloading)
+    {
+        const std::string& path = shader->m_sourcePaths[shader->m_sourceCount - 1];
+        if (shader->finishReload())
+        {
+            ++swapped;
+            std::cout << "Reloaded " << path << (shader->m_defines.empty() ? "" : " (permutation)") << std::endl;
+        }
+        else std::cerr << "Reload of " << path << " failed, the previous program stays in use" << std::endl;
+    }
+    return swapped;
+}
+
+bool ShaderFuture::IsReady() const
+{
+    return !m_shader || m_shader->isProgramComplete();
+}
+
+bool ShaderFuture::Get()
+{
+    if (!m_shader) return false;
+    return m_shader->finishProgram();
+}
+
+bool Shader::Initialize(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+    return Initialize(vertexShaderPath, nullptr, fragmentShaderPath);
+}
+
+bool Shader::Initialize(const char* vertexShaderPath, const char* geometryShaderPath, const char* fragmentShaderPath)
+{
+    return InitializeAsync(vertexShaderPath, geometryShaderPath, fragmentShaderPath).Get();
+}
+
+bool Shader::Initialize(const char* vertexShaderPath, const char* fragmentShaderPath, const std::vector<std::string>& defines)
+{
+    return InitializeAsync(vertexShaderPath, fragmentShaderPath, defines).Get();
+}
+
+bool Shader::InitializeCompute(const char* computeShaderPath)
+{
+    return InitializeComputeAsync(computeShaderPath).Get();
+}
+
+ShaderFuture Shader::InitializeAsync(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+    return InitializeAsync(vertexShaderPath, nullptr, fragmentShaderPath);
+}
+
+ShaderFuture Shader::InitializeAsync(const char* vertexShaderPath, const char* geometryShaderPath, const char* fragmentShaderPath)
+{
+    glm::value_ptr(glm::mat4(1.0f));
+    // a file that can't be read leaves the shader uninitialized, the future's Get reports it
+    prepareShader(vertexShaderPath, geometryShaderPath, fragmentShaderPath);
+    return ShaderFuture(this);
+}
+
+ShaderFuture Shader::InitializeAsync(const char* vertexShaderPath, const char* fragmentShaderPath, const std::vector<std::string>& defines)
+{
+    m_defines.clear();
+    for (const std::string& define : defines) m_defines += "#define " + define + "\n";
+    return InitializeAsync(vertexShaderPath, nullptr, fragmentShaderPath);
+}
+
+ShaderFuture Shader::InitializeComputeAsync(const char* computeShaderPath)
+{
+    prepareComputeShader(computeShaderPath);
+    return ShaderFuture(this);
 }
 
 void Shader::Use()
@@ -33,6 +211,12 @@ void Shader::Use()
 
 Shader::~Shader()
 {
+    if (m_watched) watchedShaders.erase(std::remove(watchedShaders.begin(), watchedShaders.end(), this), watchedShaders.end());
+    if (m_compiling)
+    {
+        deletePendingShaders();
+        glDeleteProgram(m_shaderProgram);
+    }
     if (m_initialized) 
     {
         glDeleteProgram(m_shaderProgram);
@@ -41,135 +225,335 @@ Shader::~Shader()
 
 void Shader::SetUniform(const char* name, float value)
 {
-    assert(m_initialized);
-    int location = glGetUniformLocation(m_shaderProgram, name);
-    glUniform1f(location, value);
+    setUniform(name, GL_FLOAT, &value, sizeof(value));
 }
 
 void Shader::SetUniform(const char* name, int value)
 {
-    assert(m_initialized);
-    int location = glGetUniformLocation(m_shaderProgram, name);
-    glUniform1i(location, value);
+    setUniform(name, GL_INT, &value, sizeof(value));
+}
+
+void Shader::SetUniform(const char* name, unsigned int value)
+{
+    setUniform(name, GL_UNSIGNED_INT, &value, sizeof(value));
 }
 
 void Shader::SetUniform(const char* name, bool value)
 {
-    assert(m_initialized);
-    int location = glGetUniformLocation(m_shaderProgram, name);
-    glUniform1i(location, value);
+    int integer = value;
+    setUniform(name, GL_BOOL, &integer, sizeof(integer));
 }
 
 void Shader::SetUniform(const char* name, glm::mat4 trans)
 {
-    assert(m_initialized);
-    int location = glGetUniformLocation(m_shaderProgram, name);
-    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(trans));
+    setUniform(name, GL_FLOAT_MAT4, glm::value_ptr(trans), sizeof(trans));
 }
 
 void Shader::SetUniform(const char* name, glm::mat3 trans)
 {
-    assert(m_initialized);
-    int location = glGetUniformLocation(m_shaderProgram, name);
-    glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(trans));
+    setUniform(name, GL_FLOAT_MAT3, glm::value_ptr(trans), sizeof(trans));
 }
 
 void Shader::SetUniform(const char* name, glm::vec3 vec)
 {
-    assert(m_initialized);
-    int location = glGetUniformLocation(m_shaderProgram, name);
-    glUniform3fv(location, 1, glm::value_ptr(vec));
-}
-
-bool Shader::prepareShader(const char* vertexShaderPath, const char* fragmentShaderPath)
-{
-    unsigned int vertexShader;
-    vertexShader = glCreateShader(GL_VERTEX_SHADER); // create a shader object
-    std::ifstream input;
-    int success;
-    char infoLog[512];
-
-    input.open(vertexShaderPath, std::ios::in);
-    if (input.is_open())
-    {
-        std::string vertexShaderSource;
-        std::stringstream vertexStream;
-        vertexStream << input.rdbuf();
-        vertexShaderSource = vertexStream.str();
-        const char* source = vertexShaderSource.c_str();
-        glShaderSource(vertexShader, 1, &source, NULL); // attach the shader source code to the shader object
-        glCompileShader(vertexShader); // compile the shader
-        // check if the compilation is successful
-        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-        if(!success)
-        {
-            glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-            std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    setUniform(name, GL_FLOAT_VEC3, glm::value_ptr(vec), sizeof(vec));
+}
 
-            glDeleteShader(vertexShader);
-            input.close();
-            return false;
-        }
-        input.close();
+void Shader::SetUniform(const char* name, glm::vec2 vec)
+{
+    setUniform(name, GL_FLOAT_VEC2, glm::value_ptr(vec), sizeof(vec));
+}
+
+bool Shader::prepareShader(const char* vertexShaderPath, const char* geometryShaderPath, const char* fragmentShaderPath)
+{
+    if (fileWatcher && !m_watched)
+    {
+        m_watched = true;
+        watchedShaders.push_back(this);
     }
-    else
+    const char* paths[3];
+    unsigned int types[3];
+    int count = 0;
+    paths[count] = vertexShaderPath;
+    types[count++] = GL_VERTEX_SHADER;
+    // the geometry stage is optional
+    if (geometryShaderPath)
     {
-        std::cerr << "Error: Fail to open vertex shader file" << std::endl;
-        glDeleteShader(vertexShader);
-        return false;
+        paths[count] = geometryShaderPath;
+        types[count++] = GL_GEOMETRY_SHADER;
     }
+    paths[count] = fragmentShaderPath;
+    types[count++] = GL_FRAGMENT_SHADER;
+    return beginProgram(paths, types, count);
+}
 
-    unsigned int fragmentShader;
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    input.open(fragmentShaderPath, std::ios::in);
-    if (input.is_open())
-    {
-        std::string fragmentShaderSource;
-        std::stringstream fragmentStream;
-        fragmentStream << input.rdbuf();
-        fragmentShaderSource = fragmentStream.str();
-        const char* source = fragmentShaderSource.c_str();
-        glShaderSource(fragmentShader, 1, &source, NULL);
-        glCompileShader(fragmentShader);
-        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success); // check if the compilation is successful
-        if(!success)
+bool Shader::prepareComputeShader(const char* computeShaderPath)
+{
+    if (fileWatcher && !m_watched)
+    {
+        m_watched = true;
+        watchedShaders.push_back(this);
+    }
+    unsigned int type = GL_COMPUTE_SHADER;
+    return beginProgram(&computeShaderPath, &type, 1);
+}
+
+bool Shader::beginProgram(const char* const* paths, const unsigned int* types, int count)
+{
+    auto start = std::chrono::steady_clock::now();
+    m_sourceCount = count;
+    for (int i = 0; i < count; ++i)
+    {
+        m_sourcePaths[i] = paths[i];
+        m_sourceTypes[i] = types[i];
+    }
+    std::vector<std::string> sources(count);
+    for (int i = 0; i < count; ++i)
+    {
+        bool read = readShaderFile(paths[i], sources[i], m_sourceFiles[i]);
+        // watched even when it failed, saving the fix reloads it
+        if (fileWatcher && m_watched)
         {
-            glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-            std::cerr << "ERROR::SHADER::FRAGMENET::COMPILATION_FAILED\n" << infoLog << std::endl;
-            
-            glDeleteShader(vertexShader);
-            glDeleteShader(fragmentShader);
-            input.close();
-            return false;
+            fileWatcher->Watch(m_sourcePaths[i]);
+            for (const std::string& file : m_sourceFiles[i]) fileWatcher->Watch(file);
         }
-        input.close();
+        if (!read) return false;
     }
-    else
+
+    ProgramCacheStats& stats = GetProgramCacheStats();
+    m_pendingKey = 0;
+    if (IsProgramCacheEnabled())
     {
-        std::cerr << "Error: Fail to open fragment shader file" << std::endl;
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return false;
+        m_pendingKey = ComputeProgramKey(sources);
+        m_shaderProgram = LoadCachedProgram(m_pendingKey);
+        if (m_shaderProgram != 0)
+        {
+            ++stats.hits;
+            stats.loadMilliseconds += millisecondsSince(start);
+            reflectUniforms();
+            m_initialized = true;
+            return true;
+        }
     }
 
+    // only issue the work here, every status query waits for the driver and is left to finishProgram
+    m_pendingCount = count;
+    for (int i = 0; i < count; ++i)
+    {
+        m_pendingShaders[i] = glCreateShader(types[i]); // create a shader object
+        const char* source = sources[i].c_str();
+        glShaderSource(m_pendingShaders[i], 1, &source, NULL); // attach the shader source code to the shader object
+        glCompileShader(m_pendingShaders[i]); // compile the shader
+    }
     m_shaderProgram = glCreateProgram();
-    glAttachShader(m_shaderProgram, vertexShader);
-    glAttachShader(m_shaderProgram, fragmentShader);
+    // without the hint the driver may not keep the binary around for glGetProgramBinary
+    if (IsProgramCacheEnabled()) glProgramParameteri(m_shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    for (int i = 0; i < count; ++i)
+    {
+        glAttachShader(m_shaderProgram, m_pendingShaders[i]);
+    }
     glLinkProgram(m_shaderProgram);
-    glGetProgramiv(m_shaderProgram, GL_LINK_STATUS, &success);
-    if(!success) {
-        glGetProgramInfoLog(m_shaderProgram, 512, NULL, infoLog);
-        std::cerr << "Link Error:\n" << infoLog << std::endl;
+    m_compiling = true;
+    m_pendingMilliseconds = millisecondsSince(start);
+
+    if (!parallelCompileEnabled) return finishProgram();
+    return true;
+}
+
+bool Shader::readShaderFile(const char* path, std::string& source, std::vector<std::string>& files)
+{
+    std::string expanded;
+    if (!PreprocessShaderFile(path, expanded, files)) return false;
+    source = injectDefines(expanded, m_defines);
+    return true;
+}
+
+bool Shader::isProgramComplete() const
+{
+    if (!m_compiling || !IsParallelShaderCompileAvailable()) return true;
+    int complete = 0;
+    glGetProgramiv(m_shaderProgram, COMPLETION_STATUS_KHR, &complete);
+    return complete != 0;
+}
+
+bool Shader::finishProgram()
+{
+    if (!m_compiling) return m_initialized;
+    auto start = std::chrono::steady_clock::now();
+    m_compiling = false;
 
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+    // check if the compilation is successful
+    bool compiled = true;
+    for (int i = 0; i < m_pendingCount; ++i)
+    {
+        int success;
+        glGetShaderiv(m_pendingShaders[i], GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            unsigned int type = m_sourceTypes[i];
+            const char* stageName = type == GL_VERTEX_SHADER ? "VERTEX" : type == GL_GEOMETRY_SHADER ? "GEOMETRY" : type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "COMPUTE";
+            char infoLog[512];
+            glGetShaderInfoLog(m_pendingShaders[i], 512, NULL, infoLog);
+            std::cerr << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << m_sourcePaths[i] << "\n" << m_defines;
+            // the messages refer to the files by the number the #line directives of PreprocessShaderFile gave them
+            if (m_sourceFiles[i].size() > 1)
+            {
+                for (size_t file = 0; file < m_sourceFiles[i].size(); ++file) std::cerr << file << ": " << m_sourceFiles[i][file] << "\n";
+            }
+            std::cerr << infoLog << std::endl;
+            compiled = false;
+        }
+    }
+    // delete the shader objects once they are linked to the program object
+    deletePendingShaders();
+
+    int success = 0;
+    if (compiled)
+    {
+        glGetProgramiv(m_shaderProgram, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[512];
+            glGetProgramInfoLog(m_shaderProgram, 512, NULL, infoLog);
+            std::cerr << "Link Error:\n" << infoLog << std::endl;
+        }
+    }
+    if (!success)
+    {
         glDeleteProgram(m_shaderProgram);
+        m_shaderProgram = 0;
         return false;
     }
 
-    // delete the shader objects once they are linked to the program object
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    if (IsProgramCacheEnabled()) StoreCachedProgram(m_pendingKey, m_shaderProgram);
+    ProgramCacheStats& stats = GetProgramCacheStats();
+    ++stats.misses;
+    // the calling thread's time, the driver may have compiled on its own threads in between
+    stats.compileMilliseconds += m_pendingMilliseconds + millisecondsSince(start);
+    reflectUniforms();
+    m_initialized = true;
+    return true;
+}
+
+void Shader::deletePendingShaders()
+{
+    for (int i = 0; i < m_pendingCount; ++i)
+    {
+        glDeleteShader(m_pendingShaders[i]);
+        m_pendingShaders[i] = 0;
+    }
+    m_pendingCount = 0;
+}
+
+void Shader::reflectUniforms()
+{
+    m_uniforms.clear();
+    int uniformCount = 0;
+    int maxNameLength = 0;
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<char> name(std::max(maxNameLength, 1));
+    for (int i = 0; i < uniformCount; ++i)
+    {
+        int size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_shaderProgram, i, maxNameLength, nullptr, &size, &type, name.data());
+        // members of uniform blocks have no location and are left out
+        m_uniforms[name.data()].location = glGetUniformLocation(m_shaderProgram, name.data());
+    }
+}
+
+Shader::Uniform& Shader::findUniform(const char* name)
+{
+    auto uniform = m_uniforms.find(name);
+    if (uniform != m_uniforms.end()) return uniform->second;
+    // array elements past the first aren't listed by the reflection. Unknown names are kept too,
+    // with location -1, so setting a uniform the compiler removed doesn't query the driver every frame
+    Uniform& added = m_uniforms[name];
+    added.location = glGetUniformLocation(m_shaderProgram, name);
+    return added;
+}
+
+void Shader::setUniform(const char* name, unsigned int type, const void* value, size_t size)
+{
+    assert(m_initialized);
+    Uniform& uniform = findUniform(name);
+    uniform.type = type;
+    std::memcpy(uniform.value, value, size);
+    applyUniform(uniform);
+}
+
+void Shader::applyUniform(const Uniform& uniform)
+{
+    switch (uniform.type)
+    {
+        case GL_FLOAT: glUniform1f(uniform.location, uniform.value[0]); break;
+        case GL_INT:
+        case GL_BOOL:
+        {
+            int value;
+            std::memcpy(&value, uniform.value, sizeof(value));
+            glUniform1i(uniform.location, value);
+            break;
+        }
+        case GL_UNSIGNED_INT:
+        {
+            unsigned int value;
+            std::memcpy(&value, uniform.value, sizeof(value));
+            glUniform1ui(uniform.location, value);
+            break;
+        }
+        case GL_FLOAT_VEC2: glUniform2fv(uniform.location, 1, uniform.value); break;
+        case GL_FLOAT_VEC3: glUniform3fv(uniform.location, 1, uniform.value); break;
+        case GL_FLOAT_MAT3: glUniformMatrix3fv(uniform.location, 1, GL_FALSE, uniform.value); break;
+        case GL_FLOAT_MAT4: glUniformMatrix4fv(uniform.location, 1, GL_FALSE, uniform.value); break;
+    }
+}
+
+void Shader::beginReload()
+{
+    const char* paths[3];
+    for (int i = 0; i < m_sourceCount; ++i) paths[i] = m_sourcePaths[i].c_str();
+    // a shader of its own, so a failing compile leaves this one untouched. It isn't watched itself
+    m_reload = std::make_unique<Shader>();
+    m_reload->m_defines = m_defines;
+    m_reload->beginProgram(paths, m_sourceTypes, m_sourceCount);
+    // the edit may have added includes, they are watched from now on
+    for (int i = 0; i < m_sourceCount; ++i)
+    {
+        if (m_reload->m_sourceFiles[i].empty()) continue;
+        m_sourceFiles[i] = m_reload->m_sourceFiles[i];
+        if (fileWatcher) for (const std::string& file : m_sourceFiles[i]) fileWatcher->Watch(file);
+    }
+}
+
+bool Shader::finishReload()
+{
+    std::unique_ptr<Shader> reload = std::move(m_reload);
+    if (!reload || !reload->finishProgram()) return false;
+
+    int currentProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+    unsigned int previousProgram = m_shaderProgram;
+    // the reload shader takes the previous program along when it is destroyed
+    std::swap(m_shaderProgram, reload->m_shaderProgram);
+    reload->m_initialized = m_initialized;
+    m_initialized = true;
+
+    // uniform values belong to the program, the ones set once at initialization (sampler units) would be lost.
+    // The new program may have moved or removed uniforms, so the locations are looked up again
+    std::unordered_map<std::string, Uniform> values = std::move(m_uniforms);
+    m_uniforms = std::move(reload->m_uniforms);
+    glUseProgram(m_shaderProgram);
+    for (const auto& [name, value] : values)
+    {
+        if (value.type == 0) continue;
+        Uniform& uniform = findUniform(name.c_str());
+        uniform.type = value.type;
+        std::memcpy(uniform.value, value.value, sizeof(uniform.value));
+        applyUniform(uniform);
+    }
+    glUseProgram(static_cast<unsigned int>(currentProgram) == previousProgram ? m_shaderProgram : currentProgram);
     return true;
 }
 }
\ No newline at end of file
@@ -1,32 +1,138 @@
 #pragma once
 #include "cameras/camera.h"
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace shader
 {
 
+class Shader;
+
+// completion of a program started by Shader::InitializeAsync, in the manner of a std::future.
+// The Shader must outlive it
+class ShaderFuture
+{
+public:
+    ShaderFuture() = default;
+    explicit ShaderFuture(Shader* shader) : m_shader(shader) { }
+
+    inline bool IsValid() const { return m_shader != nullptr; }
+    // whether Get returns without waiting for the driver, never blocks. Only known with KHR_parallel_shader_compile,
+    // without it a started program always reports ready and Get may block
+    bool IsReady() const;
+    // waits for the compile and link and reports their errors, returns whether the program is usable
+    bool Get();
+
+private:
+    Shader* m_shader = nullptr;
+};
+
+// lets InitializeAsync return before the driver finished (default). Disabled, every program is
+// compiled and checked inside InitializeAsync, the way a serial startup behaves
+void SetParallelShaderCompile(bool enabled);
+// queries KHR_parallel_shader_compile and lets the driver choose how many threads it compiles on. Call it right
+// after the context is created, the thread count only applies to the compiles started afterwards
+void InitializeParallelShaderCompile();
+// whether the driver compiles on threads of its own and reports the completion (KHR_parallel_shader_compile),
+// needs a current context
+bool IsParallelShaderCompileAvailable();
+// gets every future, the programs the driver completed first before the others, so checking and caching them
+// overlaps with the driver still compiling the rest. Returns whether all of them are usable
+bool WaitForShaders(std::vector<ShaderFuture>& futures);
+
+// watches the files of every program initialized afterwards (off by default)
+void SetShaderHotReload(bool enabled);
+// call at a frame boundary: recompiles the programs whose files were written since the last call. A program is
+// swapped in only once it compiled and linked, with the uniform values set on the previous one; a failing edit
+// keeps the previous program running. Returns how many programs were swapped
+unsigned int ReloadChangedShaders();
+
 class Shader
 {
 public:
+    Shader() = default;
     ~Shader();
 
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
     bool Initialize(const char* vertexShaderPath, const char* fragmentShaderPath);
+    bool Initialize(const char* vertexShaderPath, const char* geometryShaderPath, const char* fragmentShaderPath);
+    // compiles every stage with the defines inserted after its #version line, e.g. { "HAS_NORMAL_MAP" }
+    bool Initialize(const char* vertexShaderPath, const char* fragmentShaderPath, const std::vector<std::string>& defines);
+    bool InitializeCompute(const char* computeShaderPath);
+
+    // the same as the Initialize overloads without waiting for the driver, the program can be used once the
+    // future's Get returned true. Initialize is InitializeAsync(...).Get()
+    ShaderFuture InitializeAsync(const char* vertexShaderPath, const char* fragmentShaderPath);
+    ShaderFuture InitializeAsync(const char* vertexShaderPath, const char* geometryShaderPath, const char* fragmentShaderPath);
+    ShaderFuture InitializeAsync(const char* vertexShaderPath, const char* fragmentShaderPath, const std::vector<std::string>& defines);
+    ShaderFuture InitializeComputeAsync(const char* computeShaderPath);
 
     void Use();
 
     void SetUniform(const char* name, float value);
     void SetUniform(const char* name, int value);
+    void SetUniform(const char* name, unsigned int value);
     void SetUniform(const char* name, bool value);
     void SetUniform(const char* name, glm::mat4 trans);
     void SetUniform(const char* name, glm::mat3 trans);
     void SetUniform(const char* name, glm::vec3 vec);
+    void SetUniform(const char* name, glm::vec2 vec);
 
 private:
-    bool prepareShader(const char* vertexShaderPath, const char* fragmentShaderPath);
+    friend class ShaderFuture;
+    friend unsigned int ReloadChangedShaders();
+
+    // location of a uniform and the value last set through SetUniform, so a reloaded program gets it again
+    struct Uniform
+    {
+        int location = -1;
+        unsigned int type = 0; // GL_FLOAT, GL_INT, GL_UNSIGNED_INT, GL_BOOL, GL_FLOAT_VEC2/3, GL_FLOAT_MAT3/4, 0 while unset
+        float value[16];
+    };
+
+    bool prepareShader(const char* vertexShaderPath, const char* geometryShaderPath, const char* fragmentShaderPath);
+    bool prepareComputeShader(const char* computeShaderPath);
+    // reads the stages, then creates the program from the program cache or starts compiling and linking it
+    bool beginProgram(const char* const* paths, const unsigned int* types, int count);
+    // the file with its includes expanded and the defines injected, files receives the files it is made of
+    bool readShaderFile(const char* path, std::string& source, std::vector<std::string>& files);
+    bool isProgramComplete() const;
+    // waits for the program started by beginProgram, checks it and stores it in the program cache
+    bool finishProgram();
+    void deletePendingShaders();
+    // rebuilds the uniform cache from the active uniforms of the program
+    void reflectUniforms();
+    Uniform& findUniform(const char* name);
+    void setUniform(const char* name, unsigned int type, const void* value, size_t size);
+    static void applyUniform(const Uniform& uniform);
+    // starts compiling the files again into m_reload, the current program stays in use
+    void beginReload();
+    // swaps in m_reload if it compiled and linked and sets the recorded uniform values on it
+    bool finishReload();
 
-    unsigned int m_shaderProgram;
-    unsigned int m_environmentMap;
-    bool m_initialized;
+    std::string m_defines; // #define lines injected into every stage
+    unsigned int m_shaderProgram = 0;
+    std::unordered_map<std::string, Uniform> m_uniforms;
+    // the files the program is built from, kept for reloading
+    int m_sourceCount = 0;
+    std::string m_sourcePaths[3];
+    unsigned int m_sourceTypes[3] = { 0, 0, 0 };
+    std::vector<std::string> m_sourceFiles[3]; // each stage's file and its includes, by the file number of its #line directives
+    bool m_watched = false;
+    std::unique_ptr<Shader> m_reload; // recompiled program between beginReload and finishReload
+    // stages of the program being compiled, until finishProgram
+    bool m_compiling = false;
+    int m_pendingCount = 0;
+    unsigned int m_pendingShaders[3] = { 0, 0, 0 };
+    uint64_t m_pendingKey = 0;
+    double m_pendingMilliseconds = 0.0; // spent in beginProgram
+    unsigned int m_environmentMap = 0;
+    bool m_initialized = false;
 };
 }
\ No newline at end of file
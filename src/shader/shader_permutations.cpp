@@ -0,0 +1,58 @@
+#include <iostream>
+#include "shader/shader_permutations.h"
+
+namespace shader
+{
+
+void ShaderPermutations::Initialize(const char* vertexShaderPath, const char* fragmentShaderPath, std::vector<const char*> featureDefines,
+    std::function<void(Shader&)> onCompiled)
+{
+    m_vertexShaderPath = vertexShaderPath;
+    m_fragmentShaderPath = fragmentShaderPath;
+    m_featureDefines = std::move(featureDefines);
+    m_onCompiled = std::move(onCompiled);
+    m_featureMask = 0;
+    for (size_t i = 0; i < m_featureDefines.size(); ++i)
+    {
+        if (m_featureDefines[i]) m_featureMask |= 1u << i;
+    }
+    m_programs.clear();
+}
+
+void ShaderPermutations::Prepare(unsigned int features)
+{
+    features &= m_featureMask;
+    if (m_programs.count(features)) return;
+
+    std::vector<std::string> defines;
+    for (size_t i = 0; i < m_featureDefines.size(); ++i)
+    {
+        if (features & (1u << i)) defines.push_back(m_featureDefines[i]);
+    }
+    Permutation& permutation = m_programs[features];
+    permutation.shader = std::make_unique<Shader>();
+    permutation.compiled = permutation.shader->InitializeAsync(m_vertexShaderPath.c_str(), m_fragmentShaderPath.c_str(), defines);
+}
+
+Shader* ShaderPermutations::Get(unsigned int features)
+{
+    features &= m_featureMask;
+    Prepare(features);
+    Permutation& permutation = m_programs[features];
+    if (!permutation.finished)
+    {
+        permutation.finished = true;
+        if (!permutation.compiled.Get())
+        {
+            std::cerr << "Error: Fail to compile the permutation " << features << " of " << m_fragmentShaderPath << std::endl;
+            permutation.shader.reset();
+        }
+        else if (m_onCompiled)
+        {
+            permutation.shader->Use();
+            m_onCompiled(*permutation.shader);
+        }
+    }
+    return permutation.shader.get();
+}
+} // namespace shader
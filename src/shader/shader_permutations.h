@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "shader/shader.h"
+
+namespace shader
+{
+
+// programs compiled from one vertex / fragment shader pair, one per feature bitmask.
+// Bit i of a bitmask injects featureDefines[i], bits without a define are ignored so meshes only
+// differing by them share a program. The programs are compiled on first use, or ahead through Prepare, and cached.
+class ShaderPermutations
+{
+public:
+    // onCompiled is called with every new program in use, to set the uniforms that never change (sampler units)
+    void Initialize(const char* vertexShaderPath, const char* fragmentShaderPath, std::vector<const char*> featureDefines,
+        std::function<void(Shader&)> onCompiled = nullptr);
+
+    // starts compiling the program for the features without waiting for it
+    void Prepare(unsigned int features);
+    // the program for the features, null when it failed to compile
+    Shader* Get(unsigned int features);
+
+    // the bits Get tells apart
+    inline unsigned int GetFeatureMask() const { return m_featureMask; }
+    inline size_t GetProgramCount() const { return m_programs.size(); }
+
+private:
+    std::string m_vertexShaderPath;
+    std::string m_fragmentShaderPath;
+    std::vector<const char*> m_featureDefines;
+    unsigned int m_featureMask = 0;
+    std::function<void(Shader&)> m_onCompiled;
+
+    struct Permutation
+    {
+        std::unique_ptr<Shader> shader; // null once it failed, so it is not compiled again every frame
+        ShaderFuture compiled;
+        bool finished = false;
+    };
+    std::unordered_map<unsigned int, Permutation> m_programs;
+};
+} // namespace shader
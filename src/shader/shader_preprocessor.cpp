@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include "shader/shader_preprocessor.h"
+
+namespace shader
+{
+
+namespace
+{
+// a file cut at its #include lines
+struct ParsedFile
+{
+    struct Piece
+    {
+        std::string text;    // the lines up to the next #include, or to the end of the file
+        std::string include; // resolved path of that #include, empty for the last piece
+        int nextLine = 0;    // line of the including file after the #include
+    };
+    std::vector<Piece> pieces;
+    bool once = false;
+};
+
+// references stay valid while the map grows, expand holds on to them across nested parses
+std::unordered_map<std::string, ParsedFile> parsedFiles;
+
+// name of the directive of a preprocessor line ("include" for '  #  include "x"'), empty for any other line.
+// end is set past the name
+std::string directiveOf(const std::string& line, size_t& end)
+{
+    size_t hash = line.find_first_not_of(" \t");
+    if (hash == std::string::npos || line[hash] != '#') return "";
+    size_t begin = line.find_first_not_of(" \t", hash + 1);
+    if (begin == std::string::npos) return "";
+    end = begin;
+    while (end < line.size() && std::isalpha(static_cast<unsigned char>(line[end]))) ++end;
+    return line.substr(begin, end - begin);
+}
+
+const ParsedFile* parseFile(const std::string& path)
+{
+    auto cached = parsedFiles.find(path);
+    if (cached != parsedFiles.end()) return &cached->second;
+
+    std::ifstream input(path, std::ios::in);
+    if (!input.is_open())
+    {
+        std::cerr << "Error: Fail to open shader file " << path << std::endl;
+        return nullptr;
+    }
+    ParsedFile file;
+    ParsedFile::Piece piece;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(input, line))
+    {
+        ++lineNumber;
+        size_t end = 0;
+        std::string directive = directiveOf(line, end);
+        if (directive == "include")
+        {
+            size_t open = line.find('"', end);
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            if (close == std::string::npos)
+            {
+                std::cerr << "Error: expected #include \"path\" at " << path << ":" << lineNumber << std::endl;
+                return nullptr;
+            }
+            std::filesystem::path included = std::filesystem::path(path).parent_path() / line.substr(open + 1, close - open - 1);
+            piece.include = included.lexically_normal().generic_string();
+            piece.nextLine = lineNumber + 1;
+            file.pieces.push_back(std::move(piece));
+            piece = ParsedFile::Piece();
+        }
+        else if (directive == "pragma" && line.find("once", end) != std::string::npos)
+        {
+            file.once = true;
+            piece.text += '\n'; // keeps the line count
+        }
+        else
+        {
+            piece.text += line;
+            piece.text += '\n';
+        }
+    }
+    file.pieces.push_back(std::move(piece));
+    return &(parsedFiles[path] = std::move(file));
+}
+
+bool expand(const std::string& path, std::string& source, std::vector<std::string>& files, std::vector<std::string>& includeStack)
+{
+    if (std::find(includeStack.begin(), includeStack.end(), path) != includeStack.end())
+    {
+        std::cerr << "Error: " << path << " includes itself through " << includeStack.back() << std::endl;
+        return false;
+    }
+    const ParsedFile* file = parseFile(path);
+    if (!file)
+    {
+        files.push_back(path); // still reported, the caller may watch it for a fix
+        return false;
+    }
+
+    auto seen = std::find(files.begin(), files.end(), path);
+    if (seen != files.end() && file->once) return true;
+    size_t number = seen - files.begin();
+    if (seen == files.end()) files.push_back(path);
+    // the first file starts with #version, nothing may come before it
+    if (number > 0) source += "#line 1 " + std::to_string(number) + "\n";
+
+    includeStack.push_back(path);
+    for (const ParsedFile::Piece& piece : file->pieces)
+    {
+        source += piece.text;
+        if (piece.include.empty()) continue;
+        if (!expand(piece.include, source, files, includeStack)) return false;
+        source += "#line " + std::to_string(piece.nextLine) + " " + std::to_string(number) + "\n";
+    }
+    includeStack.pop_back();
+    return true;
+}
+} // namespace
+
+bool PreprocessShaderFile(const std::string& path, std::string& source, std::vector<std::string>& files)
+{
+    source.clear();
+    files.clear();
+    std::vector<std::string> includeStack;
+    return expand(path, source, files, includeStack);
+}
+
+void InvalidateShaderFile(const std::string& path)
+{
+    parsedFiles.erase(path);
+}
+} // namespace shader
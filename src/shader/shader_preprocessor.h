@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace shader
+{
+
+// reads a shader file and expands its #include "path" directives, the path relative to the including file.
+// A file with #pragma once is expanded once per stage. #include is expanded wherever it stands, #if blocks around it
+// don't hide it. The whole stage comes back as one concatenated string: each file is numbered by its position in
+// files, and the "#line N number" directives written around every include make the compiler report "number(line)"
+// of the right file. Returns false when a file can't be read or includes itself, files then ends with the file
+// that failed.
+// The files are parsed once per process and kept, the permutations of a shader and the shaders sharing a module
+// only concatenate the parsed pieces
+bool PreprocessShaderFile(const std::string& path, std::string& source, std::vector<std::string>& files);
+// forgets the parsed file, the next PreprocessShaderFile reads it again
+void InvalidateShaderFile(const std::string& path);
+} // namespace shader
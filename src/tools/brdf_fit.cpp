@@ -0,0 +1,195 @@
+// Fits the split-sum scale and bias of the BRDF LUT with the polynomial the lighting shaders evaluate
+// for EnvironmentBRDF::Polynomial and reports how far both analytic paths are from the LUT.
+// The LUT is either a dump of the baked texture (glPBR --dump-brdf-lut) or integrated here on the
+// CPU exactly like brdf.frag does it. The fitted coefficients are printed as the GLSL array to paste
+// into shader/common/environment.glsl.
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ibl/environment_brdf.h"
+
+namespace
+{
+
+struct Lut
+{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<glm::vec2> texels;
+
+    // texel centers, like the texture lookups at the LUT resolution
+    float NdotV(unsigned int x) const { return (x + 0.5f) / width; }
+    float roughness(unsigned int y) const { return (y + 0.5f) / height; }
+};
+
+struct FitError
+{
+    glm::vec2 maxError = glm::vec2(0.0f);
+    glm::vec2 rmse = glm::vec2(0.0f);
+    float maxGrazingFree = 0.0f;  // max error of either channel with NdotV >= 0.1, away from silhouettes
+    float maxSpecular[2] = { 0.0f, 0.0f }; // max error of F0 * scale + bias for F0 0.04 and 1
+};
+
+unsigned int termIndex(unsigned int i, unsigned int j)
+{
+    return i * (ibl::kPolynomialDegree + 1) + j;
+}
+
+// least squares through the normal equations, one solve per channel
+std::vector<glm::vec2> fitPolynomial(const Lut& lut)
+{
+    const unsigned int n = ibl::kPolynomialTermCount;
+    std::vector<double> normal(n * n, 0.0);
+    std::vector<double> rhs[2] = { std::vector<double>(n, 0.0), std::vector<double>(n, 0.0) };
+    std::vector<double> basis(n);
+    for (unsigned int y = 0; y < lut.height; ++y)
+    {
+        for (unsigned int x = 0; x < lut.width; ++x)
+        {
+            double s = std::sqrt(lut.NdotV(x));
+            double r = lut.roughness(y);
+            for (unsigned int i = 0; i <= ibl::kPolynomialDegree; ++i)
+            {
+                for (unsigned int j = 0; j <= ibl::kPolynomialDegree; ++j) basis[termIndex(i, j)] = std::pow(s, i) * std::pow(r, j);
+            }
+            const glm::vec2& texel = lut.texels[y * lut.width + x];
+            for (unsigned int p = 0; p < n; ++p)
+            {
+                rhs[0][p] += basis[p] * texel.x;
+                rhs[1][p] += basis[p] * texel.y;
+                for (unsigned int q = 0; q < n; ++q) normal[p * n + q] += basis[p] * basis[q];
+            }
+        }
+    }
+
+    // Gauss-Jordan with partial pivoting, both right hand sides at once
+    for (unsigned int column = 0; column < n; ++column)
+    {
+        unsigned int pivot = column;
+        for (unsigned int row = column + 1; row < n; ++row)
+        {
+            if (std::fabs(normal[row * n + column]) > std::fabs(normal[pivot * n + column])) pivot = row;
+        }
+        for (unsigned int q = 0; q < n; ++q) std::swap(normal[column * n + q], normal[pivot * n + q]);
+        std::swap(rhs[0][column], rhs[0][pivot]);
+        std::swap(rhs[1][column], rhs[1][pivot]);
+        for (unsigned int row = 0; row < n; ++row)
+        {
+            if (row == column) continue;
+            double factor = normal[row * n + column] / normal[column * n + column];
+            for (unsigned int q = 0; q < n; ++q) normal[row * n + q] -= factor * normal[column * n + q];
+            rhs[0][row] -= factor * rhs[0][column];
+            rhs[1][row] -= factor * rhs[1][column];
+        }
+    }
+    std::vector<glm::vec2> coefficients(n);
+    for (unsigned int p = 0; p < n; ++p)
+    {
+        coefficients[p] = glm::vec2(static_cast<float>(rhs[0][p] / normal[p * n + p]), static_cast<float>(rhs[1][p] / normal[p * n + p]));
+    }
+    return coefficients;
+}
+
+template <typename Approximation>
+FitError measure(const Lut& lut, Approximation approximation)
+{
+    FitError error;
+    double squared[2] = { 0.0, 0.0 };
+    for (unsigned int y = 0; y < lut.height; ++y)
+    {
+        for (unsigned int x = 0; x < lut.width; ++x)
+        {
+            glm::vec2 expected = lut.texels[y * lut.width + x];
+            glm::vec2 value = approximation(lut.NdotV(x), lut.roughness(y));
+            float scaleError = std::fabs(value.x - expected.x);
+            float biasError = std::fabs(value.y - expected.y);
+            error.maxError.x = std::max(error.maxError.x, scaleError);
+            error.maxError.y = std::max(error.maxError.y, biasError);
+            squared[0] += scaleError * scaleError;
+            squared[1] += biasError * biasError;
+            if (lut.NdotV(x) >= 0.1f) error.maxGrazingFree = std::max(error.maxGrazingFree, std::max(scaleError, biasError));
+            const float F0s[2] = { 0.04f, 1.0f };
+            for (int f = 0; f < 2; ++f)
+            {
+                float specularError = std::fabs(F0s[f] * (value.x - expected.x) + (value.y - expected.y));
+                error.maxSpecular[f] = std::max(error.maxSpecular[f], specularError);
+            }
+        }
+    }
+    double count = static_cast<double>(lut.width) * lut.height;
+    error.rmse = glm::vec2(static_cast<float>(std::sqrt(squared[0] / count)), static_cast<float>(std::sqrt(squared[1] / count)));
+    return error;
+}
+
+void printError(const char* name, const FitError& error)
+{
+    std::cout << name << ", " << error.maxError.x << ", " << error.rmse.x << ", " << error.maxError.y << ", " << error.rmse.y
+        << ", " << error.maxGrazingFree << ", " << error.maxSpecular[0] << ", " << error.maxSpecular[1] << std::endl;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* lutPath = nullptr;
+    unsigned int resolution = 128;
+    unsigned int sampleCount = 1024;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--lut") == 0 && i + 1 < argc) lutPath = argv[++i];
+        else if (std::strcmp(argv[i], "--resolution") == 0 && i + 1 < argc) resolution = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) sampleCount = std::atoi(argv[++i]);
+        else std::cerr << "Warning: unknown argument " << argv[i] << std::endl;
+    }
+
+    Lut lut;
+    if (lutPath)
+    {
+        if (!ibl::ReadBRDFLUT(lutPath, lut.width, lut.height, lut.texels))
+        {
+            std::cerr << "Failed to read BRDF LUT " << lutPath << std::endl;
+            return 1;
+        }
+        std::cout << "LUT " << lutPath << ", " << lut.width << "x" << lut.height << std::endl;
+    }
+    else
+    {
+        lut.width = lut.height = resolution;
+        lut.texels.resize(static_cast<size_t>(resolution) * resolution);
+        for (unsigned int y = 0; y < resolution; ++y)
+        {
+            for (unsigned int x = 0; x < resolution; ++x) lut.texels[y * resolution + x] = ibl::IntegrateEnvironmentBRDF(lut.NdotV(x), lut.roughness(y), sampleCount);
+        }
+        std::cout << "LUT integrated on the CPU, " << resolution << "x" << resolution << ", " << sampleCount << " samples" << std::endl;
+    }
+
+    std::vector<glm::vec2> coefficients = fitPolynomial(lut);
+    std::cout << "method, scale max error, scale rmse, bias max error, bias rmse, max error NdotV >= 0.1, specular max error F0 0.04, F0 1" << std::endl;
+    printError("karis", measure(lut, ibl::KarisEnvironmentBRDF));
+    printError("polynomial", measure(lut, [&coefficients](float NdotV, float roughness)
+    {
+        return ibl::EvaluatePolynomialEnvironmentBRDF(coefficients.data(), NdotV, roughness);
+    }));
+
+    std::cout << std::endl << "// (scale, bias) of sqrt(NdotV)^i * roughness^j at [i * " << ibl::kPolynomialDegree + 1 << " + j]" << std::endl;
+    std::cout << "const vec2 ENVIRONMENT_BRDF_FIT[" << ibl::kPolynomialTermCount << "] = vec2[](" << std::endl;
+    std::cout << std::setprecision(7);
+    for (unsigned int i = 0; i <= ibl::kPolynomialDegree; ++i)
+    {
+        std::cout << "   ";
+        for (unsigned int j = 0; j <= ibl::kPolynomialDegree; ++j)
+        {
+            const glm::vec2& c = coefficients[termIndex(i, j)];
+            bool last = i == ibl::kPolynomialDegree && j == ibl::kPolynomialDegree;
+            std::cout << " vec2(" << c.x << ", " << c.y << ")" << (last ? "" : ",");
+        }
+        std::cout << std::endl;
+    }
+    std::cout << ");" << std::endl;
+    return 0;
+}
@@ -0,0 +1,481 @@
+// Microbenchmarks of the loading and baking paths: the phases of Model::Load, the vertex transform of
+// processMesh, texture and HDR decoding, the CPU side of the IBL bakes and setting Shader uniforms.
+// Every input is generated at 1x, 10x and 100x (--scales) of a base size, so the results show how a path
+// scales as well as what it costs. --json writes them in Google Benchmark's JSON layout for tracking across
+// releases. The benchmarks that need GL run on a headless context, OSMesa unless --context says otherwise.
+// Runs from the build directory like glPBR, the uniform benchmark compiles ../shader/pbr.*
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include "object3ds/model.h"
+#include "shader/shader.h"
+#include "ibl/prefilter_samples.h"
+#include "ibl/environment_brdf.h"
+#include "platform/gl_context.h"
+#include "utility/image_writer.h"
+#include "utility/resources.h"
+#include "utility/stb_image.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// keeps results alive so the optimizer can't drop the work producing them
+volatile float g_sink = 0.0f;
+
+// the work of one iteration, prepared for a scale
+struct Workload
+{
+    std::function<void()> run;
+    size_t items = 0; // processed per iteration, for items/sec
+};
+
+struct Benchmark
+{
+    const char* name;
+    const char* items; // what an item is
+    bool needsGL;
+    std::function<Workload(unsigned int scale)> prepare;
+};
+
+struct Result
+{
+    std::string name; // benchmark/scale
+    unsigned int scale = 1;
+    size_t iterations = 0;
+    double meanMilliseconds = 0.0;
+    double medianMilliseconds = 0.0;
+    double minMilliseconds = 0.0;
+    double stddevMilliseconds = 0.0;
+    double cpuMilliseconds = 0.0; // process CPU time per iteration, above the wall time when threads help
+    double itemsPerSecond = 0.0;
+};
+
+std::filesystem::path g_inputDirectory;
+
+std::string inputPath(const std::string& name)
+{
+    return (g_inputDirectory / name).string();
+}
+
+// a grid of side * side quads in the xz plane with normals and texture coordinates, as an OBJ file
+std::string writeGridOBJ(unsigned int side)
+{
+    std::string path = inputPath("grid_" + std::to_string(side) + ".obj");
+    if (std::filesystem::exists(path)) return path;
+    std::ofstream file(path);
+    for (unsigned int z = 0; z <= side; ++z)
+    {
+        for (unsigned int x = 0; x <= side; ++x)
+        {
+            float u = static_cast<float>(x) / side;
+            float v = static_cast<float>(z) / side;
+            file << "v " << u - 0.5f << " " << 0.05f * std::sin(20.0f * u) * std::cos(20.0f * v) << " " << v - 0.5f << "\n";
+            file << "vn 0 1 0\nvt " << u << " " << v << "\n";
+        }
+    }
+    for (unsigned int z = 0; z < side; ++z)
+    {
+        for (unsigned int x = 0; x < side; ++x)
+        {
+            unsigned int a = z * (side + 1) + x + 1; // OBJ indices start at 1
+            unsigned int b = a + 1;
+            unsigned int c = a + side + 1;
+            unsigned int d = c + 1;
+            file << "f " << a << "/" << a << "/" << a << " " << c << "/" << c << "/" << c << " " << d << "/" << d << "/" << d << " " << b << "/" << b << "/" << b << "\n";
+        }
+    }
+    return path;
+}
+
+// gradients with some noise, so neither deflate nor RLE see only runs
+float pattern(int x, int y, int channel)
+{
+    unsigned int hash = static_cast<unsigned int>(x) * 73856093u ^ static_cast<unsigned int>(y) * 19349663u ^ static_cast<unsigned int>(channel) * 83492791u;
+    return 0.5f + 0.4f * std::sin(0.05f * x + channel) * std::cos(0.03f * y) + 0.1f * ((hash % 1000) / 1000.0f - 0.5f);
+}
+
+std::string writeTexturePNG(int width, int height)
+{
+    std::string path = inputPath("texture_" + std::to_string(width) + "x" + std::to_string(height) + ".png");
+    if (std::filesystem::exists(path)) return path;
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            for (int c = 0; c < 4; ++c) pixels[(static_cast<size_t>(y) * width + x) * 4 + c] = static_cast<unsigned char>(std::clamp(pattern(x, y, c), 0.0f, 1.0f) * 255.0f);
+        }
+    }
+    utility::WritePNG(path, width, height, 4, pixels.data());
+    return path;
+}
+
+// Radiance RGBE with the run length encoded scanlines HDR environments usually come with
+std::string writeEnvironmentHDR(int width, int height)
+{
+    std::string path = inputPath("environment_" + std::to_string(width) + "x" + std::to_string(height) + ".hdr");
+    if (std::filesystem::exists(path)) return path;
+    std::ofstream file(path, std::ios::binary);
+    file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " << height << " +X " << width << "\n";
+    std::vector<unsigned char> scanline(static_cast<size_t>(width) * 4);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            // a bright band near the top like a sky, otherwise the pattern
+            float rgb[3];
+            for (int c = 0; c < 3; ++c) rgb[c] = pattern(x, y, c) * (y < height / 8 ? 20.0f : 1.0f);
+            float largest = std::max(rgb[0], std::max(rgb[1], rgb[2]));
+            int exponent;
+            float mantissa = std::frexp(largest, &exponent) * 256.0f / largest;
+            for (int c = 0; c < 3; ++c) scanline[c * width + x] = static_cast<unsigned char>(rgb[c] * mantissa);
+            scanline[3 * width + x] = static_cast<unsigned char>(exponent + 128);
+        }
+        file.put(2).put(2).put(static_cast<char>(width >> 8)).put(static_cast<char>(width & 0xFF));
+        // each component separately: runs of 3 or more equal bytes, literal dumps in between
+        for (int c = 0; c < 4; ++c)
+        {
+            const unsigned char* bytes = scanline.data() + c * width;
+            int x = 0;
+            while (x < width)
+            {
+                int run = 1;
+                while (x + run < width && run < 127 && bytes[x + run] == bytes[x]) ++run;
+                if (run >= 3)
+                {
+                    file.put(static_cast<char>(128 + run)).put(static_cast<char>(bytes[x]));
+                    x += run;
+                    continue;
+                }
+                int dump = 1;
+                while (x + dump < width && dump < 128 && !(x + dump + 2 < width && bytes[x + dump] == bytes[x + dump + 1] && bytes[x + dump] == bytes[x + dump + 2])) ++dump;
+                file.put(static_cast<char>(dump));
+                file.write(reinterpret_cast<const char*>(bytes + x), dump);
+                x += dump;
+            }
+        }
+    }
+    return path;
+}
+
+// the square side that makes an area of baseSide^2 scale times larger
+unsigned int scaledSide(unsigned int baseSide, unsigned int scale)
+{
+    return static_cast<unsigned int>(std::lround(baseSide * std::sqrt(static_cast<double>(scale))));
+}
+
+std::vector<Benchmark> makeBenchmarks()
+{
+    std::vector<Benchmark> benchmarks;
+
+    // Model::Load phases on a grid of 2,601 vertices at 1x
+    benchmarks.push_back({ "model_load/assimp_import", "vertices", false, [](unsigned int scale)
+    {
+        unsigned int side = scaledSide(50, scale);
+        std::string path = writeGridOBJ(side);
+        Workload workload;
+        workload.items = static_cast<size_t>(side + 1) * (side + 1);
+        workload.run = [path]()
+        {
+            Assimp::Importer importer;
+            const aiScene* scene = importer.ReadFile(path.c_str(), aiProcess_Triangulate | aiProcess_FlipUVs);
+            g_sink = g_sink + (scene ? scene->mNumMeshes : 0);
+        };
+        return workload;
+    } });
+    benchmarks.push_back({ "model_load/process_mesh", "vertices", false, [](unsigned int scale)
+    {
+        // the transform processMesh runs on every vertex, on a mesh already imported
+        unsigned int side = scaledSide(50, scale);
+        auto importer = std::make_shared<Assimp::Importer>();
+        const aiScene* scene = importer->ReadFile(writeGridOBJ(side).c_str(), aiProcess_Triangulate | aiProcess_FlipUVs);
+        Workload workload;
+        if (!scene || scene->mNumMeshes == 0) return workload;
+        const aiMesh* mesh = scene->mMeshes[0];
+        workload.items = mesh->mNumVertices;
+        glm::mat4 transform = glm::mat4(1.0f);
+        transform[3] = glm::vec4(1.0f, 2.0f, 3.0f, 1.0f);
+        transform[0][0] = 2.0f;
+        workload.run = [importer, mesh, transform]()
+        {
+            std::vector<object3ds::Vertex> vertices;
+            glm::vec3 boundsMin(std::numeric_limits<float>::max());
+            glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+            object3ds::TransformVertices(*mesh, transform, vertices, boundsMin, boundsMax);
+            g_sink = g_sink + boundsMax.x;
+        };
+        return workload;
+    } });
+    benchmarks.push_back({ "model_load/full", "vertices", true, [](unsigned int scale)
+    {
+        // import, processMesh and the vertex and index buffer uploads
+        unsigned int side = scaledSide(50, scale);
+        std::string path = writeGridOBJ(side);
+        Workload workload;
+        workload.items = static_cast<size_t>(side + 1) * (side + 1);
+        workload.run = [path]()
+        {
+            object3ds::Model model;
+            model.Load(path.c_str());
+            glFinish();
+            g_sink = g_sink + model.GetBoundsMax().x;
+        };
+        return workload;
+    } });
+
+    // decoding a 256x256 RGBA PNG at 1x, the way Model's TextureFromFile loads it
+    benchmarks.push_back({ "texture_decode/png", "pixels", false, [](unsigned int scale)
+    {
+        unsigned int side = scaledSide(256, scale);
+        std::string path = writeTexturePNG(side, side);
+        Workload workload;
+        workload.items = static_cast<size_t>(side) * side;
+        workload.run = [path]()
+        {
+            int width, height, channels;
+            unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+            if (data) g_sink = g_sink + data[0];
+            stbi_image_free(data);
+        };
+        return workload;
+    } });
+
+    // decoding a 256x128 RLE HDR at 1x, the way precompute and the EnvironmentBaker load it
+    benchmarks.push_back({ "hdr_decode", "pixels", false, [](unsigned int scale)
+    {
+        unsigned int width = scaledSide(256, scale);
+        std::string path = writeEnvironmentHDR(width, width / 2);
+        Workload workload;
+        workload.items = static_cast<size_t>(width) * (width / 2);
+        workload.run = [path]()
+        {
+            int width, height, channels;
+            float* data = stbi_loadf(path.c_str(), &width, &height, &channels, 0);
+            if (data) g_sink = g_sink + data[0];
+            stbi_image_free(data);
+        };
+        return workload;
+    } });
+
+    // the CPU halves of the IBL bakes: the prefilter sample sets precompute uploads, 64 samples per mip at 1x,
+    // and the split-sum BRDF integration the brdf_fit tool runs, a 16x16 LUT of 64 samples at 1x
+    benchmarks.push_back({ "ibl_bake/prefilter_samples", "samples", false, [](unsigned int scale)
+    {
+        const unsigned int mipLevels = 5;
+        unsigned int sampleCount = 64 * scale;
+        Workload workload;
+        workload.items = static_cast<size_t>(mipLevels) * sampleCount;
+        workload.run = [sampleCount]()
+        {
+            ibl::PrefilterSampleSet set = ibl::GeneratePrefilterSamples(mipLevels, sampleCount, 512);
+            g_sink = g_sink + set.weightSums.back();
+        };
+        return workload;
+    } });
+    benchmarks.push_back({ "ibl_bake/brdf_lut", "samples", false, [](unsigned int scale)
+    {
+        unsigned int side = scaledSide(16, scale);
+        const unsigned int sampleCount = 64;
+        Workload workload;
+        workload.items = static_cast<size_t>(side) * side * sampleCount;
+        workload.run = [side]()
+        {
+            glm::vec2 sum(0.0f);
+            for (unsigned int y = 0; y < side; ++y)
+            {
+                for (unsigned int x = 0; x < side; ++x) sum += ibl::IntegrateEnvironmentBRDF((x + 0.5f) / side, (y + 0.5f) / side, sampleCount);
+            }
+            g_sink = g_sink + sum.x;
+        };
+        return workload;
+    } });
+
+    // the per draw uniforms of the PBR program, 1,000 draws at 1x
+    benchmarks.push_back({ "shader/set_uniforms", "uniforms", true, [](unsigned int scale)
+    {
+        auto shader = std::make_shared<shader::Shader>();
+        Workload workload;
+        if (!shader->Initialize(utility::ResourcePath("shader/pbr.vert").c_str(), utility::ResourcePath("shader/pbr.frag").c_str())) return workload;
+        unsigned int draws = 1000 * scale;
+        workload.items = static_cast<size_t>(draws) * 5;
+        workload.run = [shader, draws]()
+        {
+            shader->Use();
+            glm::mat4 model(1.0f);
+            for (unsigned int i = 0; i < draws; ++i)
+            {
+                model[3].x = static_cast<float>(i);
+                shader->SetUniform("model", model);
+                shader->SetUniform("view", glm::mat4(1.0f));
+                shader->SetUniform("projection", glm::mat4(1.0f));
+                shader->SetUniform("normalMatrix", glm::mat3(model));
+                shader->SetUniform("camPos", glm::vec3(0.0f, 0.0f, 3.0f));
+            }
+            glFinish();
+        };
+        return workload;
+    } });
+    return benchmarks;
+}
+
+Result measure(const std::string& name, unsigned int scale, const Workload& workload, double minSeconds)
+{
+    const size_t minIterations = 3;
+    const size_t maxIterations = 10000;
+    workload.run(); // warm up caches, the file system and the driver
+
+    std::vector<double> times;
+    double total = 0.0;
+    std::clock_t cpuStart = std::clock();
+    while ((total < minSeconds * 1000.0 || times.size() < minIterations) && times.size() < maxIterations)
+    {
+        Clock::time_point start = Clock::now();
+        workload.run();
+        double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        times.push_back(milliseconds);
+        total += milliseconds;
+    }
+    double cpuMilliseconds = 1000.0 * (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    Result result;
+    result.name = name + "/" + std::to_string(scale) + "x";
+    result.scale = scale;
+    result.iterations = times.size();
+    result.meanMilliseconds = total / times.size();
+    result.cpuMilliseconds = cpuMilliseconds / times.size();
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    result.minMilliseconds = sorted.front();
+    result.medianMilliseconds = sorted[sorted.size() / 2];
+    double variance = 0.0;
+    for (double time : times) variance += (time - result.meanMilliseconds) * (time - result.meanMilliseconds);
+    result.stddevMilliseconds = std::sqrt(variance / times.size());
+    result.itemsPerSecond = workload.items / (result.medianMilliseconds / 1000.0);
+    return result;
+}
+
+// the layout of Google Benchmark's --benchmark_out, so its compare.py and dashboards read it
+bool writeJSON(const char* path, const std::vector<Result>& results, const char* context, const std::string& renderer)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: can't write " << path << std::endl;
+        return false;
+    }
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    file << "{\n  \"context\": {\n    \"date\": \"" << date << "\",\n    \"executable\": \"glPBR_bench\",\n    \"num_cpus\": " << std::thread::hardware_concurrency()
+        << ",\n    \"gl_context\": \"" << context << "\",\n    \"gl_renderer\": \"" << renderer << "\",\n"
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\"\n  },\n"
+#else
+        << "    \"library_build_type\": \"debug\"\n  },\n"
+#endif
+        << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& result = results[i];
+        file << "    {\n      \"name\": \"" << result.name << "\",\n      \"run_name\": \"" << result.name << "\",\n      \"run_type\": \"iteration\",\n"
+            << "      \"iterations\": " << result.iterations << ",\n      \"real_time\": " << result.medianMilliseconds << ",\n      \"cpu_time\": " << result.cpuMilliseconds << ",\n"
+            << "      \"time_unit\": \"ms\",\n      \"items_per_second\": " << result.itemsPerSecond << ",\n      \"scale\": " << result.scale << ",\n"
+            << "      \"mean_ms\": " << result.meanMilliseconds << ",\n      \"min_ms\": " << result.minMilliseconds << ",\n      \"stddev_ms\": " << result.stddevMilliseconds << "\n    }"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<unsigned int> scales = { 1, 10, 100 };
+    double minSeconds = 0.5;
+    const char* filter = nullptr;
+    const char* jsonPath = nullptr;
+    platform::ContextBackend contextBackend = platform::ContextBackend::OSMesa;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--scales") == 0 && i + 1 < argc)
+        {
+            // "1,10,100"
+            scales.clear();
+            for (const char* scale = argv[++i]; *scale; )
+            {
+                char* end;
+                unsigned long value = std::strtoul(scale, &end, 10);
+                if (end == scale) break;
+                if (value > 0) scales.push_back(static_cast<unsigned int>(value));
+                scale = *end == ',' ? end + 1 : end;
+            }
+        }
+        else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) minSeconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--context") == 0 && i + 1 < argc)
+        {
+            if (!platform::ParseContextBackend(argv[++i], contextBackend)) std::cerr << "Warning: unknown context " << argv[i] << ", expected window, osmesa or egl" << std::endl;
+        }
+        else
+        {
+            std::cerr << "usage: glPBR_bench [--scales 1,10,100] [--min-time seconds] [--filter substring] [--json path] [--context window|osmesa|egl]" << std::endl;
+            return 1;
+        }
+    }
+
+    // the GL benchmarks need a current context, the others run without one as well
+    GLFWwindow* window = platform::CreateContext(contextBackend, 64, 64, "glPBR_bench");
+    if (!window) std::cerr << "Warning: no GL context, skipping the GL benchmarks" << std::endl;
+    else shader::InitializeParallelShaderCompile();
+    // glad is only loaded with a context, without one there is nothing to ask
+    std::string renderer = "none";
+    if (window && glGetString(GL_RENDERER)) renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+
+    g_inputDirectory = std::filesystem::temp_directory_path() / "glpbr_bench";
+    std::filesystem::create_directories(g_inputDirectory);
+
+    std::vector<Result> results;
+    std::cout << "benchmark, iterations, median ms, min ms, mean ms, stddev ms, items/s" << std::endl;
+    for (const Benchmark& benchmark : makeBenchmarks())
+    {
+        if (filter && !std::strstr(benchmark.name, filter)) continue;
+        if (benchmark.needsGL && !window) continue;
+        for (unsigned int scale : scales)
+        {
+            Workload workload = benchmark.prepare(scale);
+            if (!workload.run)
+            {
+                std::cerr << "Warning: " << benchmark.name << " could not prepare its input" << std::endl;
+                break;
+            }
+            Result result = measure(benchmark.name, scale, workload, minSeconds);
+            std::cout << result.name << ", " << result.iterations << ", " << result.medianMilliseconds << ", " << result.minMilliseconds << ", " << result.meanMilliseconds
+                << ", " << result.stddevMilliseconds << ", " << result.itemsPerSecond << " " << benchmark.items << std::endl;
+            results.push_back(result);
+        }
+    }
+
+    bool written = !jsonPath || writeJSON(jsonPath, results, window ? platform::GetContextBackendName(contextBackend) : "none", renderer);
+    if (window) glfwTerminate();
+    return written ? 0 : 1;
+}
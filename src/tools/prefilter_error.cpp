@@ -0,0 +1,361 @@
+// Measures the error of the prefiltered environment map against a ground truth that treats every
+// source texel as a sample. The environment is either an equirectangular HDR (--hdr) or a procedural
+// sky with a small bright sun, which is the hard case for importance sampling. The prefilter is
+// evaluated on the CPU exactly like prefilter.comp does it: same ibl::GeneratePrefilterSamples samples,
+// same source mip selection, trilinear lookups into a box filtered mip chain.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ibl/prefilter_samples.h"
+#include "utility/stb_image.h"
+#include "utility/thread_pool.h"
+
+namespace
+{
+constexpr float PI = 3.14159265359f;
+
+struct CpuCubemap
+{
+    unsigned int size = 0;
+    // per mip level, 6 faces of size * size texels in GL face order
+    std::vector<std::vector<glm::vec3>> levels;
+};
+
+// direction through the texel center, following the GL cubemap face layout (same as prefilter.comp)
+glm::vec3 cubemapDirection(unsigned int face, float s, float t)
+{
+    switch (face)
+    {
+        case 0: return glm::vec3( 1.0f, -t, -s);
+        case 1: return glm::vec3(-1.0f, -t,  s);
+        case 2: return glm::vec3( s,  1.0f,  t);
+        case 3: return glm::vec3( s, -1.0f, -t);
+        case 4: return glm::vec3( s, -t,  1.0f);
+        default: return glm::vec3(-s, -t, -1.0f);
+    }
+}
+
+// inverse of cubemapDirection, s and t in [0, 1]
+unsigned int cubemapFace(const glm::vec3& d, float& s, float& t)
+{
+    float ax = std::fabs(d.x), ay = std::fabs(d.y), az = std::fabs(d.z);
+    unsigned int face;
+    float sc, tc, ma;
+    if (ax >= ay && ax >= az)
+    {
+        face = d.x > 0.0f ? 0 : 1;
+        sc = d.x > 0.0f ? -d.z : d.z;
+        tc = -d.y;
+        ma = ax;
+    }
+    else if (ay >= az)
+    {
+        face = d.y > 0.0f ? 2 : 3;
+        sc = d.x;
+        tc = d.y > 0.0f ? d.z : -d.z;
+        ma = ay;
+    }
+    else
+    {
+        face = d.z > 0.0f ? 4 : 5;
+        sc = d.z > 0.0f ? d.x : -d.x;
+        tc = -d.y;
+        ma = az;
+    }
+    s = 0.5f * (sc / ma + 1.0f);
+    t = 0.5f * (tc / ma + 1.0f);
+    return face;
+}
+
+// bilinear within the face, clamped at the face edge
+glm::vec3 sampleLevel(const CpuCubemap& cubemap, unsigned int level, const glm::vec3& direction)
+{
+    unsigned int size = std::max(cubemap.size >> level, 1u);
+    float s, t;
+    unsigned int face = cubemapFace(direction, s, t);
+    float x = s * size - 0.5f;
+    float y = t * size - 0.5f;
+    int x0 = static_cast<int>(std::floor(x));
+    int y0 = static_cast<int>(std::floor(y));
+    float fx = x - x0;
+    float fy = y - y0;
+    auto texel = [&](int tx, int ty)
+    {
+        tx = std::min(std::max(tx, 0), static_cast<int>(size) - 1);
+        ty = std::min(std::max(ty, 0), static_cast<int>(size) - 1);
+        return cubemap.levels[level][(face * size + ty) * size + tx];
+    };
+    glm::vec3 top = texel(x0, y0) * (1.0f - fx) + texel(x0 + 1, y0) * fx;
+    glm::vec3 bottom = texel(x0, y0 + 1) * (1.0f - fx) + texel(x0 + 1, y0 + 1) * fx;
+    return top * (1.0f - fy) + bottom * fy;
+}
+
+// textureLod with GL_LINEAR_MIPMAP_LINEAR
+glm::vec3 sampleLod(const CpuCubemap& cubemap, const glm::vec3& direction, float lod)
+{
+    float maxLevel = static_cast<float>(cubemap.levels.size() - 1);
+    lod = std::min(std::max(lod, 0.0f), maxLevel);
+    unsigned int level = static_cast<unsigned int>(lod);
+    float blend = lod - level;
+    glm::vec3 color = sampleLevel(cubemap, level, direction);
+    if (blend > 0.0f && level + 1 < cubemap.levels.size())
+        color = color * (1.0f - blend) + sampleLevel(cubemap, level + 1, direction) * blend;
+    return color;
+}
+
+// same box filter as glGenerateMipmap on a power of two texture
+void generateMipmaps(CpuCubemap& cubemap)
+{
+    for (unsigned int size = cubemap.size / 2; size >= 1; size /= 2)
+    {
+        const std::vector<glm::vec3>& source = cubemap.levels.back();
+        std::vector<glm::vec3> level(6 * size * size);
+        for (unsigned int face = 0; face < 6; ++face)
+            for (unsigned int y = 0; y < size; ++y)
+                for (unsigned int x = 0; x < size; ++x)
+                {
+                    auto texel = [&](unsigned int tx, unsigned int ty) { return source[(face * size * 2 + ty) * size * 2 + tx]; };
+                    level[(face * size + y) * size + x] = (texel(2 * x, 2 * y) + texel(2 * x + 1, 2 * y) + texel(2 * x, 2 * y + 1) + texel(2 * x + 1, 2 * y + 1)) * 0.25f;
+                }
+        cubemap.levels.push_back(std::move(level));
+    }
+}
+
+glm::vec3 proceduralSky(const glm::vec3& direction)
+{
+    const glm::vec3 sunDirection = glm::normalize(glm::vec3(0.4f, 0.6f, 0.3f));
+    const float sunCosRadius = std::cos(1.5f * PI / 180.0f);
+    float up = direction.y * 0.5f + 0.5f;
+    glm::vec3 sky = glm::vec3(0.25f, 0.2f, 0.15f) * (1.0f - up) + glm::vec3(0.3f, 0.5f, 1.0f) * up;
+    if (glm::dot(direction, sunDirection) > sunCosRadius) sky += glm::vec3(200.0f, 180.0f, 150.0f);
+    return sky;
+}
+
+bool buildEnvironment(CpuCubemap& cubemap, unsigned int size, const char* hdrPath)
+{
+    int width = 0, height = 0, nrComponents = 0;
+    float* data = nullptr;
+    if (hdrPath)
+    {
+        data = stbi_loadf(hdrPath, &width, &height, &nrComponents, 3);
+        if (!data)
+        {
+            std::cerr << "Failed to load HDR image " << hdrPath << std::endl;
+            return false;
+        }
+    }
+
+    cubemap.size = size;
+    cubemap.levels.assign(1, std::vector<glm::vec3>(6 * size * size));
+    for (unsigned int face = 0; face < 6; ++face)
+        for (unsigned int y = 0; y < size; ++y)
+            for (unsigned int x = 0; x < size; ++x)
+            {
+                glm::vec3 direction = glm::normalize(cubemapDirection(face, (x + 0.5f) / size * 2.0f - 1.0f, (y + 0.5f) / size * 2.0f - 1.0f));
+                glm::vec3 color;
+                if (data)
+                {
+                    // equirectangular_to_cubemap.frag, nearest texel
+                    float u = std::atan2(direction.z, direction.x) / (2.0f * PI) + 0.5f;
+                    float v = std::asin(std::min(std::max(direction.y, -1.0f), 1.0f)) / PI + 0.5f;
+                    int px = std::min(static_cast<int>(u * width), width - 1);
+                    int py = std::min(static_cast<int>(v * height), height - 1);
+                    const float* texel = data + 3 * (py * width + px);
+                    color = glm::vec3(texel[0], texel[1], texel[2]);
+                }
+                else
+                {
+                    color = proceduralSky(direction);
+                }
+                cubemap.levels[0][(face * size + y) * size + x] = color;
+            }
+    if (data) stbi_image_free(data);
+
+    generateMipmaps(cubemap);
+    return true;
+}
+
+// prefilter.comp for one output direction and roughness mip
+glm::vec3 prefilter(const CpuCubemap& environment, const ibl::PrefilterSampleSet& set, unsigned int mip, const glm::vec3& N)
+{
+    glm::vec3 up = std::fabs(N.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 tangent = glm::normalize(glm::cross(up, N));
+    glm::vec3 bitangent = glm::cross(N, tangent);
+
+    glm::vec3 color(0.0f);
+    for (unsigned int i = 0; i < set.counts[mip]; ++i)
+    {
+        const glm::vec4& s = set.samples[set.offsets[mip] + i];
+        glm::vec3 L = tangent * s.x + bitangent * s.y + N * s.z;
+        color += sampleLod(environment, L, s.w) * s.z;
+    }
+    return color / set.weightSums[mip];
+}
+
+// solid angle of the face area from the face center to (x, y), x and y in [-1, 1]
+float areaElement(float x, float y)
+{
+    return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0f));
+}
+
+// every mip 0 texel with its direction and solid angle
+struct TexelQuadrature
+{
+    std::vector<glm::vec3> directions;
+    std::vector<float> solidAngles;
+    std::vector<glm::vec3> colors;
+};
+
+TexelQuadrature buildQuadrature(const CpuCubemap& environment)
+{
+    TexelQuadrature quadrature;
+    unsigned int size = environment.size;
+    float texelSize = 2.0f / size;
+    for (unsigned int face = 0; face < 6; ++face)
+        for (unsigned int y = 0; y < size; ++y)
+            for (unsigned int x = 0; x < size; ++x)
+            {
+                float s0 = x * texelSize - 1.0f, t0 = y * texelSize - 1.0f;
+                float s1 = s0 + texelSize, t1 = t0 + texelSize;
+                quadrature.directions.push_back(glm::normalize(cubemapDirection(face, s0 + 0.5f * texelSize, t0 + 0.5f * texelSize)));
+                quadrature.solidAngles.push_back(areaElement(s0, t0) - areaElement(s0, t1) - areaElement(s1, t0) + areaElement(s1, t1));
+                quadrature.colors.push_back(environment.levels[0][(face * size + y) * size + x]);
+            }
+    return quadrature;
+}
+
+// the value GGX importance sampling converges to with N = V = R: the environment weighted by
+// NdotL * pdf(L), where pdf(L) = D * NdotH / (4 * HdotV) = D / 4
+glm::vec3 convolve(const TexelQuadrature& quadrature, const CpuCubemap& environment, float roughness, const glm::vec3& N)
+{
+    if (roughness == 0.0f) return sampleLevel(environment, 0, N);
+
+    glm::vec3 color(0.0f);
+    double weightSum = 0.0;
+    for (size_t i = 0; i < quadrature.directions.size(); ++i)
+    {
+        const glm::vec3& L = quadrature.directions[i];
+        float NdotL = glm::dot(N, L);
+        if (NdotL <= 0.0f) continue;
+        float NdotH = glm::dot(N, glm::normalize(N + L));
+        float weight = ibl::DistributionGGX(NdotH, roughness) * 0.25f * NdotL * quadrature.solidAngles[i];
+        color += quadrature.colors[i] * weight;
+        weightSum += weight;
+    }
+    return color / static_cast<float>(weightSum);
+}
+
+struct ErrorStats
+{
+    double relativeRmse = 0.0; // sqrt(sum |e - r|^2 / sum |r|^2)
+    double maxRelative = 0.0;  // worst single direction
+};
+
+ErrorStats measure(const std::vector<glm::vec3>& estimate, const std::vector<glm::vec3>& reference)
+{
+    ErrorStats stats;
+    double errorSum = 0.0, referenceSum = 0.0;
+    for (size_t i = 0; i < estimate.size(); ++i)
+    {
+        glm::vec3 difference = estimate[i] - reference[i];
+        double error = glm::dot(difference, difference);
+        double magnitude = glm::dot(reference[i], reference[i]);
+        errorSum += error;
+        referenceSum += magnitude;
+        if (magnitude > 0.0) stats.maxRelative = std::max(stats.maxRelative, std::sqrt(error / magnitude));
+    }
+    stats.relativeRmse = referenceSum > 0.0 ? std::sqrt(errorSum / referenceSum) : 0.0;
+    return stats;
+}
+
+template<typename F>
+std::vector<glm::vec3> evaluate(utility::ThreadPool& threadPool, const std::vector<glm::vec3>& directions, F&& function)
+{
+    std::vector<glm::vec3> result(directions.size());
+    threadPool.ParallelFor(directions.size(), [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i) result[i] = function(directions[i]);
+    });
+    return result;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* hdrPath = nullptr;
+    unsigned int sourceResolution = 512;
+    unsigned int mipLevels = 5;
+    unsigned int prefilterResolution = 128;
+    unsigned int maxSampleCount = 1024;
+    unsigned int directionsPerFaceSide = 8;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--hdr") == 0 && i + 1 < argc) hdrPath = argv[++i];
+        else if (std::strcmp(argv[i], "--source-resolution") == 0 && i + 1 < argc) sourceResolution = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--max-samples") == 0 && i + 1 < argc) maxSampleCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--directions") == 0 && i + 1 < argc) directionsPerFaceSide = std::atoi(argv[++i]);
+        else std::cerr << "Warning: unknown argument " << argv[i] << std::endl;
+    }
+
+    CpuCubemap environment;
+    if (!buildEnvironment(environment, sourceResolution, hdrPath)) return 1;
+
+    std::vector<glm::vec3> directions;
+    for (unsigned int face = 0; face < 6; ++face)
+        for (unsigned int y = 0; y < directionsPerFaceSide; ++y)
+            for (unsigned int x = 0; x < directionsPerFaceSide; ++x)
+            {
+                float s = (x + 0.5f) / directionsPerFaceSide * 2.0f - 1.0f;
+                float t = (y + 0.5f) / directionsPerFaceSide * 2.0f - 1.0f;
+                directions.push_back(glm::normalize(cubemapDirection(face, s, t)));
+            }
+
+    utility::ThreadPool threadPool;
+    auto start = std::chrono::steady_clock::now();
+    TexelQuadrature quadrature = buildQuadrature(environment);
+    std::vector<std::vector<glm::vec3>> reference;
+    for (unsigned int mip = 0; mip < mipLevels; ++mip)
+    {
+        float roughness = mipLevels > 1 ? (float)mip / (float)(mipLevels - 1) : 0.0f;
+        reference.push_back(evaluate(threadPool, directions, [&](const glm::vec3& N) { return convolve(quadrature, environment, roughness, N); }));
+    }
+    std::chrono::duration<double> referenceSeconds = std::chrono::steady_clock::now() - start;
+    std::cerr << "reference: " << quadrature.directions.size() << " texels, " << directions.size() << " directions, " << referenceSeconds.count() << " s" << std::endl;
+
+    // error of every power of two sample count, errors[mip][log2(count)]
+    std::vector<std::vector<ErrorStats>> errors(mipLevels);
+    std::cout << "mip, roughness, samples, rel rmse, max rel error" << std::endl;
+    for (unsigned int count = 1; count <= maxSampleCount; count *= 2)
+    {
+        ibl::PrefilterSampleSet set = ibl::GeneratePrefilterSamples(mipLevels, count, sourceResolution);
+        for (unsigned int mip = 0; mip < mipLevels; ++mip)
+        {
+            ErrorStats stats = measure(evaluate(threadPool, directions, [&](const glm::vec3& N) { return prefilter(environment, set, mip, N); }), reference[mip]);
+            errors[mip].push_back(stats);
+            float roughness = mipLevels > 1 ? (float)mip / (float)(mipLevels - 1) : 0.0f;
+            std::cout << mip << ", " << roughness << ", " << count << ", " << stats.relativeRmse << ", " << stats.maxRelative << std::endl;
+        }
+    }
+
+    // cost is proportional to output texels times samples per texel
+    std::vector<unsigned int> counts = ibl::PrefilterSampleCounts(mipLevels, maxSampleCount);
+    double bakeCost = 0.0, fixedCost = 0.0;
+    std::cout << std::endl << "mip, baked samples, rel rmse, fixed " << maxSampleCount << " rel rmse" << std::endl;
+    for (unsigned int mip = 0; mip < mipLevels; ++mip)
+    {
+        unsigned int countIndex = 0;
+        while ((1u << (countIndex + 1)) <= counts[mip]) ++countIndex;
+        double texels = 6.0 * std::pow(std::max(prefilterResolution >> mip, 1u), 2.0);
+        bakeCost += texels * counts[mip];
+        fixedCost += texels * maxSampleCount;
+        std::cout << mip << ", " << counts[mip] << ", " << errors[mip][countIndex].relativeRmse << ", " << errors[mip].back().relativeRmse << std::endl;
+    }
+    std::cout << "bake cost " << bakeCost / fixedCost * 100.0 << "% of fixed " << maxSampleCount << " samples" << std::endl;
+    return 0;
+}
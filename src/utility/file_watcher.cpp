@@ -0,0 +1,110 @@
+#include <iostream>
+#include "utility/file_watcher.h"
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#else
+#include <filesystem>
+#endif
+
+namespace utility
+{
+
+namespace
+{
+#ifdef __linux__
+// "../shader/pbr.frag" -> "../shader", a bare name is in the working directory
+std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+#else
+long long writeTime(const std::string& path)
+{
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    return error ? 0 : static_cast<long long>(time.time_since_epoch().count());
+}
+#endif
+} // namespace
+
+#ifdef __linux__
+FileWatcher::FileWatcher()
+{
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0) std::cerr << "Warning: inotify is unavailable (" << std::strerror(errno) << "), changed files are not reported" << std::endl;
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (m_inotify >= 0) close(m_inotify);
+}
+
+void FileWatcher::Watch(const std::string& path)
+{
+    if (!m_files.insert(path).second || m_inotify < 0) return;
+    std::string directory = directoryOf(path);
+    if (m_watches.count(directory)) return;
+    // close-write covers in place saves, moved-to the rename of a temporary file. Plain modify events would
+    // report a file that is only partly written
+    int watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch < 0)
+    {
+        std::cerr << "Warning: can't watch " << directory << " (" << std::strerror(errno) << ")" << std::endl;
+        return;
+    }
+    m_watches[directory] = watch;
+    m_directories[watch] = directory;
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+    std::vector<std::string> changed;
+    if (m_inotify < 0) return changed;
+    std::unordered_set<std::string> seen;
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+    while (true)
+    {
+        ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+        if (length <= 0) break; // EAGAIN once every queued event is read
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+            auto directory = m_directories.find(event->wd);
+            if (event->len == 0 || directory == m_directories.end()) continue;
+            std::string path = directory->second == "." ? event->name : directory->second + "/" + event->name;
+            if (m_files.count(path) && seen.insert(path).second) changed.push_back(path);
+        }
+    }
+    return changed;
+}
+#else
+FileWatcher::FileWatcher() = default;
+FileWatcher::~FileWatcher() = default;
+
+void FileWatcher::Watch(const std::string& path)
+{
+    if (m_files.insert(path).second) m_writeTimes[path] = writeTime(path);
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+    std::vector<std::string> changed;
+    for (auto& [path, time] : m_writeTimes)
+    {
+        long long current = writeTime(path);
+        if (current != time)
+        {
+            time = current;
+            changed.push_back(path);
+        }
+    }
+    return changed;
+}
+#endif
+} // namespace utility
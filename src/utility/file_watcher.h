@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace utility
+{
+
+// reports files written since the last Poll, without blocking.
+// On Linux the directories of the files are watched with inotify, so the editors that save by writing a
+// temporary file and renaming it over the original are seen as well. Elsewhere the modification times are compared.
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // the path is reported by Poll exactly as it is passed here
+    void Watch(const std::string& path);
+    // the watched files completely written since the last call, each once
+    std::vector<std::string> Poll();
+
+private:
+    std::unordered_set<std::string> m_files;
+#ifdef __linux__
+    int m_inotify = -1;
+    std::unordered_map<int, std::string> m_directories; // watch descriptor to directory
+    std::unordered_map<std::string, int> m_watches;     // directory to watch descriptor
+#else
+    std::unordered_map<std::string, long long> m_writeTimes;
+#endif
+};
+} // namespace utility
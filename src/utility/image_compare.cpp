@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "utility/image_compare.h"
+
+namespace utility
+{
+
+namespace
+{
+constexpr double kPi = 3.14159265358979323846;
+
+// one float plane of an image
+struct Plane
+{
+    int width = 0;
+    int height = 0;
+    std::vector<float> values;
+
+    Plane(int width, int height) : width(width), height(height), values(static_cast<size_t>(width) * height) { }
+    inline float& At(int x, int y) { return values[static_cast<size_t>(y) * width + x]; }
+};
+
+// separable Gaussian blur, the border pixels repeat
+void blur(Plane& plane, double sigma)
+{
+    int radius = std::max(1, static_cast<int>(std::ceil(3.0 * sigma)));
+    std::vector<float> kernel(2 * radius + 1);
+    float sum = 0.0f;
+    for (int i = -radius; i <= radius; ++i) sum += kernel[i + radius] = static_cast<float>(std::exp(-0.5 * i * i / (sigma * sigma)));
+    for (float& weight : kernel) weight /= sum;
+
+    Plane temporary(plane.width, plane.height);
+    for (int y = 0; y < plane.height; ++y)
+    {
+        for (int x = 0; x < plane.width; ++x)
+        {
+            float value = 0.0f;
+            for (int i = -radius; i <= radius; ++i) value += kernel[i + radius] * plane.At(std::clamp(x + i, 0, plane.width - 1), y);
+            temporary.At(x, y) = value;
+        }
+    }
+    for (int y = 0; y < plane.height; ++y)
+    {
+        for (int x = 0; x < plane.width; ++x)
+        {
+            float value = 0.0f;
+            for (int i = -radius; i <= radius; ++i) value += kernel[i + radius] * temporary.At(x, std::clamp(y + i, 0, plane.height - 1));
+            plane.At(x, y) = value;
+        }
+    }
+}
+
+double meanSSIM(const unsigned char* image, const unsigned char* reference, int width, int height)
+{
+    const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+    Plane x(width, height), y(width, height), xx(width, height), yy(width, height), xy(width, height);
+    for (size_t i = 0; i < x.values.size(); ++i)
+    {
+        const unsigned char* a = image + 3 * i;
+        const unsigned char* b = reference + 3 * i;
+        float lumaA = 0.2126f * a[0] + 0.7152f * a[1] + 0.0722f * a[2];
+        float lumaB = 0.2126f * b[0] + 0.7152f * b[1] + 0.0722f * b[2];
+        x.values[i] = lumaA;
+        y.values[i] = lumaB;
+        xx.values[i] = lumaA * lumaA;
+        yy.values[i] = lumaB * lumaB;
+        xy.values[i] = lumaA * lumaB;
+    }
+    for (Plane* plane : { &x, &y, &xx, &yy, &xy }) blur(*plane, 1.5);
+    double sum = 0.0;
+    for (size_t i = 0; i < x.values.size(); ++i)
+    {
+        double muX = x.values[i];
+        double muY = y.values[i];
+        double varianceX = std::max(0.0, xx.values[i] - muX * muX);
+        double varianceY = std::max(0.0, yy.values[i] - muY * muY);
+        double covariance = xy.values[i] - muX * muY;
+        sum += (2.0 * muX * muY + c1) * (2.0 * covariance + c2) / ((muX * muX + muY * muY + c1) * (varianceX + varianceY + c2));
+    }
+    return sum / x.values.size();
+}
+
+// D65 white of the sRGB primaries
+constexpr double kWhite[3] = { 0.950428545, 1.0, 1.088900371 };
+
+void linearRGBToXYZ(const double rgb[3], double xyz[3])
+{
+    xyz[0] = 0.4124564 * rgb[0] + 0.3575761 * rgb[1] + 0.1804375 * rgb[2];
+    xyz[1] = 0.2126729 * rgb[0] + 0.7151522 * rgb[1] + 0.0721750 * rgb[2];
+    xyz[2] = 0.0193339 * rgb[0] + 0.1191920 * rgb[1] + 0.9503041 * rgb[2];
+}
+
+void xyzToLinearRGB(const double xyz[3], double rgb[3])
+{
+    rgb[0] = 3.2404542 * xyz[0] - 1.5371385 * xyz[1] - 0.4985314 * xyz[2];
+    rgb[1] = -0.9692660 * xyz[0] + 1.8760108 * xyz[1] + 0.0415560 * xyz[2];
+    rgb[2] = 0.0556434 * xyz[0] - 0.2040259 * xyz[1] + 1.0572252 * xyz[2];
+}
+
+// L*a*b* with the chroma scaled by 0.01 L* (Hunt effect), as FLIP compares colors
+void xyzToHuntLab(const double xyz[3], double lab[3])
+{
+    auto f = [](double t)
+    {
+        const double delta = 6.0 / 29.0;
+        return t > delta * delta * delta ? std::cbrt(t) : t / (3.0 * delta * delta) + 4.0 / 29.0;
+    };
+    double fx = f(xyz[0] / kWhite[0]);
+    double fy = f(xyz[1] / kWhite[1]);
+    double fz = f(xyz[2] / kWhite[2]);
+    lab[0] = 116.0 * fy - 16.0;
+    lab[1] = 0.01 * lab[0] * 500.0 * (fx - fy);
+    lab[2] = 0.01 * lab[0] * 200.0 * (fy - fz);
+}
+
+double hyAB(const double a[3], const double b[3])
+{
+    return std::abs(a[0] - b[0]) + std::sqrt((a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+// the three YCxCz planes of an RGB8 image, filtered with FLIP's contrast sensitivity functions
+void filteredYCxCz(const unsigned char* image, int width, int height, double pixelsPerDegree, Plane planes[3])
+{
+    for (size_t i = 0; i < planes[0].values.size(); ++i)
+    {
+        double rgb[3];
+        for (int c = 0; c < 3; ++c) rgb[c] = std::pow(image[3 * i + c] / 255.0, 2.2); // the renderer's display gamma
+        double xyz[3];
+        linearRGBToXYZ(rgb, xyz);
+        double y = xyz[1] / kWhite[1];
+        planes[0].values[i] = static_cast<float>(116.0 * y - 16.0);
+        planes[1].values[i] = static_cast<float>(500.0 * (xyz[0] / kWhite[0] - y));
+        planes[2].values[i] = static_cast<float>(200.0 * (y - xyz[2] / kWhite[2]));
+    }
+    // the widest Gaussian of each channel's CSF, sigma = sqrt(b / (2 pi^2)) degrees
+    const double b[3] = { 0.0047, 0.0053, 0.04 };
+    for (int c = 0; c < 3; ++c) blur(planes[c], std::sqrt(b[c] / (2.0 * kPi * kPi)) * pixelsPerDegree);
+}
+
+void filteredHuntLab(Plane planes[3], size_t i, double lab[3])
+{
+    double y = (planes[0].values[i] + 16.0) / 116.0;
+    double xyz[3] = { (planes[1].values[i] / 500.0 + y) * kWhite[0], y * kWhite[1], (y - planes[2].values[i] / 200.0) * kWhite[2] };
+    double rgb[3];
+    xyzToLinearRGB(xyz, rgb);
+    for (double& value : rgb) value = std::clamp(value, 0.0, 1.0);
+    linearRGBToXYZ(rgb, xyz);
+    xyzToHuntLab(xyz, lab);
+}
+} // namespace
+
+ImageDifference CompareImages(const unsigned char* image, const unsigned char* reference, int width, int height, int tolerance, double pixelsPerDegree, std::vector<float>* errorMap)
+{
+    ImageDifference difference;
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    if (pixelCount == 0) return difference;
+
+    double squaredError = 0.0;
+    size_t overTolerance = 0;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        int pixelDifference = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            int channelDifference = std::abs(image[3 * i + c] - reference[3 * i + c]);
+            squaredError += channelDifference * channelDifference;
+            pixelDifference = std::max(pixelDifference, channelDifference);
+        }
+        difference.maxDifference = std::max(difference.maxDifference, pixelDifference);
+        overTolerance += pixelDifference > tolerance;
+    }
+    double meanSquaredError = squaredError / (3.0 * pixelCount);
+    difference.psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
+    difference.overTolerance = static_cast<double>(overTolerance) / pixelCount;
+    difference.ssim = meanSSIM(image, reference, width, height);
+
+    // FLIP's normalization: the error between green and blue is the largest, errors are compressed with qc = 0.7
+    // and mapped so that the lower 40% of that range covers 95% of the output
+    const double qc = 0.7;
+    const double pc = 0.4;
+    const double pt = 0.95;
+    double green[3] = { 0.0, 1.0, 0.0 };
+    double blue[3] = { 0.0, 0.0, 1.0 };
+    double greenXYZ[3], blueXYZ[3], greenLab[3], blueLab[3];
+    linearRGBToXYZ(green, greenXYZ);
+    linearRGBToXYZ(blue, blueXYZ);
+    xyzToHuntLab(greenXYZ, greenLab);
+    xyzToHuntLab(blueXYZ, blueLab);
+    double cmax = std::pow(hyAB(greenLab, blueLab), qc);
+
+    Plane imagePlanes[3] = { Plane(width, height), Plane(width, height), Plane(width, height) };
+    Plane referencePlanes[3] = { Plane(width, height), Plane(width, height), Plane(width, height) };
+    filteredYCxCz(image, width, height, pixelsPerDegree, imagePlanes);
+    filteredYCxCz(reference, width, height, pixelsPerDegree, referencePlanes);
+    if (errorMap) errorMap->resize(pixelCount);
+    double errorSum = 0.0;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        double imageLab[3], referenceLab[3];
+        filteredHuntLab(imagePlanes, i, imageLab);
+        filteredHuntLab(referencePlanes, i, referenceLab);
+        double error = std::pow(hyAB(imageLab, referenceLab), qc);
+        error = error < pc * cmax ? error * pt / (pc * cmax) : pt + (error - pc * cmax) / (cmax - pc * cmax) * (1.0 - pt);
+        error = std::min(error, 1.0);
+        errorSum += error;
+        difference.flipMax = std::max(difference.flipMax, error);
+        if (errorMap) (*errorMap)[i] = static_cast<float>(error);
+    }
+    difference.flipMean = errorSum / pixelCount;
+    return difference;
+}
+} // namespace utility
@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+
+namespace utility
+{
+
+// how far one RGB8 image is from a reference of the same size
+struct ImageDifference
+{
+    int maxDifference = 0;      // largest channel difference, 0..255
+    double overTolerance = 0.0; // fraction of pixels with a channel differing by more than the tolerance
+    double psnr = 0.0;          // dB, infinity for identical images
+    double ssim = 1.0;          // mean SSIM of the luma, 11x11 Gaussian window
+    double flipMean = 0.0;      // mean of the FLIP-style color error, 0 identical .. 1 the largest visible difference
+    double flipMax = 0.0;
+};
+
+// compares two RGB8 images, rows top to bottom. The FLIP-style error follows the color pipeline of NVIDIA's FLIP:
+// both images are filtered with the contrast sensitivity of a viewer at pixelsPerDegree in YCxCz, converted to
+// Hunt adjusted L*a*b* and compared with the HyAB distance. FLIP's feature (edge and point) term is left out, so
+// it mostly reacts to color and blur differences, the per channel metrics catch the rest. errorMap, when set,
+// gets the per pixel FLIP-style error
+ImageDifference CompareImages(const unsigned char* image, const unsigned char* reference, int width, int height, int tolerance, double pixelsPerDegree = 67.0, std::vector<float>* errorMap = nullptr);
+} // namespace utility
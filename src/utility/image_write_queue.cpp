@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include "utility/image_write_queue.h"
+#include "profiling/zones.h"
+
+namespace utility
+{
+
+namespace
+{
+unsigned int defaultThreadCount(unsigned int threadCount)
+{
+    return threadCount > 0 ? threadCount : std::max(2u, std::thread::hardware_concurrency()) - 1;
+}
+} // namespace
+
+ImageWriteQueue::ImageWriteQueue(unsigned int threadCount, size_t maxPending)
+    : m_pool(defaultThreadCount(threadCount)), m_maxPending(maxPending > 0 ? maxPending : 2 * defaultThreadCount(threadCount))
+{
+}
+
+ImageWriteQueue::~ImageWriteQueue()
+{
+    Wait();
+}
+
+void ImageWriteQueue::Write(std::string path, DisplayImage&& image)
+{
+    m_pending.push_back(m_pool.Submit([path = std::move(path), image = std::move(image)]()
+    {
+        PROFILE_ZONE("encode image");
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+        std::error_code error;
+        if (!directory.empty()) std::filesystem::create_directories(directory, error);
+        return WriteDisplayImage(path, image);
+    }));
+    while (m_pending.size() > m_maxPending) retireOldest();
+}
+
+void ImageWriteQueue::Wait()
+{
+    while (!m_pending.empty()) retireOldest();
+}
+
+void ImageWriteQueue::retireOldest()
+{
+    auto start = std::chrono::steady_clock::now();
+    bool written = m_pending.front().get();
+    m_waitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (written) ++m_written;
+    else ++m_failed;
+    m_pending.pop_front();
+}
+} // namespace utility
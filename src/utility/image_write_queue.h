@@ -0,0 +1,45 @@
+#pragma once
+#include <deque>
+#include <future>
+#include <string>
+#include "utility/image_writer.h"
+#include "utility/thread_pool.h"
+
+namespace utility
+{
+
+// encodes and writes images on worker threads so the calling thread can keep rendering. At most maxPending images
+// wait in memory, Write blocks on the oldest beyond that. Only the thread that owns the queue calls it
+class ImageWriteQueue
+{
+public:
+    // threadCount 0: every hardware thread but the caller's; maxPending 0: 2 per thread
+    explicit ImageWriteQueue(unsigned int threadCount = 0, size_t maxPending = 0);
+    // waits for the images still queued
+    ~ImageWriteQueue();
+
+    ImageWriteQueue(const ImageWriteQueue&) = delete;
+    ImageWriteQueue& operator=(const ImageWriteQueue&) = delete;
+
+    // queues WriteDisplayImage(path, image), the format follows the extension
+    void Write(std::string path, DisplayImage&& image);
+    // returns once every queued image is written
+    void Wait();
+
+    inline size_t GetWrittenCount() const { return m_written; }
+    inline size_t GetFailedCount() const { return m_failed; }
+    // time Write and Wait blocked on the workers
+    inline double GetWaitMilliseconds() const { return m_waitMilliseconds; }
+    inline unsigned int GetThreadCount() const { return m_pool.GetThreadCount(); }
+
+private:
+    void retireOldest();
+
+    ThreadPool m_pool;
+    size_t m_maxPending;
+    std::deque<std::future<bool>> m_pending; // oldest first
+    size_t m_written = 0;
+    size_t m_failed = 0;
+    double m_waitMilliseconds = 0.0;
+};
+} // namespace utility
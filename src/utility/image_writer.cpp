@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <glm/gtc/packing.hpp>
+#include "utility/image_writer.h"
+
+namespace utility
+{
+
+namespace
+{
+// deflate with the fixed Huffman codes and a greedy LZ77 match, no zlib dependency. Renders compress well
+// with the PNG Sub filter, the dynamic codes of zlib would save another 10-20%
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<unsigned char>& out) : m_out(out) { }
+
+    // value's bits least significant first, the order of the deflate header fields and extra bits
+    void Write(uint32_t value, int count)
+    {
+        m_buffer |= value << m_count;
+        m_count += count;
+        while (m_count >= 8)
+        {
+            m_out.push_back(static_cast<unsigned char>(m_buffer));
+            m_buffer >>= 8;
+            m_count -= 8;
+        }
+    }
+    // Huffman codes go most significant bit first
+    void WriteCode(uint32_t code, int count)
+    {
+        uint32_t reversed = 0;
+        for (int i = 0; i < count; ++i) reversed |= ((code >> i) & 1u) << (count - 1 - i);
+        Write(reversed, count);
+    }
+    void Flush()
+    {
+        if (m_count > 0) m_out.push_back(static_cast<unsigned char>(m_buffer));
+        m_buffer = 0;
+        m_count = 0;
+    }
+
+private:
+    std::vector<unsigned char>& m_out;
+    uint32_t m_buffer = 0;
+    int m_count = 0;
+};
+
+constexpr uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+constexpr uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+constexpr uint16_t kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+constexpr uint8_t kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+constexpr int kWindowSize = 32768;
+constexpr int kMaxMatch = 258;
+constexpr int kMaxChain = 32;
+constexpr int kHashBits = 15;
+
+void writeLiteralLength(BitWriter& bits, int symbol)
+{
+    if (symbol < 144) bits.WriteCode(0x30 + symbol, 8);
+    else if (symbol < 256) bits.WriteCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280) bits.WriteCode(symbol - 256, 7);
+    else bits.WriteCode(0xC0 + symbol - 280, 8);
+}
+
+void writeMatch(BitWriter& bits, int length, int distance)
+{
+    int lengthCode = 28;
+    while (kLengthBase[lengthCode] > length) --lengthCode;
+    writeLiteralLength(bits, 257 + lengthCode);
+    bits.Write(length - kLengthBase[lengthCode], kLengthExtra[lengthCode]);
+    int distanceCode = 29;
+    while (kDistanceBase[distanceCode] > distance) --distanceCode;
+    bits.WriteCode(distanceCode, 5);
+    bits.Write(distance - kDistanceBase[distanceCode], kDistanceExtra[distanceCode]);
+}
+
+uint32_t hash3(const unsigned char* data)
+{
+    return ((data[0] << 16 | data[1] << 8 | data[2]) * 2654435761u) >> (32 - kHashBits);
+}
+
+// zlib stream: header, one fixed Huffman block, Adler-32
+std::vector<unsigned char> zlibCompress(const std::vector<unsigned char>& data)
+{
+    std::vector<unsigned char> out = { 0x78, 0x01 };
+    BitWriter bits(out);
+    bits.Write(1, 1); // last block
+    bits.Write(1, 2); // fixed codes
+
+    const int size = static_cast<int>(data.size());
+    std::vector<int> head(1 << kHashBits, -1);
+    std::vector<int> previous(kWindowSize, -1);
+    auto insert = [&](int position)
+    {
+        if (position + 2 >= size) return;
+        uint32_t hash = hash3(&data[position]);
+        previous[position % kWindowSize] = head[hash];
+        head[hash] = position;
+    };
+    for (int position = 0; position < size;)
+    {
+        int bestLength = 0;
+        int bestDistance = 0;
+        if (position + 2 < size)
+        {
+            int candidate = head[hash3(&data[position])];
+            int maxLength = std::min(kMaxMatch, size - position);
+            for (int chain = 0; candidate >= 0 && position - candidate <= kWindowSize && chain < kMaxChain; ++chain)
+            {
+                int length = 0;
+                while (length < maxLength && data[candidate + length] == data[position + length]) ++length;
+                if (length > bestLength)
+                {
+                    bestLength = length;
+                    bestDistance = position - candidate;
+                    if (length == maxLength) break;
+                }
+                candidate = previous[candidate % kWindowSize];
+            }
+        }
+        if (bestLength >= 3)
+        {
+            writeMatch(bits, bestLength, bestDistance);
+            for (int i = 0; i < bestLength; ++i) insert(position + i);
+            position += bestLength;
+        }
+        else
+        {
+            writeLiteralLength(bits, data[position]);
+            insert(position);
+            ++position;
+        }
+    }
+    writeLiteralLength(bits, 256);
+    bits.Flush();
+
+    uint32_t a = 1, b = 0;
+    for (unsigned char byte : data)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<unsigned char>(adler >> shift));
+    return out;
+}
+
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+    // built once, thread safe, images may be encoded on several threads
+    static const std::array<uint32_t, 256> table = []()
+    {
+        std::array<uint32_t, 256> entries;
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[n] = c;
+        }
+        return entries;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void appendBigEndian(std::vector<unsigned char>& out, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<unsigned char>(value >> shift));
+}
+
+void appendChunk(std::vector<unsigned char>& out, const char type[4], const std::vector<unsigned char>& data)
+{
+    appendBigEndian(out, static_cast<uint32_t>(data.size()));
+    size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendBigEndian(out, crc32(&out[typeOffset], 4 + data.size()));
+}
+
+template<typename T>
+void appendLittleEndian(std::vector<unsigned char>& out, T value)
+{
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T)); // the formats and every supported platform are little endian
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void appendAttribute(std::vector<unsigned char>& out, const char* name, const char* type, const std::vector<unsigned char>& value)
+{
+    out.insert(out.end(), name, name + std::strlen(name) + 1);
+    out.insert(out.end(), type, type + std::strlen(type) + 1);
+    appendLittleEndian<int32_t>(out, static_cast<int32_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+bool writeFile(const std::string& path, const std::vector<unsigned char>& bytes)
+{
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    bool written = file && std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    if (file) written = std::fclose(file) == 0 && written;
+    if (!written) std::cerr << "Error: failed to write image " << path << std::endl;
+    return written;
+}
+} // namespace
+
+bool WritePNG(const std::string& path, int width, int height, int channels, const unsigned char* pixels)
+{
+    static const unsigned char colorTypes[5] = { 0, 0, 4, 2, 6 };
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4 || channels == 2)
+    {
+        std::cerr << "Error: can't write a " << width << "x" << height << "x" << channels << " PNG" << std::endl;
+        return false;
+    }
+    // Sub filter, every byte minus the same channel of the pixel to its left
+    size_t rowBytes = static_cast<size_t>(width) * channels;
+    std::vector<unsigned char> filtered;
+    filtered.reserve((rowBytes + 1) * height);
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* row = pixels + y * rowBytes;
+        filtered.push_back(1);
+        for (size_t i = 0; i < rowBytes; ++i) filtered.push_back(static_cast<unsigned char>(row[i] - (i >= static_cast<size_t>(channels) ? row[i - channels] : 0)));
+    }
+
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> header;
+    appendBigEndian(header, static_cast<uint32_t>(width));
+    appendBigEndian(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), { 8, colorTypes[channels], 0, 0, 0 }); // depth, color type, deflate, filters, no interlace
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlibCompress(filtered));
+    appendChunk(png, "IEND", {});
+    return writeFile(path, png);
+}
+
+bool WriteEXR(const std::string& path, int width, int height, const float* rgb)
+{
+    if (width <= 0 || height <= 0)
+    {
+        std::cerr << "Error: can't write a " << width << "x" << height << " EXR" << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> exr = { 0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0 }; // magic, version 2, single part scanlines
+
+    // channels in alphabetical order, HALF, not linear-perceptual, no subsampling
+    std::vector<unsigned char> channels;
+    for (const char* name : { "B", "G", "R" })
+    {
+        channels.insert(channels.end(), name, name + 2);
+        appendLittleEndian<int32_t>(channels, 1);
+        channels.insert(channels.end(), { 0, 0, 0, 0 });
+        appendLittleEndian<int32_t>(channels, 1);
+        appendLittleEndian<int32_t>(channels, 1);
+    }
+    channels.push_back(0);
+    appendAttribute(exr, "channels", "chlist", channels);
+    appendAttribute(exr, "compression", "compression", { 0 });
+    std::vector<unsigned char> window;
+    for (int32_t value : { 0, 0, width - 1, height - 1 }) appendLittleEndian<int32_t>(window, value);
+    appendAttribute(exr, "dataWindow", "box2i", window);
+    appendAttribute(exr, "displayWindow", "box2i", window);
+    appendAttribute(exr, "lineOrder", "lineOrder", { 0 }); // increasing y, top to bottom
+    std::vector<unsigned char> value;
+    appendLittleEndian<float>(value, 1.0f);
+    appendAttribute(exr, "pixelAspectRatio", "float", value);
+    appendAttribute(exr, "screenWindowWidth", "float", value);
+    value.clear();
+    appendLittleEndian<float>(value, 0.0f);
+    appendLittleEndian<float>(value, 0.0f);
+    appendAttribute(exr, "screenWindowCenter", "v2f", value);
+    exr.push_back(0);
+
+    // one offset per scanline, then the scanlines: y, byte count, the B, G and R halves of the row
+    size_t lineBytes = static_cast<size_t>(width) * 3 * sizeof(uint16_t);
+    uint64_t offset = exr.size() + sizeof(uint64_t) * height;
+    for (int y = 0; y < height; ++y)
+    {
+        appendLittleEndian<uint64_t>(exr, offset);
+        offset += 2 * sizeof(int32_t) + lineBytes;
+    }
+    for (int y = 0; y < height; ++y)
+    {
+        appendLittleEndian<int32_t>(exr, y);
+        appendLittleEndian<int32_t>(exr, static_cast<int32_t>(lineBytes));
+        const float* row = rgb + static_cast<size_t>(y) * width * 3;
+        for (int channel = 2; channel >= 0; --channel)
+        {
+            for (int x = 0; x < width; ++x) appendLittleEndian<uint16_t>(exr, glm::packHalf1x16(row[x * 3 + channel]));
+        }
+    }
+    return writeFile(path, exr);
+}
+
+bool WriteDisplayImage(const std::string& path, int width, int height, const float* rgb)
+{
+    size_t count = static_cast<size_t>(width) * height * 3;
+    if (IsEXRPath(path))
+    {
+        std::vector<float> linear(rgb, rgb + count);
+        for (float& value : linear) value = std::pow(std::max(value, 0.0f), 2.2f);
+        return WriteEXR(path, width, height, linear.data());
+    }
+    std::vector<unsigned char> quantized(count);
+    for (size_t i = 0; i < count; ++i) quantized[i] = static_cast<unsigned char>(std::clamp(rgb[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    return WritePNG(path, width, height, 3, quantized.data());
+}
+
+bool WriteDisplayImage(const std::string& path, const DisplayImage& image)
+{
+    if (!image.rgb32f.empty()) return WriteDisplayImage(path, image.width, image.height, image.rgb32f.data());
+    if (!IsEXRPath(path)) return WritePNG(path, image.width, image.height, 3, image.rgb8.data());
+    std::vector<float> rgb(image.rgb8.size());
+    for (size_t i = 0; i < rgb.size(); ++i) rgb[i] = image.rgb8[i] / 255.0f;
+    return WriteDisplayImage(path, image.width, image.height, rgb.data());
+}
+} // namespace utility
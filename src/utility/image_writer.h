@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace utility
+{
+
+// 8 bit PNG, channels 1 (gray), 3 (RGB) or 4 (RGBA), the rows top to bottom
+bool WritePNG(const std::string& path, int width, int height, int channels, const unsigned char* pixels);
+// OpenEXR, uncompressed half float RGB scanlines, the rows top to bottom
+bool WriteEXR(const std::string& path, int width, int height, const float* rgb);
+// an image as displayed, gamma encoded RGB in [0, 1] with the rows top to bottom, in the format of the extension:
+// PNG gets it quantized to 8 bits, EXR with the display gamma undone so EXR viewers show the same image
+bool WriteDisplayImage(const std::string& path, int width, int height, const float* rgb);
+
+// an image as displayed, RGB with the rows top to bottom: 8 bit, or float in [0, 1] when rgb32f is used
+struct DisplayImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgb8;
+    std::vector<float> rgb32f;
+};
+// as above, an 8 bit image goes to PNG unchanged and is widened for EXR
+bool WriteDisplayImage(const std::string& path, const DisplayImage& image);
+
+// picks the format by the extension, .exr or .png
+inline bool IsEXRPath(const std::string& path)
+{
+    return path.size() >= 4 && (path.compare(path.size() - 4, 4, ".exr") == 0 || path.compare(path.size() - 4, 4, ".EXR") == 0);
+}
+} // namespace utility
@@ -0,0 +1,280 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "utility/json.h"
+
+namespace utility
+{
+
+namespace
+{
+class JsonParser
+{
+public:
+    JsonParser(const std::string& text, std::string& error) : m_text(text), m_error(error) { }
+
+    bool ParseDocument(JsonValue& value)
+    {
+        if (!parseValue(value, 0)) return false;
+        skipWhitespace();
+        if (m_position != m_text.size()) return fail("end of the document");
+        return true;
+    }
+
+private:
+    static constexpr int kMaxDepth = 256;
+
+    bool fail(const char* expected)
+    {
+        int line = 1;
+        for (size_t i = 0; i < m_position && i < m_text.size(); ++i) line += m_text[i] == '\n';
+        m_error = "line " + std::to_string(line) + ": expected " + expected;
+        return false;
+    }
+
+    void skipWhitespace()
+    {
+        while (m_position < m_text.size())
+        {
+            char c = m_text[m_position];
+            if (c != ' ' && c != '\t' && c != '\r' && c != '\n') break;
+            ++m_position;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skipWhitespace();
+        if (m_position < m_text.size() && m_text[m_position] == c)
+        {
+            ++m_position;
+            return true;
+        }
+        return false;
+    }
+
+    bool consumeWord(const char* word)
+    {
+        size_t length = std::strlen(word);
+        if (m_text.compare(m_position, length, word) != 0) return false;
+        m_position += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth)
+    {
+        if (depth > kMaxDepth) return fail("less nesting");
+        skipWhitespace();
+        if (m_position >= m_text.size()) return fail("a value");
+        char c = m_text[m_position];
+        if (c == '{') return parseObject(value, depth);
+        if (c == '[') return parseArray(value, depth);
+        if (c == '"')
+        {
+            value.type = JsonValue::Type::String;
+            return parseString(value.string);
+        }
+        if (consumeWord("true") || consumeWord("false"))
+        {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = c == 't';
+            return true;
+        }
+        if (consumeWord("null"))
+        {
+            value.type = JsonValue::Type::Null;
+            return true;
+        }
+        return parseNumber(value);
+    }
+
+    bool parseObject(JsonValue& value, int depth)
+    {
+        value.type = JsonValue::Type::Object;
+        ++m_position;
+        if (consume('}')) return true;
+        do
+        {
+            skipWhitespace();
+            std::string key;
+            if (m_position >= m_text.size() || m_text[m_position] != '"') return fail("a member name");
+            if (!parseString(key)) return false;
+            if (!consume(':')) return fail("':'");
+            value.object.emplace_back(std::move(key), JsonValue());
+            if (!parseValue(value.object.back().second, depth + 1)) return false;
+        } while (consume(','));
+        if (!consume('}')) return fail("',' or '}'");
+        return true;
+    }
+
+    bool parseArray(JsonValue& value, int depth)
+    {
+        value.type = JsonValue::Type::Array;
+        ++m_position;
+        if (consume(']')) return true;
+        do
+        {
+            value.array.emplace_back();
+            if (!parseValue(value.array.back(), depth + 1)) return false;
+        } while (consume(','));
+        if (!consume(']')) return fail("',' or ']'");
+        return true;
+    }
+
+    bool parseNumber(JsonValue& value)
+    {
+        // the JSON grammar, strtod alone would also take hex, inf and leading '+'
+        size_t begin = m_position;
+        auto digits = [this]()
+        {
+            size_t start = m_position;
+            while (m_position < m_text.size() && m_text[m_position] >= '0' && m_text[m_position] <= '9') ++m_position;
+            return m_position > start;
+        };
+        if (m_position < m_text.size() && m_text[m_position] == '-') ++m_position;
+        if (!digits()) return fail("a value");
+        if (m_position < m_text.size() && m_text[m_position] == '.')
+        {
+            ++m_position;
+            if (!digits()) return fail("digits after '.'");
+        }
+        if (m_position < m_text.size() && (m_text[m_position] == 'e' || m_text[m_position] == 'E'))
+        {
+            ++m_position;
+            if (m_position < m_text.size() && (m_text[m_position] == '+' || m_text[m_position] == '-')) ++m_position;
+            if (!digits()) return fail("exponent digits");
+        }
+        value.type = JsonValue::Type::Number;
+        value.number = std::strtod(m_text.substr(begin, m_position - begin).c_str(), nullptr);
+        return true;
+    }
+
+    bool parseHex4(unsigned int& code)
+    {
+        if (m_position + 4 > m_text.size()) return fail("4 hex digits");
+        code = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            char c = m_text[m_position++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else return fail("4 hex digits");
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned int code)
+    {
+        if (code < 0x80) out += static_cast<char>(code);
+        else if (code < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool parseString(std::string& out)
+    {
+        ++m_position; // opening quote
+        out.clear();
+        while (m_position < m_text.size())
+        {
+            char c = m_text[m_position++];
+            if (c == '"') return true;
+            if (static_cast<unsigned char>(c) < 0x20) return fail("an escaped control character");
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (m_position >= m_text.size()) break;
+            char escape = m_text[m_position++];
+            switch (escape)
+            {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+                unsigned int code;
+                if (!parseHex4(code)) return false;
+                // a surrogate pair encodes one code point above the basic plane
+                if (code >= 0xD800 && code < 0xDC00 && m_text.compare(m_position, 2, "\\u") == 0)
+                {
+                    m_position += 2;
+                    unsigned int low;
+                    if (!parseHex4(low)) return false;
+                    if (low < 0xDC00 || low >= 0xE000) return fail("a low surrogate");
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default: return fail("a valid escape");
+            }
+        }
+        return fail("a closing '\"'");
+    }
+
+    const std::string& m_text;
+    std::string& m_error;
+    size_t m_position = 0;
+};
+} // namespace
+
+const JsonValue* JsonValue::Find(const std::string& key) const
+{
+    if (type != Type::Object) return nullptr;
+    for (const auto& member : object)
+    {
+        if (member.first == key) return &member.second;
+    }
+    return nullptr;
+}
+
+bool ParseJson(const std::string& text, JsonValue& value, std::string& error)
+{
+    value = JsonValue();
+    JsonParser parser(text, error);
+    return parser.ParseDocument(value);
+}
+
+bool ReadJsonFile(const std::string& path, JsonValue& value, std::string& error)
+{
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    if (!input.is_open())
+    {
+        error = "can't open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << input.rdbuf();
+    if (!ParseJson(text.str(), value, error))
+    {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+} // namespace utility
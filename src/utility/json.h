@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace utility
+{
+
+// a parsed JSON document, small enough for job and config files. Objects keep their members in file order
+struct JsonValue
+{
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string; // UTF-8
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    inline bool IsNumber() const { return type == Type::Number; }
+    inline bool IsString() const { return type == Type::String; }
+    inline bool IsArray() const { return type == Type::Array; }
+    inline bool IsObject() const { return type == Type::Object; }
+    // the member of an object, null when this is no object or has no such member
+    const JsonValue* Find(const std::string& key) const;
+};
+
+// error tells the line and what was expected when the text is no valid JSON
+bool ParseJson(const std::string& text, JsonValue& value, std::string& error);
+bool ReadJsonFile(const std::string& path, JsonValue& value, std::string& error);
+} // namespace utility
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace utility
+{
+// renders a 2x2x2 cube centered at the origin (position, normal, texcoords)
+void renderCube();
+// renders a 1x1 XY quad in NDC (position, texcoords)
+void renderQuad();
+} // namespace utility
@@ -0,0 +1,28 @@
+#include "utility/resources.h"
+
+// CMake sets it to the source directory, a build without it keeps the old layout of a build directory below the sources
+#ifndef GLPBR_RESOURCE_ROOT
+#define GLPBR_RESOURCE_ROOT ".."
+#endif
+
+namespace utility
+{
+
+static std::string resourceRoot = GLPBR_RESOURCE_ROOT;
+
+void SetResourceRoot(const std::string& root)
+{
+    resourceRoot = root;
+    while (resourceRoot.size() > 1 && (resourceRoot.back() == '/' || resourceRoot.back() == '\\')) resourceRoot.pop_back();
+}
+
+const std::string& GetResourceRoot()
+{
+    return resourceRoot;
+}
+
+std::string ResourcePath(const char* relativePath)
+{
+    return resourceRoot + "/" + relativePath;
+}
+} // namespace utility
@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+
+namespace utility
+{
+
+// the directory holding shader/ and resources/. It defaults to the source directory the build was configured
+// from, --resource-root overrides it, so glPBR runs from any working directory
+void SetResourceRoot(const std::string& root);
+const std::string& GetResourceRoot();
+
+// "shader/pbr.frag" -> "<root>/shader/pbr.frag"
+std::string ResourcePath(const char* relativePath);
+} // namespace utility
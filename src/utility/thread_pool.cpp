@@ -0,0 +1,64 @@
+#include "utility/thread_pool.h"
+#include <algorithm>
+
+namespace utility
+{
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    threadCount = std::max(threadCount, 1u);
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body)
+{
+    if (count == 0) return;
+    size_t chunkCount = std::min(count, m_workers.size() + 1);
+    size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    std::vector<std::future<void>> pending;
+    for (size_t begin = chunkSize; begin < count; begin += chunkSize)
+    {
+        size_t end = std::min(begin + chunkSize, count);
+        pending.push_back(Submit([&body, begin, end]() { body(begin, end); }));
+    }
+    // the calling thread takes the first chunk instead of idling
+    body(0, std::min(chunkSize, count));
+    for (auto& task : pending)
+    {
+        task.get();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty()) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+} // namespace utility
@@ -0,0 +1,52 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace utility
+{
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template<typename F>
+    auto Submit(F&& task) -> std::future<decltype(task())>
+    {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace([packaged]() { (*packaged)(); });
+        }
+        m_condition.notify_one();
+        return result;
+    }
+
+    // splits [0, count) into contiguous chunks, runs them on the workers and the calling thread,
+    // and returns once every chunk is done
+    void ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body);
+
+    inline unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
+} // namespace utility